@@ -0,0 +1,147 @@
+/***************************************************************************************************/
+/*
+   This is an Arduino sketch for DFPlayer Mini MP3 module
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   DFPlayer Mini features:
+   - 3.2v..5.0v, typical 4.2v
+   - 15mA without flash drive, typical 24mA
+   - 24-bit DAC with 90dB output dynamic range and SNR over 85dB
+   - micro SD-card, up to 32GB (FAT16, FAT32)
+   - USB-Disk up to 32GB (FAT16, FAT32)
+   - supports mp3 sampling rate 8KHz, 11.025KHz, 12KHz, 16KHz, 22.05KHz, 24KHz, 32KHz, 44.1KHz, 48KHz
+   - supports up to 100 folders, each folder can be assigned to 001..255 songs
+   - built-in 3W mono amplifier, NS8002 AB-Class with standby function
+   - UART to communicate, 9600bps (parity:none, data bits:8, stop bits:1, flow control:none)
+
+   NOTE:
+   - if you hear a loud noise, add a 1K resistor in series with DFPlayer TX pin
+   - move the jumper from right to left to automatically switch the amplifier to standby
+   - safe gap between commands differs between production batches of GD3200B clones,
+     sketch finds it once by "calibrateGap()" & keeps it in EEPROM for next boots
+   - erase EEPROM or change CALIBRATION_MAGIC to calibrate again, e.g. after module
+     replacement
+
+   Frameworks & Libraries:
+   ESP8266 Core      -  https://github.com/esp8266/Arduino
+   EspSoftwareSerial -  https://github.com/plerup/espsoftwareserial
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <EEPROM.h>
+#include <SoftwareSerial.h>
+#include <DFPlayer.h>
+
+
+
+
+#define MP3_RX_PIN              4     //GPIO4/D2 to DFPlayer Mini TX
+#define MP3_TX_PIN              5     //GPIO5/D1 to DFPlayer Mini RX
+#define MP3_SERIAL_SPEED        9600  //DFPlayer Mini suport only 9600-baud
+#define MP3_SERIAL_BUFFER_SIZE  32    //software serial buffer size in bytes, to send 8-bytes you need 11-bytes buffer (start byte+8-data bytes+parity-byte+stop-byte=11-bytes)
+#define MP3_SERIAL_TIMEOUT      350   //average DFPlayer response timeout for GD3200B chip 350msec..500msec
+
+#define CALIBRATION_ADDRESS     0     //EEPROM address of calibration record
+#define CALIBRATION_MAGIC       0xDF  //valid calibration record
+
+
+typedef struct
+{
+  uint8_t  magic;                     //CALIBRATION_MAGIC=record is valid
+  uint16_t writeDelay;                //calibrated gap between commands, in msec
+}
+CALIBRATION;
+
+
+SoftwareSerial   mp3Serial;
+DFPlayer         mp3;
+DFPLAYER_PROFILE mp3Profile = DFPLAYER_PROFILE_GD3200B; //profile isn't copied by "setProfile()", must stay alive
+
+
+/**************************************************************************/
+/*
+    setup()
+
+    Main setup
+
+    NOTE:
+    - calibration takes about 10sec, module must be awake & SD-card
+      inserted, it runs only on first boot
+    - SoftwareSerial can't receive while transmitting, replies may
+      collide with next query during calibration, found gap is longer
+      than on hardware UART but still safe
+*/
+/**************************************************************************/
+void setup()
+{
+  Serial.begin(115200);
+
+  EEPROM.begin(sizeof(CALIBRATION)); //ESP8266 EEPROM is emulated in flash
+
+  mp3Serial.begin(MP3_SERIAL_SPEED, SWSERIAL_8N1, MP3_RX_PIN, MP3_TX_PIN, false, MP3_SERIAL_BUFFER_SIZE, 0); //false=signal not inverted, 0=ISR/RX buffer size (shared with serial TX buffer)
+
+  mp3.begin(mp3Serial, MP3_SERIAL_TIMEOUT, DFPLAYER_HW_247A, false); //"DFPLAYER_HW_247A"=GD3200B chip, false=no feedback from module after the command
+  mp3.setHalfDuplex(true);                //SoftwareSerial can't receive while transmitting, TX waits for quiet RX line
+
+  mp3Serial.enableRx(true);               //enable interrupts on RX-pin, replies are counted during calibration
+
+  CALIBRATION calibration;
+
+  EEPROM.get(CALIBRATION_ADDRESS, calibration);
+
+  if (calibration.magic == CALIBRATION_MAGIC)
+  {
+    mp3Profile.writeDelay = calibration.writeDelay;
+  }
+  else if (mp3.calibrateGap(mp3Profile) != DFPLAYER_CALIBRATION_FAILED) //sends bursts of "getVolume()" at decreasing gaps, sets "writeDelay"
+  {
+    calibration.magic      = CALIBRATION_MAGIC;
+    calibration.writeDelay = mp3Profile.writeDelay;
+
+    EEPROM.put(CALIBRATION_ADDRESS, calibration);
+    EEPROM.commit();
+  }
+  else
+  {
+    Serial.println(F("calibration failed, check wiring")); //built-in timing is kept, calibrate again on next boot
+  }
+
+  mp3.setProfile(mp3Profile);             //every command is paced by calibrated gap
+
+  Serial.print(F("gap between commands, msec: "));
+  Serial.println(mp3Profile.writeDelay);  //GD3200B built-in profile waits feedback timeout, 350msec
+
+  mp3.setSource(2);                       //1=USB-Disk, 2=TF-Card, 3=Aux, 4=Sleep, 5=NOR Flash
+  mp3.setEQ(0);                           //0=Off, 1=Pop, 2=Rock, 3=Jazz, 4=Classic, 5=Bass
+  mp3.setVolume(25);                      //0..30, module persists volume on power failure
+
+  Serial.println(mp3.getVolume());        //0..30
+
+  mp3Serial.enableRx(false);              //disable interrupts on RX-pin, less overhead than mp3Serial.listen()
+}
+
+
+/**************************************************************************/
+/*
+    loop()
+
+    Main loop
+*/
+/**************************************************************************/
+void loop()
+{
+  mp3.playTrack(1);     //play track #1
+  delay(10000);         //play for 10 seconds
+
+  mp3.next();           //commands follow each other after calibrated gap instead of 350msec
+  delay(10000);
+
+  mp3.pause();
+  delay(5000);          //pause for 5 seconds
+}
@@ -109,7 +109,7 @@ void loop()
 //mp3.playMP3Folder(1);               //1=track, folder name must be "mp3" or "MP3" & files in folder must start with 4 decimal digits with leading zeros
 //mp3.playFolder(1, 2);               //1=folder/2=track, folder name must be 01..99 & files in folder must start with 3 decimal digits with leading zeros
 
-  mp3.setResponse(true);              //enable=request feedback to return not only errors but also OK statuses
+  mp3.setFeedback(true);              //enable=request feedback to return not only errors but also OK statuses
 
   uint8_t response = mp3.getVolume(); //0..30
 
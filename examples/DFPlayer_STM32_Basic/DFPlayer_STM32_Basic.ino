@@ -78,6 +78,7 @@ void setup()
   mp3Serial.begin(MP3_SERIAL_SPEED);
 
   mp3.begin(mp3Serial, MP3_SERIAL_TIMEOUT, DFPLAYER_MINI, false); //"DFPLAYER_HW_247A" see NOTE, false=no feedback from module after the command
+  mp3.setHalfDuplex(true);                //SoftwareSerial can't receive while transmitting, TX waits for quiet RX line
 
   mp3.stop();                             //if player was runing during ESP8266 reboot
   mp3.reset();                            //reset all setting to default
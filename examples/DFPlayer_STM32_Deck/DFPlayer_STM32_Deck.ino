@@ -0,0 +1,110 @@
+/***************************************************************************************************/
+/*
+   This is an Arduino sketch for two DFPlayer Mini MP3 modules in A/B deck mode
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   DFPlayer Mini features:
+   - 3.2v..5.0v, typical 4.2v
+   - 15mA without flash drive, typical 24mA
+   - 24-bit DAC with 90dB output dynamic range and SNR over 85dB
+   - micro SD-card, up to 32GB (FAT16, FAT32)
+   - USB-Disk up to 32GB (FAT16, FAT32)
+   - supports mp3 sampling rate 8KHz, 11.025KHz, 12KHz, 16KHz, 22.05KHz, 24KHz, 32KHz, 44.1KHz, 48KHz
+   - supports up to 100 folders, each folder can be assigned to 001..255 songs
+   - built-in 3W mono amplifier, NS8002 AB-Class with standby function
+   - UART to communicate, 9600bps (parity:none, data bits:8, stop bits:1, flow control:none)
+
+   NOTE:
+   - if you hear a loud noise, add a 1K resistor in series with DFPlayer TX pin
+   - single module can't play gapless & can't crossfade, two modules feed one mixer & deck
+     alternates playlist tracks between them, see "DFPlayerDeck.h"
+   - mix DAC outputs of both modules (DAC_R/DAC_L through 10K resistors to amplifier input),
+     don't connect speaker outputs together
+   - both modules need the same SD-card content
+   - BUSY-pins let modules learn track durations on first play, next plays are gapless
+
+   Frameworks & Libraries:
+   STM32 Core        -  https://github.com/stm32duino/Arduino_Core_STM32
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <DFPlayer.h>
+#include <DFPlayerDeck.h>
+
+
+#define MP3_SERIAL_SPEED    9600  //DFPlayer Mini suport only 9600-baud
+#define MP3_SERIAL_TIMEOUT  350   //average DFPlayer response timeout 200msec..300msec for YX5200/AAxxxx chip & 350msec..500msec for GD3200B/MH2024K chip
+#define MP3_A_BUSY_PIN      PB0   //deck A BUSY-pin, low while playing
+#define MP3_B_BUSY_PIN      PB1   //deck B BUSY-pin, low while playing
+#define DECK_FOLDER         1     //playlist folder "01"
+#define DECK_FIRST_TRACK    1     //first playlist track "001.mp3"
+#define DECK_LAST_TRACK     12    //last playlist track "012.mp3"
+#define DECK_CROSSFADE      3000  //crossfade length, 0=gapless cut, in msec
+
+
+HardwareSerial mp3SerialA(PA3, PA2);   //RX, TX to deck A TX, RX
+HardwareSerial mp3SerialB(PB11, PB10); //RX, TX to deck B TX, RX
+DFPlayer       mp3A;
+DFPlayer       mp3B;
+DFPlayerDeck   deck;
+
+
+/**************************************************************************/
+/*
+    setup()
+
+    Main setup
+*/
+/**************************************************************************/
+void setup()
+{
+  Serial.begin(115200);
+
+  mp3SerialA.begin(MP3_SERIAL_SPEED);
+  mp3SerialB.begin(MP3_SERIAL_SPEED);
+
+  mp3A.begin(mp3SerialA, MP3_SERIAL_TIMEOUT, DFPLAYER_MINI, false); //false=no feedback from module after the command, BUSY-pin is used
+  mp3B.begin(mp3SerialB, MP3_SERIAL_TIMEOUT, DFPLAYER_MINI, false);
+
+  mp3A.setBusyPin(MP3_A_BUSY_PIN);
+  mp3B.setBusyPin(MP3_B_BUSY_PIN);
+
+  deck.begin(mp3A, mp3B, 25);            //both modules are switched to non-blocking mode, 25=volume 0..30
+  deck.setPlaylist(DECK_FOLDER, DECK_FIRST_TRACK, DECK_LAST_TRACK, true); //true=playlist starts over after last track
+  deck.setCrossfade(DECK_CROSSFADE);     //next track starts on idle module ahead of learned end of current track
+
+  deck.play();                           //first playlist track on deck A
+}
+
+
+/**************************************************************************/
+/*
+    loop()
+
+    Main loop
+*/
+/**************************************************************************/
+void loop()
+{
+  static uint8_t track = DFPLAYER_DECK_NO_TRACK;
+
+  deck.update();                         //services both modules, don't call "mp3A.update()" & "mp3B.update()"
+
+  if (deck.getTrack() != track)
+  {
+    track = deck.getTrack();
+
+    Serial.print(F("track: "));
+    Serial.print(track);
+    Serial.print(F(", deck: "));
+    Serial.println((deck.getActiveDeck() == 0) ? 'A' : 'B');
+  }
+
+  if (Serial.read() == 'n') {deck.next();}  //crossfade to next track now
+}
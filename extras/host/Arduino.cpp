@@ -0,0 +1,294 @@
+/***************************************************************************************************/
+/*
+   This is a minimal Arduino core for building DFPlayer library on Linux host
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <time.h>
+
+#include "Arduino.h"
+
+
+#define HOST_MAX_TICKERS  128 //max number of emulated modules & other tickers
+#define HOST_YIELD_STEP   100 //virtual time step while library waits for serial data, in usec
+
+
+static uint8_t  _pinState[256];  //GPIO state for "digitalRead()", all pins high by default
+static bool     _pinInit = false;
+static bool     _virtualTime = false;
+static uint64_t _virtualUs = 0;  //virtual clock, in usec
+static uint64_t _timeOffset = 0; //added to clock, to test "millis()" overflow
+
+static HOST_TICKER _tickers[HOST_MAX_TICKERS];
+static void       *_tickerContext[HOST_MAX_TICKERS];
+static uint8_t     _tickerCount = 0;
+
+
+/**************************************************************************/
+/*
+    _monotonicUs()
+
+    Get monotonic clock, in usec
+*/
+/**************************************************************************/
+static uint64_t _monotonicUs()
+{
+  static uint64_t startTime = 0;
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  uint64_t timeUs = ((uint64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+
+  if (startTime == 0) {startTime = timeUs;}
+
+  return timeUs - startTime;
+}
+
+
+/**************************************************************************/
+/*
+    _runTickers()
+
+    Let emulated modules process bytes & events up to current time
+*/
+/**************************************************************************/
+static void _runTickers()
+{
+  uint64_t timeUs = hostGetTime();
+
+  for (uint8_t i = 0; i < _tickerCount; i++) {_tickers[i](_tickerContext[i], timeUs);}
+}
+
+
+void hostSetVirtualTime(bool enable)
+{
+  _virtualTime = enable;
+  _virtualUs   = 0;
+}
+
+
+bool hostIsVirtualTime()
+{
+  return _virtualTime;
+}
+
+
+/**************************************************************************/
+/*
+    hostAdvance()
+
+    Advance virtual clock & run tickers
+
+    NOTE:
+    - real time clock isn't affected, tickers are still called
+*/
+/**************************************************************************/
+void hostAdvance(uint64_t us)
+{
+  if (_virtualTime == true) {_virtualUs += us;}
+
+  _runTickers();
+}
+
+
+void hostSetTimeOffset(uint64_t us)
+{
+  _timeOffset = us;
+}
+
+
+uint64_t hostGetTime()
+{
+  return ((_virtualTime == true) ? _virtualUs : _monotonicUs()) + _timeOffset;
+}
+
+
+bool hostAddTicker(HOST_TICKER ticker, void *context)
+{
+  if (_tickerCount >= HOST_MAX_TICKERS) {return false;}
+
+  _tickers[_tickerCount]       = ticker;
+  _tickerContext[_tickerCount] = context;
+
+  _tickerCount++;
+
+  return true;
+}
+
+
+void hostRemoveTicker(HOST_TICKER ticker, void *context)
+{
+  for (uint8_t i = 0; i < _tickerCount; i++)
+  {
+    if ((_tickers[i] != ticker) || (_tickerContext[i] != context)) {continue;}
+
+    _tickerCount--;
+
+    _tickers[i]       = _tickers[_tickerCount];
+    _tickerContext[i] = _tickerContext[_tickerCount];
+    return;
+  }
+}
+
+
+unsigned long millis()
+{
+  return (uint32_t)(hostGetTime() / 1000);
+}
+
+
+unsigned long micros()
+{
+  return (uint32_t)hostGetTime();
+}
+
+
+/**************************************************************************/
+/*
+    delay()
+
+    Wait, virtual clock advances in 1msec steps so emulated modules
+    respond during the wait
+*/
+/**************************************************************************/
+void delay(unsigned long ms)
+{
+  if (_virtualTime == false)
+  {
+    delayMicroseconds(ms * 1000);
+    return;
+  }
+
+  while (ms-- != 0) {hostAdvance(1000);}
+}
+
+
+void delayMicroseconds(unsigned int us)
+{
+  if (_virtualTime == true)
+  {
+    hostAdvance(us);
+    return;
+  }
+
+  struct timespec wait = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000};
+
+  nanosleep(&wait, NULL);
+
+  _runTickers();
+}
+
+
+void yield()
+{
+  delayMicroseconds(HOST_YIELD_STEP); //don't burn host CPU while waiting for serial data
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+
+int digitalRead(uint8_t pin)
+{
+  if (_pinInit == false) {return HIGH;}
+
+  return _pinState[pin];
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (_pinInit == false)
+  {
+    memset(_pinState, HIGH, sizeof(_pinState));
+
+    _pinInit = true;
+  }
+
+  _pinState[pin] = (value != LOW);
+}
+
+
+/**************************************************************************/
+/*
+    Print::write()
+
+    Write buffer byte by byte
+*/
+/**************************************************************************/
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t count = 0;
+
+  while ((count < size) && (write(buffer[count]) == 1)) {count++;}
+
+  return count;
+}
+
+
+/**************************************************************************/
+/*
+    Stream::timedRead()
+
+    Read byte, wait for data during "setTimeout()" period
+
+    NOTE:
+    - return -1 on timeout
+*/
+/**************************************************************************/
+int Stream::timedRead()
+{
+  unsigned long startTime = millis();
+
+  do
+  {
+    int data = read();
+
+    if (data >= 0) {return data;}
+
+    yield();
+  }
+  while ((millis() - startTime) < _timeout);
+
+  return -1;
+}
+
+
+/**************************************************************************/
+/*
+    Stream::readBytes()
+
+    Read bytes, wait for each byte during "setTimeout()" period
+
+    NOTE:
+    - return number of bytes placed in buffer
+*/
+/**************************************************************************/
+size_t Stream::readBytes(uint8_t *buffer, size_t length)
+{
+  size_t count = 0;
+
+  while (count < length)
+  {
+    int data = timedRead();
+
+    if (data < 0) {break;}
+
+    buffer[count++] = (uint8_t)data;
+  }
+
+  return count;
+}
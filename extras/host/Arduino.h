@@ -0,0 +1,93 @@
+/***************************************************************************************************/
+/*
+   This is a minimal Arduino core for building DFPlayer library on Linux host
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - provides only what DFPlayer library uses: Stream, time & GPIO functions
+   - "millis()", "micros()" & "delay()" use monotonic clock or virtual clock,
+     virtual clock advances only while library waits & runs registered tickers,
+     so emulated modules respond in virtual time
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef ARDUINO_HOST_h
+#define ARDUINO_HOST_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+#define HIGH         0x01
+#define LOW          0x00
+
+#define INPUT        0x00
+#define OUTPUT       0x01
+#define INPUT_PULLUP 0x02
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+void          yield();
+
+void          pinMode(uint8_t pin, uint8_t mode);
+int           digitalRead(uint8_t pin);
+void          digitalWrite(uint8_t pin, uint8_t value);
+
+
+/* host extensions */
+typedef void (*HOST_TICKER)(void *context, uint64_t timeUs); //called every time virtual clock advances
+
+void          hostSetVirtualTime(bool enable);
+bool          hostIsVirtualTime();
+void          hostAdvance(uint64_t us);
+void          hostSetTimeOffset(uint64_t us);
+uint64_t      hostGetTime();
+bool          hostAddTicker(HOST_TICKER ticker, void *context);
+void          hostRemoveTicker(HOST_TICKER ticker, void *context);
+
+
+class Print
+{
+  public:
+   virtual ~Print() {}
+
+   virtual size_t write(uint8_t data) = 0;
+   virtual size_t write(const uint8_t *buffer, size_t size);
+   virtual int    availableForWrite() {return 0;}
+   virtual void   flush()             {}
+};
+
+
+class Stream : public Print
+{
+  public:
+   Stream() : _timeout(1000) {}
+
+   virtual int available() = 0;
+   virtual int read()      = 0;
+   virtual int peek()      = 0;
+
+   void   setTimeout(unsigned long timeout) {_timeout = timeout;}
+   size_t readBytes(uint8_t *buffer, size_t length);
+
+  protected:
+   unsigned long _timeout; //"readBytes()" timeout, in msec
+
+   int timedRead();
+};
+
+#endif
@@ -0,0 +1,1179 @@
+/***************************************************************************************************/
+/*
+   This is a DFPlayer Mini module emulator for host builds of DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+
+#include <algorithm>
+
+#include "Emulator.h"
+#include "MP3Duration.h"
+
+
+/**************************************************************************/
+/*
+    DFPlayerEmulator()
+
+    Constructor, emulated module is powered up & ready
+
+    NOTE:
+    - default media: 100 root tracks, 10 folders with 20 tracks each,
+      every track 10sec long
+*/
+/**************************************************************************/
+DFPlayerEmulator::DFPlayerEmulator(EMULATOR_CHIP chip)
+{
+  _busyPin       = DFPLAYER_NO_BUSY_PIN;
+  _trackDuration = 10000;
+  _wakeTime      = EMULATOR_WAKE_TIME;
+  _toModuleTime  = 0;
+  _toLibraryTime = 0;
+  _current       = EMULATOR_NO_FILE;
+
+  setChip(chip);
+  setTracks(100, 10, 20);
+  resetStats();
+  powerUp();
+
+  _bootEnd = 0; //skip boot, module is ready
+
+  hostAddTicker(_ticker, this);
+}
+
+
+DFPlayerEmulator::~DFPlayerEmulator()
+{
+  hostRemoveTicker(_ticker, this);
+}
+
+
+/**************************************************************************/
+/*
+    setChip()
+
+    Set emulated chip & its default timing
+
+    NOTE:
+    - GD3200B/MH2024K chip is slow, replies after 120msec & drops commands
+      received less than 150msec after previous one
+*/
+/**************************************************************************/
+void DFPlayerEmulator::setChip(EMULATOR_CHIP chip)
+{
+  _chip = chip;
+
+  if (_chip == EMULATOR_GD3200B) {setTiming(120000, 150000, 1500000);}
+  else                           {setTiming(20000,  0,      1500000);}
+}
+
+
+void DFPlayerEmulator::setBusyPin(uint8_t pin)
+{
+  _busyPin = pin;
+
+  if (_busyPin != DFPLAYER_NO_BUSY_PIN) {digitalWrite(_busyPin, (_state == EMULATOR_PLAYING) ? LOW : HIGH);}
+}
+
+
+/**************************************************************************/
+/*
+    setTiming()
+
+    Set reply delay, minimum gap between commands & boot time, in usec
+
+    NOTE:
+    - commands received earlier than "commandGap" after previous accepted
+      command are dropped, like real module busy with previous command
+*/
+/**************************************************************************/
+void DFPlayerEmulator::setTiming(uint32_t replyDelay, uint32_t commandGap, uint32_t bootTime)
+{
+  _replyDelay = replyDelay;
+  _commandGap = commandGap;
+  _bootTime   = bootTime;
+}
+
+
+/**************************************************************************/
+/*
+    setWakeTime()
+
+    Set time to select source, e.g. after sleep or standby, in usec
+
+    NOTE:
+    - commands received while source is selected are rejected with "busy"
+      error, like real module still initializing the source
+*/
+/**************************************************************************/
+void DFPlayerEmulator::setWakeTime(uint32_t wakeTime)
+{
+  _wakeTime = wakeTime;
+}
+
+
+/**************************************************************************/
+/*
+    setTrackDuration()
+
+    Set duration of every track, in msec
+*/
+/**************************************************************************/
+void DFPlayerEmulator::setTrackDuration(uint32_t duration)
+{
+  _trackDuration = duration;
+}
+
+
+/**************************************************************************/
+/*
+    setTracks()
+
+    Set synthetic media: number of tracks in the root, number of folders,
+    tracks in each folder & tracks in "mp3" folder
+
+    NOTE:
+    - files are "written" to the card in order: root, folders 01..99, "mp3"
+*/
+/**************************************************************************/
+void DFPlayerEmulator::setTracks(uint16_t rootTracks, uint8_t folders, uint8_t folderTracks, uint16_t mp3Tracks)
+{
+  folders = constrain(folders, 0, 99);
+
+  _files.clear();
+
+  _folderCount = folders + ((mp3Tracks != 0) ? 1 : 0);
+  _current     = EMULATOR_NO_FILE;
+
+  _addFiles(DFPLAYER_FOLDER_ROOT, rootTracks);
+
+  for (uint8_t folder = 1; folder <= folders; folder++) {_addFiles(folder, folderTracks);}
+
+  _addFiles(DFPLAYER_FOLDER_MP3, mp3Tracks);
+
+  _setState(EMULATOR_STOP);
+}
+
+
+/**************************************************************************/
+/*
+    setFolderTracks()
+
+    Replace tracks of synthetic folder 01..99
+
+    NOTE:
+    - new files are "written" after all existing files, like files copied
+      to the card later
+*/
+/**************************************************************************/
+void DFPlayerEmulator::setFolderTracks(uint8_t folder, uint8_t tracks)
+{
+  if ((folder == 0) || (folder > 99)) {return;}
+
+  if (_countFiles(folder) == 0) {_folderCount++;}
+
+  for (uint32_t index = _files.size(); index-- != 0;)
+  {
+    if (_files[index].folder == folder) {_files.erase(_files.begin() + index);}
+  }
+
+  _current = EMULATOR_NO_FILE;
+
+  _addFiles(folder, tracks);
+  _setState(EMULATOR_STOP);
+}
+
+
+/**************************************************************************/
+/*
+    mount()
+
+    Use host directory as SD card
+
+    NOTE:
+    - files are indexed in FAT write order, like the chip does:
+      - on vfat filesystem (e.g. loop mounted FAT image or real SD card)
+        directory order is FAT directory entry order
+      - on other filesystems entries are sorted by modification time, then
+        by name, so copy order is kept
+    - root files are played by "playTrack()" in that order, subfolders are
+      indexed when their entry is reached
+    - folders "01".."99" & "mp3"/"advert" files are addressed by leading
+      number of file name, "001 - Song.mp3", "0001 - Song.mp3"
+    - only mp3, wav & wma files are counted, including hidden "._" files
+      created by macOS, like the real chip does
+    - only root & first folder level are scanned
+    - return false if directory can't be opened
+*/
+/**************************************************************************/
+bool DFPlayerEmulator::mount(const char *path)
+{
+  std::vector<std::string> names;
+
+  if (_listDirectory(path, names) == false) {return false;}
+
+  _files.clear();
+
+  _folderCount = 0;
+  _current     = EMULATOR_NO_FILE;
+
+  uint16_t rootTrack = 0;
+
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    std::string entryPath = std::string(path) + "/" + names[i];
+    struct stat entry;
+
+    if (stat(entryPath.c_str(), &entry) != 0) {continue;}
+
+    if (S_ISDIR(entry.st_mode) == false)
+    {
+      if (_isAudioFile(names[i].c_str()) == false) {continue;}
+
+      EMULATOR_FILE file = {entryPath, DFPLAYER_FOLDER_ROOT, ++rootTrack};
+
+      _files.push_back(file);
+      continue;
+    }
+
+    std::vector<std::string> folderNames;
+
+    if (_listDirectory(entryPath, folderNames) == false) {continue;}
+
+    uint8_t folder = _getFolderCode(names[i].c_str());
+
+    _folderCount++;
+
+    for (size_t j = 0; j < folderNames.size(); j++)
+    {
+      if (_isAudioFile(folderNames[j].c_str()) == false) {continue;}
+
+      EMULATOR_FILE file = {entryPath + "/" + folderNames[j], folder, (uint16_t)strtoul(folderNames[j].c_str(), NULL, 10)};
+      struct stat   fileEntry;
+
+      if ((stat(file.path.c_str(), &fileEntry) != 0) || (S_ISREG(fileEntry.st_mode) == false)) {continue;}
+
+      _files.push_back(file);
+    }
+  }
+
+  _setState(EMULATOR_STOP);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    setCardInserted()
+
+    Emulate SD card removal & insertion
+
+    NOTE:
+    - removal stops playback, module sends "card removed" feedback 0x3B,
+      insertion sends "card inserted" feedback 0x3A
+    - media isn't changed, call "setTracks()" or "mount()" while card is
+      removed to emulate card swap
+*/
+/**************************************************************************/
+void DFPlayerEmulator::setCardInserted(bool inserted)
+{
+  _now = hostGetTime();
+
+  if (inserted == false)
+  {
+    if (_state != EMULATOR_SLEEP) {_setState(EMULATOR_STOP);}
+
+    _current = EMULATOR_NO_FILE;
+  }
+
+  _reply((inserted == true) ? DFPLAYER_RETURN_CODE_INSERTED : DFPLAYER_RETURN_CODE_REMOVED, _source, 0);
+}
+
+
+/**************************************************************************/
+/*
+    powerUp()
+
+    Power cycle emulated module, all settings are factory default
+
+    NOTE:
+    - module sends "ready" feedback after boot time
+*/
+/**************************************************************************/
+void DFPlayerEmulator::powerUp()
+{
+  _now         = hostGetTime();
+  _lastCommand = 0;
+  _bootEnd     = _now + _bootTime;
+  _wakeEnd     = 0;
+  _frameIndex  = 0;
+  _volume      = 30;
+  _eq          = 0;
+  _playMode    = 4;
+  _source      = 2;
+  _dac         = true;
+  _standby     = false;
+  _current     = EMULATOR_NO_FILE;
+  _state       = EMULATOR_STOP;
+
+  _setState(EMULATOR_STOP);
+}
+
+
+/**************************************************************************/
+/*
+    tick()
+
+    Process received bytes, playback & boot up to "timeUs"
+*/
+/**************************************************************************/
+void DFPlayerEmulator::tick(uint64_t timeUs)
+{
+  while (true)
+  {
+    uint64_t nextTime = timeUs + 1; //next event in the past or now
+
+    if ((_toModule.empty() == false) && (_toModule.front().time < nextTime))          {nextTime = _toModule.front().time;}
+    if ((_bootEnd != 0) && (_bootEnd < nextTime))                                      {nextTime = _bootEnd;}
+    if ((_state == EMULATOR_PLAYING) && (_bootEnd == 0) && (_trackEnd < nextTime))     {nextTime = _trackEnd;}
+
+    if (nextTime > timeUs) {break;}
+
+    _now = nextTime; //events are processed in order, at the time they happen
+
+    if ((_toModule.empty() == false) && (_toModule.front().time == nextTime))
+    {
+      uint8_t data = _toModule.front().data;
+
+      _toModule.pop_front();
+      _receive(data);
+    }
+    else if (_bootEnd == nextTime)
+    {
+      _bootEnd = 0;
+
+      _reply(DFPLAYER_RETURN_CODE_READY, _source, 0);
+    }
+    else
+    {
+      uint16_t index = _current + 1;
+
+      _stats.finished++;
+
+      _reply(DFPLAYER_RETURN_CODE_DONE, index, 0);
+
+      if (_chip == EMULATOR_GD3200B) {_reply(DFPLAYER_RETURN_CODE_DONE, index, 0);} //GD3200B sends "track finished" twice
+
+      switch (_playMode)
+      {
+        case 2: //loop track
+          _play(_current);
+          break;
+
+        case 1: //loop folder
+          _play(_nextInFolder(_current));
+          break;
+
+        case 0: //loop all
+          _play((_current + 1) % _files.size());
+          break;
+
+        case 3: //random
+          _play((_current * 75 + 74) % (_files.size() + 1) % _files.size());
+          break;
+
+        default:
+          _setState(EMULATOR_STOP);
+          break;
+      }
+    }
+  }
+
+  _now = timeUs;
+}
+
+
+EMULATOR_STATE DFPlayerEmulator::getState()  {return _state;}
+uint8_t        DFPlayerEmulator::getVolume() {return _volume;}
+uint8_t        DFPlayerEmulator::getEQ()     {return _eq;}
+uint8_t        DFPlayerEmulator::getSource() {return _source;}
+uint8_t        DFPlayerEmulator::getFolder() {return (_current != EMULATOR_NO_FILE) ? _files[_current].folder : DFPLAYER_FOLDER_ROOT;}
+uint16_t       DFPlayerEmulator::getTrack()  {return (_current != EMULATOR_NO_FILE) ? _files[_current].track  : 0;}
+uint32_t       DFPlayerEmulator::getIndex()  {return (_current != EMULATOR_NO_FILE) ? (_current + 1)          : 0;}
+uint32_t       DFPlayerEmulator::getTotalFiles() {return _files.size();}
+
+
+/**************************************************************************/
+/*
+    getPosition()
+
+    Get playback position of current track, in msec
+*/
+/**************************************************************************/
+uint32_t DFPlayerEmulator::getPosition()
+{
+  switch (_state)
+  {
+    case EMULATOR_PLAYING: return (hostGetTime() - _trackStart) / 1000;
+    case EMULATOR_PAUSE:   return (_pauseTime    - _trackStart) / 1000;
+    default:               return 0;
+  }
+}
+bool           DFPlayerEmulator::isDACEnabled() {return _dac;}
+bool           DFPlayerEmulator::isLooping() {return _playMode != 4;}
+EMULATOR_STATS DFPlayerEmulator::getStats()  {return _stats;}
+
+
+const EMULATOR_FILE *DFPlayerEmulator::getFile(uint32_t index)
+{
+  return (index < _files.size()) ? &_files[index] : NULL;
+}
+
+
+void DFPlayerEmulator::resetStats()
+{
+  memset(&_stats, 0x00, sizeof(_stats));
+}
+
+
+/**************************************************************************/
+/*
+    available()
+
+    Get number of bytes module finished sending to library
+*/
+/**************************************************************************/
+int DFPlayerEmulator::available()
+{
+  uint64_t timeNow = hostGetTime();
+
+  tick(timeNow);
+
+  int count = 0;
+
+  for (std::deque<EMULATOR_BYTE>::iterator data = _toLibrary.begin(); (data != _toLibrary.end()) && (data->time <= timeNow); ++data) {count++;}
+
+  return count;
+}
+
+
+int DFPlayerEmulator::read()
+{
+  int data = peek();
+
+  if (data >= 0) {_toLibrary.pop_front();}
+
+  return data;
+}
+
+
+int DFPlayerEmulator::peek()
+{
+  uint64_t timeNow = hostGetTime();
+
+  tick(timeNow);
+
+  if (_toLibrary.empty() || (_toLibrary.front().time > timeNow)) {return -1;}
+
+  return _toLibrary.front().data;
+}
+
+
+size_t DFPlayerEmulator::write(uint8_t data)
+{
+  _stats.writes++;
+
+  _transmit(data);
+
+  return 1;
+}
+
+
+size_t DFPlayerEmulator::write(const uint8_t *buffer, size_t size)
+{
+  _stats.writes++;
+
+  for (size_t i = 0; i < size; i++) {_transmit(buffer[i]);}
+
+  return size;
+}
+
+
+/**************************************************************************/
+/*
+    _transmit()
+
+    Put byte from library on emulated UART line
+*/
+/**************************************************************************/
+void DFPlayerEmulator::_transmit(uint8_t data)
+{
+  uint64_t timeNow = hostGetTime();
+
+  if (_toModuleTime < timeNow) {_toModuleTime = timeNow;}
+
+  _toModuleTime += EMULATOR_BYTE_TIME; //byte is received after its stop bit
+
+  EMULATOR_BYTE entry = {_toModuleTime, data};
+
+  _toModule.push_back(entry);
+}
+
+
+/**************************************************************************/
+/*
+    availableForWrite()
+
+    Get free space in emulated 64-bytes UART TX buffer
+*/
+/**************************************************************************/
+int DFPlayerEmulator::availableForWrite()
+{
+  uint64_t timeNow = hostGetTime();
+  uint64_t pending = (_toModuleTime > timeNow) ? ((_toModuleTime - timeNow + EMULATOR_BYTE_TIME - 1) / EMULATOR_BYTE_TIME) : 0;
+
+  return (pending < 64) ? (64 - pending) : 0;
+}
+
+
+/**************************************************************************/
+/*
+    flush()
+
+    Wait until all bytes are sent, like Arduino "Serial.flush()"
+*/
+/**************************************************************************/
+void DFPlayerEmulator::flush()
+{
+  while (hostGetTime() < _toModuleTime) {yield();}
+}
+
+
+/**************************************************************************/
+/*
+    _getDuration()
+
+    Get track duration, in msec
+
+    NOTE:
+    - duration of mounted MP3 file is calculated from its frame headers,
+      see "mp3GetDuration()"
+    - synthetic tracks & files without MP3 frames use "setTrackDuration()"
+    - override to emulate other media
+*/
+/**************************************************************************/
+uint32_t DFPlayerEmulator::_getDuration(const EMULATOR_FILE &file)
+{
+  if (file.path.empty() == true) {return _trackDuration;}
+
+  uint32_t duration = mp3GetDuration(file.path.c_str());
+
+  return (duration != MP3_NO_DURATION) ? duration : _trackDuration;
+}
+
+
+void DFPlayerEmulator::_ticker(void *context, uint64_t timeUs)
+{
+  static_cast<DFPlayerEmulator *>(context)->tick(timeUs);
+}
+
+
+/**************************************************************************/
+/*
+    _receive()
+
+    Collect received byte into frame & execute complete frame
+
+    NOTE:
+    - frame is synchronized by start byte
+*/
+/**************************************************************************/
+void DFPlayerEmulator::_receive(uint8_t data)
+{
+  uint8_t length = (_chip == EMULATOR_NO_CHECKSUM) ? (DFPLAYER_UART_FRAME_SIZE - 2) : DFPLAYER_UART_FRAME_SIZE;
+
+  if ((_frameIndex == 0) && (data != DFPLAYER_UART_START_BYTE)) {return;}
+
+  _frame[_frameIndex++] = data;
+
+  if (_frameIndex < length) {return;}
+
+  _frameIndex = 0;
+
+  if (_checkFrame(length) == false)
+  {
+    _stats.badFrames++;
+
+    _reply(DFPLAYER_RETURN_ERROR, 0x04, _replyDelay); //0x04=checksum incorrect
+    return;
+  }
+
+  if ((_lastCommand != 0) && ((_now - _lastCommand) < _commandGap))
+  {
+    _stats.dropped++;                                //module busy with previous command
+    return;
+  }
+
+  _lastCommand = _now;
+
+  if (_bootEnd != 0)
+  {
+    _reply(DFPLAYER_RETURN_ERROR, 0x01, _replyDelay); //0x01=module busy, not initialized yet
+    return;
+  }
+
+  if (_now < _wakeEnd)
+  {
+    _reply(DFPLAYER_RETURN_ERROR, 0x01, _replyDelay); //0x01=module busy, source isn't selected yet
+    return;
+  }
+
+  _stats.frames++;
+
+  _execute(_frame[3], ((uint16_t)_frame[5] << 8) | _frame[6], (_frame[4] != 0));
+}
+
+
+/**************************************************************************/
+/*
+    _checkFrame()
+
+    Check framing & checksum of received frame
+*/
+/**************************************************************************/
+bool DFPlayerEmulator::_checkFrame(uint8_t length)
+{
+  if ((_frame[1] != DFPLAYER_UART_VERSION) || (_frame[2] != DFPLAYER_UART_DATA_LEN) || (_frame[length - 1] != DFPLAYER_UART_END_BYTE)) {return false;}
+
+  if (_chip == EMULATOR_NO_CHECKSUM) {return true;}
+
+  uint16_t sum      = _frame[1] + _frame[2] + _frame[3] + _frame[4] + _frame[5] + _frame[6];
+  uint16_t checksum = ((uint16_t)_frame[7] << 8) | _frame[8];
+
+  if (_chip == EMULATOR_FN6100) {return checksum == (uint16_t)(35535 - sum + 1);} //same constant as the library, see "_encodeFrame()"
+                                 return checksum == (uint16_t)(0 - sum);
+}
+
+
+/**************************************************************************/
+/*
+    _execute()
+
+    Execute command & send reply
+
+    NOTE:
+    - playback commands are rejected with error 0x02 in sleep or standby
+    - ACK is sent only for accepted write commands & only if requested
+*/
+/**************************************************************************/
+void DFPlayerEmulator::_execute(uint8_t command, uint16_t data, bool ack)
+{
+  uint8_t  dataMSB = data >> 8;
+  uint8_t  dataLSB = data;
+  uint8_t  error   = 0;
+  uint32_t index;
+
+  bool playback = ((command >= DFPLAYER_PLAY_NEXT) && (command <= DFPLAYER_PLAY_TRACK)) || (command == DFPLAYER_LOOP_TRACK)      ||
+                  (command == DFPLAYER_RESUME_PLAYBACK) || (command == DFPLAYER_PLAY_FOLDER)  || (command == DFPLAYER_REPEAT_ALL) ||
+                  ((command >= DFPLAYER_PLAY_MP3_FOLDER) && (command <= DFPLAYER_PLAY_3000_FOLDER)) || (command == DFPLAYER_REPEAT_FOLDER) ||
+                  (command == DFPLAYER_RANDOM_ALL_FILES) || (command == DFPLAYER_PLAY_ADVERT_FOLDER_N);
+
+  if ((playback == true) && (_state == EMULATOR_SLEEP))
+  {
+    _reply(DFPLAYER_RETURN_ERROR, 0x02, _replyDelay); //0x02=module in sleep mode
+    return;
+  }
+
+  switch (command)
+  {
+    case DFPLAYER_PLAY_NEXT:
+    case DFPLAYER_PLAY_PREV:
+    {
+      uint32_t total = _files.size();
+
+      if (total == 0) {error = 0x06; break;}
+
+      if      (_current == EMULATOR_NO_FILE)   {index = 0;}
+      else if (command == DFPLAYER_PLAY_NEXT) {index = (_current + 1) % total;}
+      else                                    {index = (_current != 0) ? (_current - 1) : (total - 1);}
+
+      _playMode = 4;
+      _play(index);
+      break;
+    }
+
+    case DFPLAYER_PLAY_TRACK:
+    case DFPLAYER_LOOP_TRACK:
+      if ((data == 0) || (data > _files.size())) {error = 0x06; break;} //0x06=track not found, tracks are indexed across whole card
+
+      _playMode = (command == DFPLAYER_LOOP_TRACK) ? 2 : 4;
+      _play(data - 1);
+      break;
+
+    case DFPLAYER_PLAY_MP3_FOLDER:
+    case DFPLAYER_PLAY_FOLDER:
+    case DFPLAYER_PLAY_3000_FOLDER:
+      if      (command == DFPLAYER_PLAY_MP3_FOLDER) {index = _findFile(DFPLAYER_FOLDER_MP3, data);}
+      else if (command == DFPLAYER_PLAY_FOLDER)     {index = _findFile(dataMSB, dataLSB);}
+      else                                          {index = _findFile(data >> 12, data & 0x0FFF);} //4-bit folder & 12-bit track
+
+      if (index == EMULATOR_NO_FILE) {error = 0x06; break;}
+
+      _playMode = 4;
+      _play(index);
+      break;
+
+    case DFPLAYER_REPEAT_FOLDER:
+      index = _findFile(dataLSB, 0);
+
+      if (index == EMULATOR_NO_FILE) {error = 0x06; break;}
+
+      _playMode = 1;
+      _play(index);
+      break;
+
+    case DFPLAYER_RANDOM_ALL_FILES:
+      if (_files.empty() == true) {error = 0x06; break;}
+
+      _playMode = 3;
+      _play(0);
+      break;
+
+    case DFPLAYER_REPEAT_ALL:
+      _playMode = (dataLSB != 0) ? 0 : 4;
+
+      if ((_playMode == 0) && (_state != EMULATOR_PLAYING) && (_files.empty() == false)) {_play(0);}
+      break;
+
+    case DFPLAYER_LOOP_CURRENT_TRACK:
+      if (_state != EMULATOR_PLAYING) {break;}
+
+      _playMode = (dataLSB == 0) ? 2 : 4; //0=repeat, 1=stop repeat
+      break;
+
+    case DFPLAYER_PLAY_ADVERT_FOLDER:
+    case DFPLAYER_PLAY_ADVERT_FOLDER_N:
+      if (_state != EMULATOR_PLAYING) {error = 0x07; break;} //0x07=advert available only while track is playing
+
+      if (command == DFPLAYER_PLAY_ADVERT_FOLDER) {index = _findFile(EMULATOR_FOLDER_ADVERT, data);}
+      else                                        {index = _findFile(EMULATOR_FOLDER_ADVERT + dataMSB, dataLSB);}
+
+      if (index == EMULATOR_NO_FILE) {error = 0x06;}
+      break;
+
+    case DFPLAYER_STOP_ADVERT_FOLDER:
+      break;
+
+    case DFPLAYER_SET_VOL_UP:
+      if (_volume < 30) {_volume++;}
+      break;
+
+    case DFPLAYER_SET_VOL_DOWN:
+      if (_volume > 0) {_volume--;}
+      break;
+
+    case DFPLAYER_SET_VOL:
+      _volume = constrain(dataLSB, 0, 30);
+      break;
+
+    case DFPLAYER_SET_EQ:
+      _eq = constrain(dataLSB, 0, 5);
+      break;
+
+    case DFPLAYER_SET_DAC:
+      _dac = (dataLSB == 0); //0=enable, 1=disable
+      break;
+
+    case DFPLAYER_SET_DAC_GAIN:
+      break;
+
+    case DFPLAYER_SET_PLAY_SRC:
+      if (dataLSB == 6)
+      {
+        _setState(EMULATOR_SLEEP);
+        break;
+      }
+
+      _wakeEnd = _now + _wakeTime; //module is busy until source is ready, e.g. after sleep or standby
+
+      _source  = dataLSB;
+      _standby = false;
+
+      _setState(EMULATOR_STOP); //source selection interrupts playback
+      break;
+
+    case DFPLAYER_SET_STANDBY_MODE:
+      _standby = true;
+
+      _setState(EMULATOR_SLEEP);
+      break;
+
+    case DFPLAYER_SET_NORMAL_MODE:
+      break;                    //doesn't work on real chips, module stays in standby
+
+    case DFPLAYER_RESET:
+      powerUp();
+      return;                   //no ACK, module reboots
+
+    case DFPLAYER_RESUME_PLAYBACK:
+      if (_state == EMULATOR_PAUSE)
+      {
+        _trackStart += _now - _pauseTime;
+        _trackEnd   += _now - _pauseTime;
+
+        _setState(EMULATOR_PLAYING);
+      }
+      else if ((_state == EMULATOR_STOP) && (_current != EMULATOR_NO_FILE))
+      {
+        _play(_current);
+      }
+      break;
+
+    case DFPLAYER_PAUSE:
+      if (_state != EMULATOR_PLAYING) {break;}
+
+      _pauseTime = _now;
+
+      _setState(EMULATOR_PAUSE);
+      break;
+
+    case DFPLAYER_STOP_PLAYBACK:
+      if (_state != EMULATOR_SLEEP) {_setState(EMULATOR_STOP);}
+      break;
+
+    case DFPLAYER_GET_STATUS:
+      _reply(command, _getStatus(), _replyDelay);
+      return;
+
+    case DFPLAYER_GET_VOL:
+      _reply(command, _volume, _replyDelay);
+      return;
+
+    case DFPLAYER_GET_EQ:
+      _reply(command, _eq, _replyDelay);
+      return;
+
+    case DFPLAYER_GET_PLAY_MODE:
+      _reply(command, _playMode, _replyDelay);
+      return;
+
+    case DFPLAYER_GET_VERSION:
+      _reply(command, 0x08, _replyDelay);
+      return;
+
+    case DFPLAYER_GET_QNT_TF_FILES:
+      _reply(command, _files.size(), _replyDelay);
+
+      if (_state == EMULATOR_PLAYING) {_setState(EMULATOR_STOP);} //catalog commands interrupt playback
+      return;
+
+    case DFPLAYER_GET_TF_TRACK:
+      _reply(command, getIndex(), _replyDelay);
+      return;
+
+    case DFPLAYER_GET_QNT_FOLDER_FILES:
+      _reply(command, _countFiles(dataLSB), _replyDelay);
+
+      if (_state == EMULATOR_PLAYING) {_setState(EMULATOR_STOP);}
+      return;
+
+    case DFPLAYER_GET_QNT_FOLDERS:
+      _reply(command, _folderCount, _replyDelay);
+
+      if (_state == EMULATOR_PLAYING) {_setState(EMULATOR_STOP);}
+      return;
+
+    case DFPLAYER_GET_QNT_USB_FILES:
+    case DFPLAYER_GET_QNT_FLASH_FILES:
+    case DFPLAYER_GET_USB_TRACK:
+    case DFPLAYER_GET_FLASH_TRACK:
+      _reply(DFPLAYER_RETURN_ERROR, 0x06, _replyDelay); //source not present
+      return;
+
+    default:
+      return;
+  }
+
+  if      (error != 0) {_reply(DFPLAYER_RETURN_ERROR, error, _replyDelay);}
+  else if (ack == true) {_reply(DFPLAYER_RETURN_CODE_OK_ACK, 0, _replyDelay);}
+}
+
+
+/**************************************************************************/
+/*
+    _reply()
+
+    Queue frame to library, sent "delay" usec after now or after previous
+    frame
+*/
+/**************************************************************************/
+void DFPlayerEmulator::_reply(uint8_t command, uint16_t data, uint64_t delay)
+{
+  uint8_t frame[DFPLAYER_UART_FRAME_SIZE] = {DFPLAYER_UART_START_BYTE, DFPLAYER_UART_VERSION, DFPLAYER_UART_DATA_LEN, command, 0x00, (uint8_t)(data >> 8), (uint8_t)data, 0x00, 0x00, DFPLAYER_UART_END_BYTE};
+
+  uint16_t sum = frame[1] + frame[2] + frame[3] + frame[4] + frame[5] + frame[6];
+
+  sum = 0 - sum; //FN6100 replies with standard checksum too, constant of "_encodeFrame()" is for frames it receives
+
+  frame[7] = sum >> 8;
+  frame[8] = sum;
+
+  uint64_t sendTime = _now + delay;
+
+  if (sendTime < _toLibraryTime) {sendTime = _toLibraryTime;}
+
+  for (uint8_t i = 0; i < DFPLAYER_UART_FRAME_SIZE; i++)
+  {
+    sendTime += EMULATOR_BYTE_TIME;
+
+    EMULATOR_BYTE entry = {sendTime, frame[i]};
+
+    _toLibrary.push_back(entry);
+  }
+
+  _toLibraryTime = sendTime;
+
+  _stats.replies++;
+}
+
+
+/**************************************************************************/
+/*
+    _play()
+
+    Start file from the beginning
+*/
+/**************************************************************************/
+void DFPlayerEmulator::_play(uint32_t index)
+{
+  if (index >= _files.size())
+  {
+    _setState(EMULATOR_STOP);
+    return;
+  }
+
+  _current    = index;
+  _trackStart = _now;
+  _trackEnd   = _now + ((uint64_t)_getDuration(_files[index]) * 1000);
+
+  _setState(EMULATOR_PLAYING);
+}
+
+
+/**************************************************************************/
+/*
+    _setState()
+
+    Change playback state & BUSY-pin
+
+    NOTE:
+    - BUSY-pin is low while playing
+*/
+/**************************************************************************/
+void DFPlayerEmulator::_setState(EMULATOR_STATE state)
+{
+  _state = state;
+
+  if (_busyPin != DFPLAYER_NO_BUSY_PIN) {digitalWrite(_busyPin, (_state == EMULATOR_PLAYING) ? LOW : HIGH);}
+}
+
+
+/**************************************************************************/
+/*
+    _getStatus()
+
+    Get "getStatus()" reply, differs between chips
+*/
+/**************************************************************************/
+uint16_t DFPlayerEmulator::_getStatus()
+{
+  if (_state == EMULATOR_SLEEP) {return 0x0002;}
+
+  if (_chip == EMULATOR_GD3200B)
+  {
+    switch (_state)
+    {
+      case EMULATOR_PLAYING: return 0x0001;
+      case EMULATOR_PAUSE:   return 0x0202;
+      default:               return 0x0000;
+    }
+  }
+
+  return ((uint16_t)_source << 8) | _state;
+}
+
+
+/**************************************************************************/
+/*
+    _findFile()
+
+    Find file by folder & leading number of file name
+
+    NOTE:
+    - track 0 finds file with smallest number in folder
+    - return EMULATOR_NO_FILE if not found
+*/
+/**************************************************************************/
+uint32_t DFPlayerEmulator::_findFile(uint8_t folder, uint16_t track)
+{
+  uint32_t found = EMULATOR_NO_FILE;
+
+  for (uint32_t index = 0; index < _files.size(); index++)
+  {
+    if ((_files[index].folder != folder) || (_files[index].track == 0)) {continue;}
+
+    if (_files[index].track == track) {return index;}
+
+    if ((track == 0) && ((found == EMULATOR_NO_FILE) || (_files[index].track < _files[found].track))) {found = index;}
+  }
+
+  return found;
+}
+
+
+/**************************************************************************/
+/*
+    _nextInFolder()
+
+    Find file with next number in the same folder, wraps to the first one
+*/
+/**************************************************************************/
+uint32_t DFPlayerEmulator::_nextInFolder(uint32_t index)
+{
+  uint8_t  folder = _files[index].folder;
+  uint16_t track  = _files[index].track;
+  uint32_t next   = EMULATOR_NO_FILE;
+
+  for (uint32_t i = 0; i < _files.size(); i++)
+  {
+    if ((_files[i].folder != folder) || (_files[i].track <= track)) {continue;}
+
+    if ((next == EMULATOR_NO_FILE) || (_files[i].track < _files[next].track)) {next = i;}
+  }
+
+  return (next != EMULATOR_NO_FILE) ? next : _findFile(folder, 0);
+}
+
+
+uint16_t DFPlayerEmulator::_countFiles(uint8_t folder)
+{
+  uint16_t count = 0;
+
+  for (uint32_t index = 0; index < _files.size(); index++)
+  {
+    if (_files[index].folder == folder) {count++;}
+  }
+
+  return count;
+}
+
+
+void DFPlayerEmulator::_addFiles(uint8_t folder, uint16_t tracks)
+{
+  for (uint16_t track = 1; track <= tracks; track++)
+  {
+    EMULATOR_FILE file = {"", folder, track};
+
+    _files.push_back(file);
+  }
+}
+
+
+/**************************************************************************/
+/*
+    _listDirectory()
+
+    Get directory entries in FAT write order
+
+    NOTE:
+    - see "mount()"
+*/
+/**************************************************************************/
+bool DFPlayerEmulator::_listDirectory(const std::string &path, std::vector<std::string> &names)
+{
+  DIR *directory = opendir(path.c_str());
+
+  if (directory == NULL) {return false;}
+
+  std::vector<std::pair<struct timespec, std::string> > entries;
+
+  for (struct dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory))
+  {
+    if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {continue;}
+
+    struct stat     info;
+    struct timespec time = {0, 0};
+
+    if (stat((path + "/" + entry->d_name).c_str(), &info) == 0) {time = info.st_mtim;}
+
+    entries.push_back(std::make_pair(time, std::string(entry->d_name)));
+  }
+
+  closedir(directory);
+
+  struct statfs filesystem;
+
+  bool isFAT = (statfs(path.c_str(), &filesystem) == 0) && (filesystem.f_type == MSDOS_SUPER_MAGIC);
+
+  if (isFAT == false)
+  {
+    std::stable_sort(entries.begin(), entries.end(), [](const std::pair<struct timespec, std::string> &a, const std::pair<struct timespec, std::string> &b)
+    {
+      if (a.first.tv_sec  != b.first.tv_sec)  {return a.first.tv_sec  < b.first.tv_sec;}
+      if (a.first.tv_nsec != b.first.tv_nsec) {return a.first.tv_nsec < b.first.tv_nsec;}
+                                               return a.second < b.second;
+    });
+  }
+
+  names.clear();
+
+  for (size_t i = 0; i < entries.size(); i++) {names.push_back(entries[i].second);}
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    _getFolderCode()
+
+    Get folder code by folder name
+
+    NOTE:
+    - "01".."99" are numbered folders, names are case insensitive
+*/
+/**************************************************************************/
+uint8_t DFPlayerEmulator::_getFolderCode(const char *name)
+{
+  if ((strlen(name) == 2) && (isdigit(name[0]) != 0) && (isdigit(name[1]) != 0) && (strcmp(name, "00") != 0)) {return atoi(name);}
+
+  if (strcasecmp(name, "mp3")    == 0) {return DFPLAYER_FOLDER_MP3;}
+  if (strcasecmp(name, "advert") == 0) {return EMULATOR_FOLDER_ADVERT;}
+
+  if ((strncasecmp(name, "advert", 6) == 0) && (strlen(name) == 7) && (name[6] >= '1') && (name[6] <= '9')) {return EMULATOR_FOLDER_ADVERT + (name[6] - '0');}
+
+  return EMULATOR_FOLDER_OTHER;
+}
+
+
+bool DFPlayerEmulator::_isAudioFile(const char *name)
+{
+  const char *extension = strrchr(name, '.');
+
+  if (extension == NULL) {return false;}
+
+  return (strcasecmp(extension, ".mp3") == 0) || (strcasecmp(extension, ".wav") == 0) || (strcasecmp(extension, ".wma") == 0);
+}
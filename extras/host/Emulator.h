@@ -0,0 +1,194 @@
+/***************************************************************************************************/
+/*
+   This is a DFPlayer Mini module emulator for host builds of DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - emulator is a Stream, pass it to "DFPlayer::begin()" instead of serial port
+   - UART is modeled at 9600bps, each byte takes 1.04msec in both directions
+   - module state, playback, BUSY-pin & unsolicited feedback (track finished,
+     ready after reset) follow host clock, use virtual clock for repeatable
+     results, see "hostSetVirtualTime()"
+   - media is synthetic, see "setTracks()", or host directory mounted as SD
+     card, see "mount()"
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef DFPLAYER_EMULATOR_h
+#define DFPLAYER_EMULATOR_h
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "DFPlayer.h"
+
+
+#define EMULATOR_BYTE_TIME   1042 //time of 1 byte at 9600bps 8N1, 10-bits, in usec
+#define EMULATOR_NO_FILE     0xFFFFFFFF
+#define EMULATOR_WAKE_TIME   150000 //time to select source, e.g. after sleep or standby, in usec
+
+/* folder codes of non-numbered folders, numbered folders 01..99 use their number & root uses DFPLAYER_FOLDER_ROOT */
+#define EMULATOR_FOLDER_ADVERT 0xF0 //"advert", "advert1".."advert9" are 0xF1..0xF9
+#define EMULATOR_FOLDER_OTHER  0xFF //any other folder, files are counted but can't be played by folder
+
+
+/* emulated chips */
+typedef enum : uint8_t
+{
+  EMULATOR_YX5200      = 0x00, //YX5200/YX5300/JL AAxxxx chip
+  EMULATOR_FN6100      = 0x01, //FN6100 chip, 0xFFFF checksum of received frames
+  EMULATOR_GD3200B     = 0x02, //GD3200B/MH2024K chip, slow & different status decoding
+  EMULATOR_NO_CHECKSUM = 0x03  //module accepting 8-bytes frames without checksum
+}
+EMULATOR_CHIP;
+
+/* emulated playback state */
+typedef enum : uint8_t
+{
+  EMULATOR_STOP    = 0x00,
+  EMULATOR_PLAYING = 0x01,
+  EMULATOR_PAUSE   = 0x02,
+  EMULATOR_SLEEP   = 0x03
+}
+EMULATOR_STATE;
+
+/* byte on the wire with time it's fully received */
+typedef struct
+{
+  uint64_t time;
+  uint8_t  data;
+}
+EMULATOR_BYTE;
+
+/* file on emulated card */
+typedef struct
+{
+  std::string path;     //host path, empty for synthetic media
+  uint8_t     folder;   //DFPLAYER_FOLDER_ROOT, 1..99, DFPLAYER_FOLDER_MP3, EMULATOR_FOLDER_ADVERT..
+  uint16_t    track;    //leading number of file name, position for root files
+}
+EMULATOR_FILE;
+
+/* emulator counters */
+typedef struct
+{
+  uint32_t frames;      //valid frames received
+  uint32_t dropped;     //frames ignored because module was busy processing previous command
+  uint32_t badFrames;   //frames with wrong checksum or framing
+  uint32_t replies;     //frames sent to library
+  uint32_t finished;    //"track finished" feedback sent
+  uint32_t writes;      //"write()" calls made by library, one call may carry several frames
+}
+EMULATOR_STATS;
+
+
+class DFPlayerEmulator : public Stream
+{
+  public:
+   DFPlayerEmulator(EMULATOR_CHIP chip = EMULATOR_YX5200);
+  ~DFPlayerEmulator();
+
+   void           setChip(EMULATOR_CHIP chip);
+   void           setBusyPin(uint8_t pin);
+   void           setTiming(uint32_t replyDelay, uint32_t commandGap, uint32_t bootTime);
+   void           setWakeTime(uint32_t wakeTime);
+   void           setTrackDuration(uint32_t duration);
+   void           setTracks(uint16_t rootTracks, uint8_t folders, uint8_t folderTracks, uint16_t mp3Tracks = 0);
+   void           setFolderTracks(uint8_t folder, uint8_t tracks);
+   bool           mount(const char *path);
+   void           setCardInserted(bool inserted);
+   void           powerUp();
+
+   void           tick(uint64_t timeUs);
+
+   EMULATOR_STATE getState();
+   uint8_t        getVolume();
+   uint8_t        getEQ();
+   uint8_t        getSource();
+   uint8_t        getFolder();
+   uint16_t       getTrack();
+   uint32_t       getIndex();
+   uint32_t       getPosition();
+   uint32_t       getTotalFiles();
+   const EMULATOR_FILE *getFile(uint32_t index);
+   bool           isDACEnabled();
+   bool           isLooping();
+   EMULATOR_STATS getStats();
+   void           resetStats();
+
+   int            available();
+   int            read();
+   int            peek();
+   size_t         write(uint8_t data);
+   size_t         write(const uint8_t *buffer, size_t size);
+   int            availableForWrite();
+   void           flush();
+
+  protected:
+   virtual uint32_t _getDuration(const EMULATOR_FILE &file);
+
+  private:
+   EMULATOR_CHIP              _chip;
+   uint8_t                    _busyPin;                             //DFPLAYER_NO_BUSY_PIN=not connected
+   uint32_t                   _replyDelay;                          //time from command to reply, in usec
+   uint32_t                   _commandGap;                          //commands received earlier after previous one are dropped, in usec
+   uint32_t                   _bootTime;                            //time to boot after power up or reset, in usec
+   uint32_t                   _wakeTime;                            //time to select source, e.g. after sleep or standby, in usec
+   uint32_t                   _trackDuration;                       //default track duration, in msec
+
+   std::deque<EMULATOR_BYTE>  _toModule;                            //bytes sent by library
+   std::deque<EMULATOR_BYTE>  _toLibrary;                           //bytes sent by module
+   uint64_t                   _toModuleTime;                        //time when last byte from library is received
+   uint64_t                   _toLibraryTime;                       //time when last byte to library is sent
+   uint8_t                    _frame[DFPLAYER_UART_FRAME_SIZE];     //frame being received by module
+   uint8_t                    _frameIndex;
+
+   uint64_t                   _now;                                 //last ticker time, in usec
+   uint64_t                   _lastCommand;                         //time of last accepted command, in usec
+   uint64_t                   _bootEnd;                             //time when module is ready after boot, 0=ready
+   uint64_t                   _wakeEnd;                             //time when selected source is ready, in usec
+   uint64_t                   _trackStart;                          //time when current track was started, shifted by pauses
+   uint64_t                   _trackEnd;                            //time when current track is finished
+   uint64_t                   _pauseTime;                           //time when current track was paused
+
+   EMULATOR_STATE             _state;
+   uint8_t                    _volume;
+   uint8_t                    _eq;
+   uint8_t                    _playMode;                            //0=loop all, 1=loop folder, 2=loop track, 3=random, 4=disable
+   uint8_t                    _source;
+   bool                       _dac;
+   bool                       _standby;
+   uint32_t                   _current;                             //index of current file, EMULATOR_NO_FILE=none
+   std::vector<EMULATOR_FILE> _files;                               //all files in chip playback order
+   uint8_t                    _folderCount;                         //folders in root
+   EMULATOR_STATS             _stats;
+
+   static void _ticker(void *context, uint64_t timeUs);
+
+   void     _transmit(uint8_t data);
+   void     _receive(uint8_t data);
+   bool     _checkFrame(uint8_t length);
+   void     _execute(uint8_t command, uint16_t data, bool ack);
+   void     _reply(uint8_t command, uint16_t data, uint64_t delay);
+   void     _play(uint32_t index);
+   void     _setState(EMULATOR_STATE state);
+   uint16_t _getStatus();
+   uint32_t _findFile(uint8_t folder, uint16_t track);
+   uint32_t _nextInFolder(uint32_t index);
+   uint16_t _countFiles(uint8_t folder);
+   void     _addFiles(uint8_t folder, uint16_t tracks);
+
+   static bool    _listDirectory(const std::string &path, std::vector<std::string> &names);
+   static uint8_t _getFolderCode(const char *name);
+   static bool    _isAudioFile(const char *name);
+};
+
+#endif
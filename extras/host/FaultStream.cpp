@@ -0,0 +1,394 @@
+/***************************************************************************************************/
+/*
+   This is a fault injector between DFPlayer library & emulated module
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <string.h>
+
+#include "FaultStream.h"
+
+
+/**************************************************************************/
+/*
+    FaultStream()
+
+    Constructor, no faults until "setFaults()" or "setFaultRate()"
+*/
+/**************************************************************************/
+FaultStream::FaultStream(Stream &stream, uint32_t seed) : _stream(&stream), _rxTime(0), _rxCount(0), _txCount(0), _rxLost(0), _halfDuplex(false), _txLost(false)
+{
+  memset(&_config, 0x00, sizeof(_config));
+
+  setSeed(seed);
+  resetStats();
+}
+
+
+void FaultStream::setFaults(const FAULT_CONFIG &config)
+{
+  _config = config;
+}
+
+
+/**************************************************************************/
+/*
+    setFaultRate()
+
+    Set all faults to the same rate
+
+    NOTE:
+    - spurious feedback rate is 1/10 of "rate", module noise rarely makes
+      valid frame
+    - jitter is 1 byte time per 1% of "rate"
+*/
+/**************************************************************************/
+void FaultStream::setFaultRate(float rate)
+{
+  _config.dropByte       = rate;
+  _config.flipBit        = rate;
+  _config.garbage        = rate;
+  _config.duplicateFrame = rate;
+  _config.spuriousDone   = rate / 10;
+  _config.spuriousReady  = rate / 10;
+  _config.jitter         = rate * 100 * 1042;
+}
+
+
+/**************************************************************************/
+/*
+    setSeed()
+
+    Restart pseudo-random generator
+
+    NOTE:
+    - xorshift32 can't use zero state
+*/
+/**************************************************************************/
+void FaultStream::setSeed(uint32_t seed)
+{
+  _random = (seed != 0) ? seed : 0x9E3779B9;
+}
+
+
+/**************************************************************************/
+/*
+    setHalfDuplex()
+
+    Enable/disable half-duplex transport emulation
+
+    NOTE:
+    - like SoftwareSerial on AVR, frame written while module frame is in
+      progress breaks both, rest of module frame is lost & written frame
+      never reaches module
+    - collision is checked at the first byte of written frame, module frame
+      started later isn't broken
+*/
+/**************************************************************************/
+void FaultStream::setHalfDuplex(bool enable)
+{
+  _halfDuplex = enable;
+}
+
+
+FAULT_STATS FaultStream::getStats()
+{
+  return _stats;
+}
+
+
+void FaultStream::resetStats()
+{
+  memset(&_stats, 0x00, sizeof(_stats));
+}
+
+
+int FaultStream::available()
+{
+  _receive();
+
+  uint64_t timeNow = hostGetTime();
+  int      count   = 0;
+
+  for (std::deque<FAULT_BYTE>::iterator data = _rxBuffer.begin(); (data != _rxBuffer.end()) && (data->time <= timeNow); ++data) {count++;}
+
+  return count;
+}
+
+
+int FaultStream::read()
+{
+  int data = peek();
+
+  if (data >= 0) {_rxBuffer.pop_front();}
+
+  return data;
+}
+
+
+int FaultStream::peek()
+{
+  _receive();
+
+  if (_rxBuffer.empty() || (_rxBuffer.front().time > hostGetTime())) {return -1;}
+
+  return _rxBuffer.front().data;
+}
+
+
+size_t FaultStream::write(uint8_t data)
+{
+  _faultTx(data);
+
+  return 1;
+}
+
+
+size_t FaultStream::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {_faultTx(buffer[i]);}
+
+  return size;
+}
+
+
+int FaultStream::availableForWrite()
+{
+  return _stream->availableForWrite();
+}
+
+
+void FaultStream::flush()
+{
+  _stream->flush();
+}
+
+
+/**************************************************************************/
+/*
+    _receive()
+
+    Move bytes from module into RX buffer, through faults
+*/
+/**************************************************************************/
+void FaultStream::_receive()
+{
+  while (_stream->available() > 0) {_faultRx(_stream->read());}
+}
+
+
+/**************************************************************************/
+/*
+    _pushRx()
+
+    Add byte to RX buffer with random delay
+
+    NOTE:
+    - bytes keep their order, delay of one byte delays all next bytes
+*/
+/**************************************************************************/
+void FaultStream::_pushRx(uint8_t data)
+{
+  uint64_t time = hostGetTime();
+
+  if (_config.jitter != 0) {time += _nextRandom() % (_config.jitter + 1);}
+
+  if (time < _rxTime) {time = _rxTime;}
+
+  _rxTime = time;
+
+  FAULT_BYTE entry = {time, data};
+
+  _rxBuffer.push_back(entry);
+}
+
+
+/**************************************************************************/
+/*
+    _faultRx()
+
+    Apply faults to byte from module
+
+    NOTE:
+    - frame end is detected by end byte of 10-bytes frame, duplicates &
+      spurious frames are inserted after it
+    - spurious frames have standard checksum
+*/
+/**************************************************************************/
+void FaultStream::_faultRx(uint8_t data)
+{
+  if (_rxCount < DFPLAYER_UART_FRAME_SIZE) {_rxFrame[_rxCount++] = data;}
+
+  if (_rxLost != 0)
+  {
+    _rxLost--;                                                   //lost by collision, see "setHalfDuplex()"
+
+    if (_rxCount == DFPLAYER_UART_FRAME_SIZE) {_rxCount = 0;}
+    return;
+  }
+
+  if (_chance(_config.garbage) == true)
+  {
+    _pushRx(_nextRandom());
+
+    _stats.inserted++;
+  }
+
+  if (_chance(_config.dropByte) == true)
+  {
+    _stats.dropped++;
+  }
+  else if (_chance(_config.flipBit) == true)
+  {
+    _pushRx(data ^ (1 << (_nextRandom() % 8)));
+
+    _stats.flipped++;
+  }
+  else
+  {
+    _pushRx(data);
+  }
+
+  if ((data != DFPLAYER_UART_END_BYTE) || (_rxCount != DFPLAYER_UART_FRAME_SIZE))
+  {
+    if ((data == DFPLAYER_UART_END_BYTE) || (_rxCount == DFPLAYER_UART_FRAME_SIZE)) {_rxCount = 0;} //resync
+    return;
+  }
+
+  _rxCount = 0;
+
+  if (_chance(_config.duplicateFrame) == true)
+  {
+    for (uint8_t i = 0; i < DFPLAYER_UART_FRAME_SIZE; i++) {_pushRx(_rxFrame[i]);}
+
+    _stats.duplicated++;
+  }
+
+  bool done  = _chance(_config.spuriousDone);
+  bool ready = _chance(_config.spuriousReady);
+
+  if ((done == false) && (ready == false)) {return;}
+
+  uint8_t  command = (done == true) ? DFPLAYER_RETURN_CODE_DONE : DFPLAYER_RETURN_CODE_READY;
+  uint16_t value   = (done == true) ? (_nextRandom() % 100) + 1 : 0x02;
+  uint8_t  frame[DFPLAYER_UART_FRAME_SIZE] = {DFPLAYER_UART_START_BYTE, DFPLAYER_UART_VERSION, DFPLAYER_UART_DATA_LEN, command, 0x00, (uint8_t)(value >> 8), (uint8_t)value, 0x00, 0x00, DFPLAYER_UART_END_BYTE};
+  uint16_t sum     = 0 - (frame[1] + frame[2] + frame[3] + frame[4] + frame[5] + frame[6]);
+
+  frame[7] = sum >> 8;
+  frame[8] = sum;
+
+  for (uint8_t i = 0; i < DFPLAYER_UART_FRAME_SIZE; i++) {_pushRx(frame[i]);}
+
+  _stats.spurious++;
+}
+
+
+/**************************************************************************/
+/*
+    _faultTx()
+
+    Apply faults to byte from library & pass it to module
+
+    NOTE:
+    - jitter isn't applied, library paces its own writes
+*/
+/**************************************************************************/
+void FaultStream::_faultTx(uint8_t data)
+{
+  if ((_txCount == 0) && (_halfDuplex == true))
+  {
+    _receive();                                                  //module bytes received so far
+
+    if (_rxCount != 0)
+    {
+      _rxLost = DFPLAYER_UART_FRAME_SIZE - _rxCount;             //rest of module frame arrives while transmitting
+      _txLost = true;
+
+      _stats.collisions++;
+    }
+  }
+
+  if (_txCount < DFPLAYER_UART_FRAME_SIZE) {_txFrame[_txCount++] = data;}
+
+  if (_txLost == true)
+  {
+    if ((data == DFPLAYER_UART_END_BYTE) || (_txCount == DFPLAYER_UART_FRAME_SIZE))
+    {
+      _txCount = 0;
+      _txLost  = false;
+    }
+    return;
+  }
+
+  if (_chance(_config.garbage) == true)
+  {
+    _stream->write((uint8_t)_nextRandom());
+
+    _stats.inserted++;
+  }
+
+  if (_chance(_config.dropByte) == true)
+  {
+    _stats.dropped++;
+  }
+  else if (_chance(_config.flipBit) == true)
+  {
+    _stream->write((uint8_t)(data ^ (1 << (_nextRandom() % 8))));
+
+    _stats.flipped++;
+  }
+  else
+  {
+    _stream->write(data);
+  }
+
+  if ((data != DFPLAYER_UART_END_BYTE) && (_txCount < DFPLAYER_UART_FRAME_SIZE)) {return;}
+
+  if ((_chance(_config.duplicateFrame) == true) && (_txCount > 1))
+  {
+    _stream->write(_txFrame, _txCount);
+
+    _stats.duplicated++;
+  }
+
+  _txCount = 0;
+}
+
+
+/**************************************************************************/
+/*
+    _chance()
+
+    Return true with specific probability
+*/
+/**************************************************************************/
+bool FaultStream::_chance(float probability)
+{
+  if (probability <= 0) {return false;}
+
+  return (_nextRandom() / 4294967296.0) < probability;
+}
+
+
+/**************************************************************************/
+/*
+    _nextRandom()
+
+    Get next number of xorshift32 pseudo-random generator
+*/
+/**************************************************************************/
+uint32_t FaultStream::_nextRandom()
+{
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+
+  return _random;
+}
@@ -0,0 +1,107 @@
+/***************************************************************************************************/
+/*
+   This is a fault injector between DFPlayer library & emulated module
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - emulates bad wiring & noise: lost bytes, flipped bits, garbage bytes,
+     duplicated frames, latency jitter & spurious module feedback
+   - emulates half-duplex transport like SoftwareSerial, see "setHalfDuplex()"
+   - all faults come from seeded pseudo-random generator, same seed & same
+     workload give same faults
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef FAULT_STREAM_h
+#define FAULT_STREAM_h
+
+#include <deque>
+
+#include "Arduino.h"
+#include "DFPlayer.h"
+
+
+/* fault probabilities, 0.0..1.0 */
+typedef struct
+{
+  float    dropByte;       //byte is lost, per byte
+  float    flipBit;        //one bit of byte is flipped, per byte
+  float    garbage;        //random byte is inserted before byte, per byte
+  float    duplicateFrame; //frame is sent twice, per frame
+  float    spuriousDone;   //"track finished" frame is inserted after frame from module, per frame
+  float    spuriousReady;  //"ready" frame is inserted after frame from module, per frame
+  uint32_t jitter;         //max random delay of bytes from module, in usec
+}
+FAULT_CONFIG;
+
+/* injected faults */
+typedef struct
+{
+  uint32_t dropped;
+  uint32_t flipped;
+  uint32_t inserted;
+  uint32_t duplicated;
+  uint32_t spurious;
+  uint32_t collisions; //frames written while module frame was in progress, see "setHalfDuplex()"
+}
+FAULT_STATS;
+
+
+class FaultStream : public Stream
+{
+  public:
+   FaultStream(Stream &stream, uint32_t seed = 1);
+
+   void         setFaults(const FAULT_CONFIG &config);
+   void         setFaultRate(float rate);
+   void         setSeed(uint32_t seed);
+   void         setHalfDuplex(bool enable);
+   FAULT_STATS  getStats();
+   void         resetStats();
+
+   int          available();
+   int          read();
+   int          peek();
+   size_t       write(uint8_t data);
+   size_t       write(const uint8_t *buffer, size_t size);
+   int          availableForWrite();
+   void         flush();
+
+  private:
+   /* byte with time it's visible to library */
+   typedef struct
+   {
+     uint64_t time;
+     uint8_t  data;
+   }
+   FAULT_BYTE;
+
+   Stream                *_stream;                            //stream to emulated module
+   FAULT_CONFIG           _config;
+   FAULT_STATS            _stats;
+   uint32_t               _random;                            //xorshift32 state
+   std::deque<FAULT_BYTE> _rxBuffer;                          //bytes from module after faults
+   uint64_t               _rxTime;                            //time of last byte in "_rxBuffer"
+   uint8_t                _rxFrame[DFPLAYER_UART_FRAME_SIZE]; //current frame from module, for duplicates
+   uint8_t                _rxCount;
+   uint8_t                _txFrame[DFPLAYER_UART_FRAME_SIZE]; //current frame to module, for duplicates
+   uint8_t                _txCount;
+   uint8_t                _rxLost;                            //bytes of module frame lost by collision
+   bool                   _halfDuplex;                        //true=TX breaks RX frame in progress & itself
+   bool                   _txLost;                            //true=current frame to module is lost by collision
+
+   void     _receive();
+   void     _pushRx(uint8_t data);
+   void     _faultRx(uint8_t data);
+   void     _faultTx(uint8_t data);
+   bool     _chance(float probability);
+   uint32_t _nextRandom();
+};
+
+#endif
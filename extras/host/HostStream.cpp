@@ -0,0 +1,309 @@
+/***************************************************************************************************/
+/*
+   This is a host Stream for DFPlayer library, serial device or pseudo-terminal & frame logger
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "HostStream.h"
+
+
+/**************************************************************************/
+/*
+    TtyStream()
+
+    Constructor
+*/
+/**************************************************************************/
+TtyStream::TtyStream() : _fd(-1), _peek(-1)
+{
+  //empty
+}
+
+
+TtyStream::~TtyStream()
+{
+  end();
+}
+
+
+/**************************************************************************/
+/*
+    begin()
+
+    Open serial device or pseudo-terminal, 9600bps 8N1 raw mode
+
+    NOTE:
+    - return false if device can't be opened
+    - pseudo-terminal ignores baud rate
+*/
+/**************************************************************************/
+bool TtyStream::begin(const char *path)
+{
+  end();
+
+  _fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+  if (_fd < 0) {return false;}
+
+  struct termios settings;
+
+  if (tcgetattr(_fd, &settings) == 0)
+  {
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, B9600);
+    cfsetospeed(&settings, B9600);
+
+    settings.c_cflag |= (CLOCAL | CREAD);
+    settings.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS); //8N1, no flow control
+
+    tcsetattr(_fd, TCSANOW, &settings);
+  }
+
+  tcflush(_fd, TCIOFLUSH);
+
+  return true;
+}
+
+
+void TtyStream::end()
+{
+  if (_fd >= 0) {close(_fd);}
+
+  _fd   = -1;
+  _peek = -1;
+}
+
+
+int TtyStream::available()
+{
+  int count = 0;
+
+  if ((_fd < 0) || (ioctl(_fd, FIONREAD, &count) != 0)) {count = 0;}
+
+  return count + ((_peek >= 0) ? 1 : 0);
+}
+
+
+int TtyStream::read()
+{
+  if (_peek >= 0)
+  {
+    int data = _peek;
+
+    _peek = -1;
+
+    return data;
+  }
+
+  uint8_t data;
+
+  if ((_fd < 0) || (::read(_fd, &data, 1) != 1)) {return -1;}
+
+  return data;
+}
+
+
+int TtyStream::peek()
+{
+  if (_peek < 0) {_peek = read();}
+
+  return _peek;
+}
+
+
+size_t TtyStream::write(uint8_t data)
+{
+  return write(&data, 1);
+}
+
+
+size_t TtyStream::write(const uint8_t *buffer, size_t size)
+{
+  if (_fd < 0) {return 0;}
+
+  ssize_t count = ::write(_fd, buffer, size);
+
+  return (count > 0) ? count : 0;
+}
+
+
+/**************************************************************************/
+/*
+    availableForWrite()
+
+    Get free space in kernel TX buffer
+
+    NOTE:
+    - assumes 4096 bytes buffer, typical for Linux tty
+*/
+/**************************************************************************/
+int TtyStream::availableForWrite()
+{
+  int pending = 0;
+
+  if ((_fd < 0) || (ioctl(_fd, TIOCOUTQ, &pending) != 0)) {return 0;}
+
+  return 4096 - pending;
+}
+
+
+void TtyStream::flush()
+{
+  if (_fd >= 0) {tcdrain(_fd);}
+}
+
+
+/**************************************************************************/
+/*
+    LogStream()
+
+    Constructor, log raw frames passing through the stream
+*/
+/**************************************************************************/
+LogStream::LogStream(Stream &stream, FILE *log) : _stream(&stream), _log(log), _echo(true), _rxCount(0)
+{
+  resetCounters();
+}
+
+
+void LogStream::setEcho(bool enable)
+{
+  flushLog();
+
+  _echo = enable;
+}
+
+
+/**************************************************************************/
+/*
+    flushLog()
+
+    Print received bytes collected so far
+*/
+/**************************************************************************/
+void LogStream::flushLog()
+{
+  if (_rxCount == 0) {return;}
+
+  _printBytes("RX", _rxLine, _rxCount);
+
+  _rxCount = 0;
+}
+
+
+void LogStream::resetCounters()
+{
+  _txBytes = 0;
+  _rxBytes = 0;
+  _txCalls = 0;
+}
+
+
+uint32_t LogStream::getTxBytes()
+{
+  return _txBytes;
+}
+
+
+uint32_t LogStream::getRxBytes()
+{
+  return _rxBytes;
+}
+
+
+uint32_t LogStream::getTxCalls()
+{
+  return _txCalls;
+}
+
+
+int LogStream::available()
+{
+  return _stream->available();
+}
+
+
+int LogStream::read()
+{
+  int data = _stream->read();
+
+  if (data < 0) {return data;}
+
+  _rxBytes++;
+
+  if (_echo == false) {return data;}
+
+  if ((data == 0x7E) || (_rxCount == sizeof(_rxLine))) {flushLog();} //start byte begins new line
+
+  _rxLine[_rxCount++] = data;
+
+  return data;
+}
+
+
+int LogStream::peek()
+{
+  return _stream->peek();
+}
+
+
+size_t LogStream::write(uint8_t data)
+{
+  return write(&data, 1);
+}
+
+
+size_t LogStream::write(const uint8_t *buffer, size_t size)
+{
+  flushLog();
+
+  _txBytes += size;
+  _txCalls++;
+
+  _printBytes("TX", buffer, size);
+
+  return _stream->write(buffer, size);
+}
+
+
+int LogStream::availableForWrite()
+{
+  return _stream->availableForWrite();
+}
+
+
+void LogStream::flush()
+{
+  _stream->flush();
+}
+
+
+/**************************************************************************/
+/*
+    _printBytes()
+
+    Print timestamp & bytes in hex
+*/
+/**************************************************************************/
+void LogStream::_printBytes(const char *prefix, const uint8_t *buffer, size_t size)
+{
+  if ((_echo == false) || (_log == NULL)) {return;}
+
+  fprintf(_log, "%10.3f %s", micros() / 1000.0, prefix);
+
+  for (size_t i = 0; i < size; i++) {fprintf(_log, " %02X", buffer[i]);}
+
+  fprintf(_log, "\n");
+}
@@ -0,0 +1,81 @@
+/***************************************************************************************************/
+/*
+   This is a host Stream for DFPlayer library, serial device or pseudo-terminal & frame logger
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef HOST_STREAM_h
+#define HOST_STREAM_h
+
+#include <stdio.h>
+
+#include "Arduino.h"
+
+
+#define HOST_STREAM_BAUD 9600 //DFPlayer Mini suport only 9600-baud
+
+
+class TtyStream : public Stream
+{
+  public:
+   TtyStream();
+  ~TtyStream();
+
+   bool   begin(const char *path);
+   void   end();
+
+   int    available();
+   int    read();
+   int    peek();
+   size_t write(uint8_t data);
+   size_t write(const uint8_t *buffer, size_t size);
+   int    availableForWrite();
+   void   flush();
+
+  private:
+   int _fd;   //file descriptor of serial device or pseudo-terminal
+   int _peek; //byte read by "peek()", -1=empty
+};
+
+
+class LogStream : public Stream
+{
+  public:
+   LogStream(Stream &stream, FILE *log);
+
+   void     setEcho(bool enable);
+   void     flushLog();
+   void     resetCounters();
+   uint32_t getTxBytes();
+   uint32_t getRxBytes();
+   uint32_t getTxCalls();
+
+   int      available();
+   int      read();
+   int      peek();
+   size_t   write(uint8_t data);
+   size_t   write(const uint8_t *buffer, size_t size);
+   int      availableForWrite();
+   void     flush();
+
+  private:
+   Stream  *_stream;   //logged stream
+   FILE    *_log;      //output for raw frames
+   bool     _echo;     //true=print raw frames
+   uint8_t  _rxLine[16]; //received bytes not printed yet
+   uint8_t  _rxCount;  //number of bytes in "_rxLine"
+   uint32_t _txBytes;  //bytes written since "resetCounters()"
+   uint32_t _rxBytes;  //bytes read since "resetCounters()"
+   uint32_t _txCalls;  //calls into serial core since "resetCounters()"
+
+   void _printBytes(const char *prefix, const uint8_t *buffer, size_t size);
+};
+
+#endif
@@ -0,0 +1,298 @@
+/***************************************************************************************************/
+/*
+   This is a MP3 duration scanner for DFPlayer module emulator
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+
+#include "MP3Duration.h"
+
+
+#define MP3_HEADER_SIZE 4 //frame header size, in bytes
+#define MP3_MAX_RESYNC  4096 //max garbage between frames, in bytes
+
+
+/* cached duration, valid while file size & modification time are the same */
+typedef struct
+{
+  off_t    size;
+  time_t   modified;
+  uint32_t duration;    //in msec
+}
+MP3_CACHE_ENTRY;
+
+/* parsed frame header */
+typedef struct
+{
+  uint8_t  version;     //0=MPEG 2.5, 2=MPEG 2, 3=MPEG 1
+  uint8_t  layer;       //1..3
+  uint32_t sampleRate;  //in Hz
+  uint16_t samples;     //samples per frame
+  uint32_t length;      //frame length with header, in bytes
+  bool     mono;
+}
+MP3_FRAME;
+
+
+static std::map<std::string, MP3_CACHE_ENTRY> _cache; //shared by all emulators playing the same media
+
+
+static const uint16_t _bitRates[2][3][16] = //in kbps, [MPEG 1, MPEG 2/2.5][layer I, II, III][index]
+{
+  {
+    {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},
+    {0, 32, 48, 56, 64,  80,  96,  112, 128, 160, 192, 224, 256, 320, 384, 0},
+    {0, 32, 40, 48, 56,  64,  80,  96,  112, 128, 160, 192, 224, 256, 320, 0}
+  },
+  {
+    {0, 32, 48, 56, 64,  80,  96,  112, 128, 144, 160, 176, 192, 224, 256, 0},
+    {0, 8,  16, 24, 32,  40,  48,  56,  64,  80,  96,  112, 128, 144, 160, 0},
+    {0, 8,  16, 24, 32,  40,  48,  56,  64,  80,  96,  112, 128, 144, 160, 0}
+  }
+};
+
+static const uint32_t _sampleRates[4][3] = //in Hz, [version][index]
+{
+  {11025, 12000, 8000},  //MPEG 2.5
+  {0,     0,     0},     //reserved
+  {22050, 24000, 16000}, //MPEG 2
+  {44100, 48000, 32000}  //MPEG 1
+};
+
+
+/**************************************************************************/
+/*
+    _parseHeader()
+
+    Parse 4-bytes frame header
+
+    NOTE:
+    - return false if header is invalid or uses reserved & free format
+      values
+*/
+/**************************************************************************/
+static bool _parseHeader(const uint8_t *data, MP3_FRAME &frame)
+{
+  if ((data[0] != 0xFF) || ((data[1] & 0xE0) != 0xE0)) {return false;} //11-bits frame sync
+
+  uint8_t version      = (data[1] >> 3) & 0x03;
+  uint8_t layerIndex   = (data[1] >> 1) & 0x03;
+  uint8_t bitRateIndex = (data[2] >> 4) & 0x0F;
+  uint8_t rateIndex    = (data[2] >> 2) & 0x03;
+  uint8_t padding      = (data[2] >> 1) & 0x01;
+
+  if ((version == 1) || (layerIndex == 0) || (bitRateIndex == 0) || (bitRateIndex == 15) || (rateIndex == 3)) {return false;}
+
+  frame.version    = version;
+  frame.layer      = 4 - layerIndex;
+  frame.sampleRate = _sampleRates[version][rateIndex];
+  frame.mono       = ((data[3] >> 6) == 0x03);
+
+  uint32_t bitRate = (uint32_t)_bitRates[(version == 3) ? 0 : 1][frame.layer - 1][bitRateIndex] * 1000;
+
+  if (frame.layer == 1)
+  {
+    frame.samples = 384;
+    frame.length  = ((12 * bitRate / frame.sampleRate) + padding) * 4;
+  }
+  else
+  {
+    frame.samples = ((frame.layer == 3) && (version != 3)) ? 576 : 1152;
+    frame.length  = (frame.samples / 8 * bitRate / frame.sampleRate) + padding;
+  }
+
+  return frame.length > MP3_HEADER_SIZE;
+}
+
+
+/**************************************************************************/
+/*
+    _findFrame()
+
+    Find next valid frame header, next header must follow to accept the
+    frame
+
+    NOTE:
+    - return offset of frame or "size" if not found
+*/
+/**************************************************************************/
+static size_t _findFrame(const uint8_t *data, size_t size, size_t offset, MP3_FRAME &frame)
+{
+  for (; (offset + MP3_HEADER_SIZE) <= size; offset++)
+  {
+    if (_parseHeader(data + offset, frame) == false) {continue;}
+
+    size_t   next = offset + frame.length;
+    MP3_FRAME nextFrame;
+
+    if ((next + MP3_HEADER_SIZE) > size)                                                                 {return offset;} //last frame in file
+    if ((_parseHeader(data + next, nextFrame) == true) && (nextFrame.sampleRate == frame.sampleRate)) {return offset;}
+  }
+
+  return size;
+}
+
+
+/**************************************************************************/
+/*
+    _readBigEndian()
+
+    Read 32-bits big-endian value
+*/
+/**************************************************************************/
+static uint32_t _readBigEndian(const uint8_t *data)
+{
+  return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+
+/**************************************************************************/
+/*
+    mp3ScanDuration()
+
+    Get duration of MP3 data in memory, in msec
+
+    NOTE:
+    - ID3v2 tag at the beginning is skipped, ID3v1 tag at the end is
+      ignored because it doesn't have frame sync
+    - Xing/Info header with frame count & VBRI header give duration
+      without scanning the whole file
+    - return MP3_NO_DURATION if no valid frame is found
+*/
+/**************************************************************************/
+uint32_t mp3ScanDuration(const uint8_t *data, size_t size)
+{
+  size_t offset = 0;
+
+  while (((offset + 10) <= size) && (memcmp(data + offset, "ID3", 3) == 0)) //some files have several tags
+  {
+    uint32_t tagSize = ((uint32_t)(data[offset + 6] & 0x7F) << 21) | ((uint32_t)(data[offset + 7] & 0x7F) << 14) |
+                       ((uint32_t)(data[offset + 8] & 0x7F) << 7)  |  (data[offset + 9] & 0x7F);   //28-bits syncsafe integer
+
+    offset += 10 + tagSize + (((data[offset + 5] & 0x10) != 0) ? 10 : 0);                           //header, tag & optional footer
+  }
+
+  MP3_FRAME frame;
+
+  offset = _findFrame(data, size, offset, frame);
+
+  if (offset >= size) {return MP3_NO_DURATION;}
+
+  /* Xing/Info header, located after side information of the first frame */
+  size_t sideInfo = (frame.version == 3) ? (frame.mono ? 17 : 32) : (frame.mono ? 9 : 17);
+  size_t xing     = offset + MP3_HEADER_SIZE + sideInfo;
+
+  if ((frame.layer == 3) && ((xing + 12) <= size) && ((memcmp(data + xing, "Xing", 4) == 0) || (memcmp(data + xing, "Info", 4) == 0)))
+  {
+    uint32_t flags = _readBigEndian(data + xing + 4);
+
+    if ((flags & 0x01) != 0) {return (uint64_t)_readBigEndian(data + xing + 8) * frame.samples * 1000 / frame.sampleRate;} //frame count is present
+  }
+
+  /* VBRI header, always 32 bytes after the frame header */
+  size_t vbri = offset + MP3_HEADER_SIZE + 32;
+
+  if (((vbri + 18) <= size) && (memcmp(data + vbri, "VBRI", 4) == 0))
+  {
+    return (uint64_t)_readBigEndian(data + vbri + 14) * frame.samples * 1000 / frame.sampleRate;
+  }
+
+  /* no header, count samples of every frame */
+  uint64_t sampleTime = 0; //sum of samples / sample rate, in usec
+
+  while (offset < size)
+  {
+    sampleTime += (uint64_t)frame.samples * 1000000 / frame.sampleRate;
+
+    size_t next = offset + frame.length;
+
+    if ((next + MP3_HEADER_SIZE) > size) {break;}
+
+    if (_parseHeader(data + next, frame) == true)
+    {
+      offset = next;
+      continue;
+    }
+
+    size_t limit = ((next + MP3_MAX_RESYNC) < size) ? (next + MP3_MAX_RESYNC) : size; //skip garbage & tags between frames
+
+    offset = _findFrame(data, limit, next, frame);
+
+    if (offset >= limit) {break;}
+  }
+
+  return sampleTime / 1000;
+}
+
+
+/**************************************************************************/
+/*
+    mp3GetDuration()
+
+    Get duration of MP3 file, in msec
+
+    NOTE:
+    - file is memory-mapped, only frame headers are read
+    - duration is cached, file is scanned again only if its size or
+      modification time changed
+    - return MP3_NO_DURATION if file can't be opened or isn't MP3
+*/
+/**************************************************************************/
+uint32_t mp3GetDuration(const char *path)
+{
+  struct stat info;
+
+  if (stat(path, &info) != 0) {return MP3_NO_DURATION;}
+
+  std::map<std::string, MP3_CACHE_ENTRY>::iterator cached = _cache.find(path);
+
+  if ((cached != _cache.end()) && (cached->second.size == info.st_size) && (cached->second.modified == info.st_mtime)) {return cached->second.duration;}
+
+  uint32_t duration = MP3_NO_DURATION;
+  int      file     = open(path, O_RDONLY);
+
+  if (file < 0) {return MP3_NO_DURATION;}
+
+  if (info.st_size > 0)
+  {
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    if (data != MAP_FAILED)
+    {
+      madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+      duration = mp3ScanDuration((const uint8_t *)data, info.st_size);
+
+      munmap(data, info.st_size);
+    }
+  }
+
+  close(file);
+
+  MP3_CACHE_ENTRY entry = {info.st_size, info.st_mtime, duration};
+
+  _cache[path] = entry;
+
+  return duration;
+}
+
+
+void mp3ClearCache()
+{
+  _cache.clear();
+}
@@ -0,0 +1,34 @@
+/***************************************************************************************************/
+/*
+   This is a MP3 duration scanner for DFPlayer module emulator
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - duration is calculated from frame headers, audio isn't decoded
+   - supports MPEG 1, 2 & 2.5 layer I, II & III, 8kHz..48kHz sampling rate
+   - Xing/Info & VBRI headers are used when present, otherwise all frame
+     headers are scanned, so CBR & VBR files both have exact duration
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef MP3_DURATION_h
+#define MP3_DURATION_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define MP3_NO_DURATION 0 //file can't be opened or has no valid MP3 frames
+
+
+uint32_t mp3GetDuration(const char *path);
+uint32_t mp3ScanDuration(const uint8_t *data, size_t size);
+void     mp3ClearCache();
+
+#endif
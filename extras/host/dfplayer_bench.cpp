@@ -0,0 +1,671 @@
+/***************************************************************************************************/
+/*
+   This is a Linux performance regression benchmark for DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - runs DFPlayer library against emulated module in virtual time, results
+     are repeatable & don't depend on host load
+   - every scenario prints one JSON line: median & p99 latency in usec, frames
+     & serial "write()" calls per operation & RAM used by DFPlayer object
+   - exit code is 1 if any iteration failed, failed iterations are counted
+     in "failed" & excluded from latency
+   - with "-b baseline.json" every result is compared to baseline, exit code
+     is 1 if any value is worse than baseline by more than "-r" percent,
+     "-b" can be repeated, e.g. one baseline per chip
+   - with "-S sketches.json" text, data & bss of examples built by "make sketches"
+     are compared to baseline too, host sizes follow library code growth but
+     aren't target flash & RAM usage
+   - with "-d directory" emulated module plays files from host directory,
+     see "DFPlayerEmulator::mount()"
+   - with "-F" fault injection sweep is added, it prints goodput & recovery
+     time for increasing fault rate, "-s seed" changes injected faults,
+     see "FaultStream"
+
+   usage: dfplayer_bench [-n count] [-f] [-d directory] [-F] [-s seed] [-b baseline.json] [-S sketches.json] [-r percent] [-o results.json]
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Emulator.h"
+#include "FaultStream.h"
+#include "DFPlayer.h"
+
+
+#define BENCH_BUSY_PIN 2    //emulated BUSY-pin
+#define BENCH_TIMEOUT  5000 //max time to wait for emulated module, in msec
+#define BENCH_QUEUE_GAP 50  //write delay of paced YX5200 in "stopBehindQueue", in msec
+
+
+typedef struct
+{
+  std::string chip;
+  std::string scenario;
+  double      median;       //latency, in usec
+  double      p99;          //latency, in usec
+  double      frames;       //frames sent per operation
+  double      writes;       //serial "write()" calls per operation, see DFPLAYER_TX_BATCH
+  unsigned    ram;          //sizeof(DFPlayer), in bytes
+  long        failed;       //failed iterations
+}
+BENCH_RESULT;
+
+
+typedef struct
+{
+  const char           *name;
+  EMULATOR_CHIP         chip;
+  DFPLAYER_MODULE_TYPE  model;
+}
+BENCH_CHIP;
+
+
+static const BENCH_CHIP chips[] =
+{
+  {"mini",   EMULATOR_YX5200,  DFPLAYER_MINI},
+  {"hw247a", EMULATOR_GD3200B, DFPLAYER_HW_247A}
+};
+
+
+static const char *mediaPath = NULL; //host directory used as SD card, NULL=synthetic media
+
+
+/**************************************************************************/
+/*
+    waitFor()
+
+    Run library & emulator until "done" returns true
+
+    NOTE:
+    - return false on timeout
+*/
+/**************************************************************************/
+template <typename DONE>
+static bool waitFor(DFPlayer &mp3, DONE done)
+{
+  uint32_t startTime = millis();
+
+  while (done() == false)
+  {
+    if ((millis() - startTime) > BENCH_TIMEOUT) {return false;}
+
+    mp3.update();
+    delay(1);
+  }
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    percentile()
+
+    Get percentile of sorted samples, nearest-rank method
+*/
+/**************************************************************************/
+static double percentile(const std::vector<double> &sorted, double percent)
+{
+  if (sorted.empty() == true) {return 0;}
+
+  size_t rank = (size_t)((percent / 100) * sorted.size() + 0.5);
+
+  if (rank < 1)             {rank = 1;}
+  if (rank > sorted.size()) {rank = sorted.size();}
+
+  return sorted[rank - 1];
+}
+
+
+/**************************************************************************/
+/*
+    runScenario()
+
+    Run one scenario "count" times on fresh library & emulator
+
+    NOTE:
+    - scenario returns operation latency in usec, or -1 on failure
+    - settle time between operations lets emulated module accept next
+      command & finish replies
+*/
+/**************************************************************************/
+template <typename SCENARIO>
+static BENCH_RESULT runScenario(const BENCH_CHIP &chip, const char *name, long count, bool feedback, SCENARIO scenario)
+{
+  DFPlayerEmulator    module(chip.chip);
+  DFPlayer            mp3;
+  std::vector<double> latency;
+  long                failed = 0;
+
+  module.setBusyPin(BENCH_BUSY_PIN);
+
+  if ((mediaPath != NULL) && (module.mount(mediaPath) == false))
+  {
+    perror(mediaPath);
+    exit(1);
+  }
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, chip.model, feedback, false);
+  mp3.setBusyPin(BENCH_BUSY_PIN);
+
+  delay(500);
+  while (module.available() > 0) {module.read();}
+
+  module.resetStats();
+
+  for (long i = 0; i < count; i++)
+  {
+    double elapsed = scenario(mp3, module, i);
+
+    if (elapsed < 0)
+    {
+      fprintf(stderr, "%s %s: iteration %ld failed\n", chip.name, name, i);
+      failed++;
+      continue;
+    }
+
+    latency.push_back(elapsed);
+
+    delay(300);
+    mp3.update();
+  }
+
+  std::sort(latency.begin(), latency.end());
+
+  BENCH_RESULT result;
+
+  result.chip     = chip.name;
+  result.scenario = name;
+  result.median   = percentile(latency, 50);
+  result.p99      = percentile(latency, 99);
+  result.frames   = (double)(module.getStats().frames + module.getStats().dropped) / count;
+  result.writes   = (double)module.getStats().writes / count;
+  result.ram      = sizeof(DFPlayer);
+  result.failed   = failed;
+
+  return result;
+}
+
+
+/**************************************************************************/
+/*
+    runChip()
+
+    Run all scenarios on one chip
+*/
+/**************************************************************************/
+static void runChip(const BENCH_CHIP &chip, long count, bool feedback, std::vector<BENCH_RESULT> &results)
+{
+  /* blocking query round trip */
+  results.push_back(runScenario(chip, "getStatus", count, feedback, [](DFPlayer &mp3, DFPlayerEmulator &, long) -> double
+  {
+    uint32_t startTime = micros();
+
+    mp3.getStatus();
+
+    return micros() - startTime;
+  }));
+
+  results.push_back(runScenario(chip, "getVolume", count, feedback, [](DFPlayer &mp3, DFPlayerEmulator &module, long) -> double
+  {
+    uint32_t startTime = micros();
+
+    uint8_t volume = mp3.getVolume();
+
+    return (volume == module.getVolume()) ? (double)(micros() - startTime) : -1;
+  }));
+
+  /* write command, time until module applied it */
+  results.push_back(runScenario(chip, "setVolume", count, feedback, [](DFPlayer &mp3, DFPlayerEmulator &module, long i) -> double
+  {
+    uint8_t  volume    = i % 31;
+    uint32_t startTime = micros();
+
+    mp3.setVolume(volume);
+
+    if (waitFor(mp3, [&]() {return module.getVolume() == volume;}) == false) {return -1;}
+
+    return micros() - startTime;
+  }));
+
+  /* burst of non-blocking commands, time until all of them applied */
+  results.push_back(runScenario(chip, "queuedBurst", count, feedback, [](DFPlayer &mp3, DFPlayerEmulator &module, long i) -> double
+  {
+    uint8_t  volume    = 10 + (i % 10);
+    uint8_t  eq        = i % 6;
+    uint32_t startTime = micros();
+
+    mp3.setNonBlocking(true);
+    mp3.setVolume(volume);
+    mp3.setEQ(eq);
+    mp3.enableDAC(true);
+    mp3.playTrack(1 + (i % 10));
+
+    bool done = waitFor(mp3, [&]() {return (module.getVolume() == volume) && (module.getEQ() == eq) && (module.getState() == EMULATOR_PLAYING);});
+
+    mp3.setNonBlocking(false);
+
+    return (done == true) ? (double)(micros() - startTime) : -1;
+  }));
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  /* command group released at once, time until all of them applied */
+  results.push_back(runScenario(chip, "transaction", count, feedback, [](DFPlayer &mp3, DFPlayerEmulator &module, long i) -> double
+  {
+    uint8_t  volume    = 10 + (i % 10);
+    uint8_t  eq        = i % 6;
+    uint32_t startTime = micros();
+
+    mp3.setNonBlocking(true);
+    mp3.beginTransaction();
+    mp3.setVolume(volume);
+    mp3.setEQ(eq);
+    mp3.enableDAC(true);
+    mp3.playTrack(1 + (i % 10));
+    mp3.endTransaction();
+
+    bool done = waitFor(mp3, [&]() {return (module.getVolume() == volume) && (module.getEQ() == eq) && (module.getState() == EMULATOR_PLAYING);});
+
+    mp3.setNonBlocking(false);
+
+    return (done == true) ? (double)(micros() - startTime) : -1;
+  }));
+  #endif
+
+  /* stop behind queued background commands, time until playback stopped, fails if stop wasn't sent ahead of them */
+  results.push_back(runScenario(chip, "stopBehindQueue", count, feedback, [&chip](DFPlayer &mp3, DFPlayerEmulator &module, long i) -> double
+  {
+    static DFPLAYER_PROFILE paced = DFPLAYER_PROFILE_YX5200;
+
+    paced.writeDelay = BENCH_QUEUE_GAP;
+
+    if (chip.chip == EMULATOR_YX5200) {mp3.setProfile(paced);}             //YX5200 has no write delay & never queues, pace it like slow chip
+
+    mp3.playTrack(1 + (i % 10));
+
+    if (waitFor(mp3, [&]() {return module.getState() == EMULATOR_PLAYING;}) == false) {return -1;}
+
+    delay(300);
+
+    uint32_t frames = module.getStats().frames;
+
+    mp3.setNonBlocking(true);
+    mp3.setEQ(i % 6);
+    mp3.setVolume(i % 31);
+    mp3.repeatCurrentTrack(false);
+
+    uint32_t startTime = micros();
+
+    mp3.stop();
+
+    bool done = waitFor(mp3, [&]() {return module.getState() == EMULATOR_STOP;});
+
+    uint32_t elapsed = micros() - startTime;
+    bool     ahead   = (module.getStats().frames - frames) < 3;            //stop passed queued commands, EQ was sent before it
+
+    waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}); //let queue drain
+
+    mp3.setNonBlocking(false);
+
+    return ((done == true) && (ahead == true)) ? (double)elapsed : -1;
+  }));
+}
+
+
+/**************************************************************************/
+/*
+    runFaults()
+
+    Run "setVolume()" & "getVolume()" pairs through fault injector with
+    increasing fault rate
+
+    NOTE:
+    - operation succeeds if library read back volume it set & module has
+      the same volume
+    - goodput is number of successful operations per second
+    - recovery time is time from start of first failed operation to end of
+      next successful one
+*/
+/**************************************************************************/
+static void runFaults(const BENCH_CHIP &chip, long count, bool feedback, uint32_t seed, FILE *file)
+{
+  static const float rates[] = {0, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05};
+
+  for (size_t r = 0; r < (sizeof(rates) / sizeof(rates[0])); r++)
+  {
+    DFPlayerEmulator module(chip.chip);
+    FaultStream      faults(module, seed);
+    DFPlayer         mp3;
+
+    if ((mediaPath != NULL) && (module.mount(mediaPath) == false))
+    {
+      perror(mediaPath);
+      exit(1);
+    }
+
+    mp3.begin(faults, DFPLAYER_CMD_DELAY, chip.model, feedback, false);
+
+    faults.setFaultRate(rates[r]);
+
+    long     success      = 0;
+    long     recoveries   = 0;
+    double   recoveryTime = 0;
+    double   recoveryMax  = 0;
+    bool     failed       = false;
+    uint32_t failTime     = 0;
+    uint32_t startTime    = millis();
+
+    for (long i = 0; i < count; i++)
+    {
+      uint8_t  volume = (i % 30) + 1;
+      uint32_t opTime = millis();
+
+      mp3.setVolume(volume);
+
+      bool ok = (mp3.getVolume() == volume) && (module.getVolume() == volume);
+
+      if (ok == false)
+      {
+        if (failed == false) {failTime = opTime;}
+
+        failed = true;
+        continue;
+      }
+
+      success++;
+
+      if (failed == false) {continue;}
+
+      double recovery = millis() - failTime;
+
+      recoveryTime += recovery;
+      recoveries++;
+      failed        = false;
+
+      if (recovery > recoveryMax) {recoveryMax = recovery;}
+    }
+
+    double      elapsed = (millis() - startTime) / 1000.0;
+    FAULT_STATS stats   = faults.getStats();
+
+    fprintf(file, "{\"chip\":\"%s\",\"scenario\":\"faults\",\"rate\":%.3f,\"seed\":%u,\"count\":%ld,\"success\":%ld,\"goodput_ops\":%.2f,\"recovery_ms\":%.0f,\"recovery_max_ms\":%.0f,\"faults\":%u}\n",
+            chip.name, rates[r], seed, count, success, (elapsed > 0) ? (success / elapsed) : 0, (recoveries != 0) ? (recoveryTime / recoveries) : 0, recoveryMax,
+            stats.dropped + stats.flipped + stats.inserted + stats.duplicated + stats.spurious);
+  }
+}
+
+
+/**************************************************************************/
+/*
+    readValue()
+
+    Get numeric value of "key" from one JSON line
+*/
+/**************************************************************************/
+static bool readValue(const std::string &line, const char *key, double &value)
+{
+  std::string pattern = std::string("\"") + key + "\":";
+  size_t      start   = line.find(pattern);
+
+  if (start == std::string::npos) {return false;}
+
+  value = strtod(line.c_str() + start + pattern.size(), NULL);
+
+  return true;
+}
+
+
+static std::string readString(const std::string &line, const char *key)
+{
+  std::string pattern = std::string("\"") + key + "\":\"";
+  size_t      start   = line.find(pattern);
+
+  if (start == std::string::npos) {return "";}
+
+  start += pattern.size();
+
+  return line.substr(start, line.find('"', start) - start);
+}
+
+
+/**************************************************************************/
+/*
+    readLines()
+
+    Append all lines of file to "lines"
+*/
+/**************************************************************************/
+static bool readLines(const char *fileName, std::vector<std::string> &lines)
+{
+  char  buffer[512];
+  FILE *file = fopen(fileName, "r");
+
+  if (file == NULL)
+  {
+    perror(fileName);
+    return false;
+  }
+
+  while (fgets(buffer, sizeof(buffer), file) != NULL) {lines.push_back(buffer);}
+
+  fclose(file);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    compareBaseline()
+
+    Compare results with baseline files
+
+    NOTE:
+    - return number of regressions, scenarios missing in baseline are
+      reported but aren't regressions, unreadable file is one regression
+*/
+/**************************************************************************/
+static int compareBaseline(const std::vector<const char *> &fileNames, const std::vector<BENCH_RESULT> &results, double tolerance)
+{
+  std::vector<std::string> lines;
+  int                      regressions = 0;
+
+  for (size_t i = 0; i < fileNames.size(); i++)
+  {
+    if (readLines(fileNames[i], lines) == false) {regressions++;}
+  }
+
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const BENCH_RESULT *baseline = NULL;
+    BENCH_RESULT        entry    = results[i]; //value missing in baseline isn't compared
+
+    for (size_t j = 0; j < lines.size(); j++)
+    {
+      if ((readString(lines[j], "chip") != results[i].chip) || (readString(lines[j], "scenario") != results[i].scenario)) {continue;}
+
+      double ram = 0;
+
+      readValue(lines[j], "median_us",     entry.median);
+      readValue(lines[j], "p99_us",        entry.p99);
+      readValue(lines[j], "frames_per_op", entry.frames);
+      readValue(lines[j], "writes_per_op", entry.writes);
+      readValue(lines[j], "ram_bytes",     ram);
+
+      entry.ram = ram;
+      baseline  = &entry;
+      break;
+    }
+
+    if (baseline == NULL)
+    {
+      fprintf(stderr, "%s %s: not in baseline\n", results[i].chip.c_str(), results[i].scenario.c_str());
+      continue;
+    }
+
+    const char *names[]   = {"median_us", "p99_us", "frames_per_op", "writes_per_op", "ram_bytes"};
+    double      current[] = {results[i].median, results[i].p99, results[i].frames, results[i].writes, (double)results[i].ram};
+    double      base[]    = {baseline->median, baseline->p99, baseline->frames, baseline->writes, (double)baseline->ram};
+
+    for (uint8_t k = 0; k < 5; k++)
+    {
+      if (current[k] <= (base[k] * (1 + tolerance / 100))) {continue;}
+
+      fprintf(stderr, "REGRESSION %s %s %s: %.2f, baseline %.2f\n", results[i].chip.c_str(), results[i].scenario.c_str(), names[k], current[k], base[k]);
+
+      regressions++;
+    }
+  }
+
+  return regressions;
+}
+
+
+/**************************************************************************/
+/*
+    compareSketches()
+
+    Compare sizes of examples with "sketch" lines of baseline files
+
+    NOTE:
+    - return number of regressions, same rules as "compareBaseline()"
+*/
+/**************************************************************************/
+static int compareSketches(const std::vector<const char *> &fileNames, const std::vector<std::string> &sizes, double tolerance)
+{
+  std::vector<std::string> lines;
+  int                      regressions = 0;
+
+  for (size_t i = 0; i < fileNames.size(); i++)
+  {
+    if (readLines(fileNames[i], lines) == false) {regressions++;}
+  }
+
+  for (size_t i = 0; i < sizes.size(); i++)
+  {
+    std::string sketch   = readString(sizes[i], "sketch");
+    size_t      baseline = lines.size();
+
+    for (size_t j = 0; j < lines.size(); j++)
+    {
+      if (readString(lines[j], "sketch") == sketch) {baseline = j; break;}
+    }
+
+    if (baseline == lines.size())
+    {
+      fprintf(stderr, "%s: not in baseline\n", sketch.c_str());
+      continue;
+    }
+
+    const char *names[] = {"text", "data", "bss"};
+
+    for (uint8_t k = 0; k < 3; k++)
+    {
+      double current = 0;
+      double base    = 0;
+
+      if ((readValue(sizes[i], names[k], current) == false) || (readValue(lines[baseline], names[k], base) == false)) {continue;}
+
+      if (current <= (base * (1 + tolerance / 100))) {continue;}
+
+      fprintf(stderr, "REGRESSION %s %s: %.0f, baseline %.0f\n", sketch.c_str(), names[k], current, base);
+
+      regressions++;
+    }
+  }
+
+  return regressions;
+}
+
+
+int main(int argc, char **argv)
+{
+  long        count     = 100;
+  bool        feedback  = false;
+  std::vector<const char *> baselines;
+  const char *output    = NULL;
+  const char *sketches  = NULL;
+  double      tolerance = 10;
+  bool        faults    = false;
+  uint32_t    seed      = 1;
+  int         option;
+
+  while ((option = getopt(argc, argv, "n:fd:Fs:b:S:r:o:")) != -1)
+  {
+    switch (option)
+    {
+      case 'n': count     = strtol(optarg, NULL, 0); break;
+      case 'f': feedback  = true;                    break;
+      case 'd': mediaPath = optarg;                  break;
+      case 'F': faults    = true;                    break;
+      case 's': seed      = strtoul(optarg, NULL, 0); break;
+      case 'b': baselines.push_back(optarg);         break;
+      case 'S': sketches  = optarg;                  break;
+      case 'r': tolerance = strtod(optarg, NULL);    break;
+      case 'o': output    = optarg;                  break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n count] [-f] [-d directory] [-F] [-s seed] [-b baseline.json] [-S sketches.json] [-r percent] [-o results.json]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  if (count < 1) {count = 1;}
+
+  std::vector<std::string> sizes;
+
+  if ((sketches != NULL) && (readLines(sketches, sizes) == false)) {return 1;}
+
+  hostSetVirtualTime(true);
+
+  std::vector<BENCH_RESULT> results;
+  long                      failed = 0;
+
+  for (size_t i = 0; i < (sizeof(chips) / sizeof(chips[0])); i++) {runChip(chips[i], count, feedback, results);}
+
+  FILE *file = (output != NULL) ? fopen(output, "w") : stdout;
+
+  if (file == NULL)
+  {
+    perror(output);
+    return 1;
+  }
+
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    fprintf(file, "{\"chip\":\"%s\",\"scenario\":\"%s\",\"count\":%ld,\"failed\":%ld,\"median_us\":%.0f,\"p99_us\":%.0f,\"frames_per_op\":%.2f,\"writes_per_op\":%.2f,\"ram_bytes\":%u}\n",
+            results[i].chip.c_str(), results[i].scenario.c_str(), count, results[i].failed, results[i].median, results[i].p99, results[i].frames, results[i].writes, results[i].ram);
+
+    failed += results[i].failed;
+  }
+
+  for (size_t i = 0; i < sizes.size(); i++) {fputs(sizes[i].c_str(), file);}
+
+  for (size_t i = 0; (faults == true) && (i < (sizeof(chips) / sizeof(chips[0]))); i++) {runFaults(chips[i], count, feedback, seed, file);}
+
+  if (file != stdout) {fclose(file);}
+
+  if (failed != 0) {fprintf(stderr, "%ld failed iteration(s)\n", failed);}
+
+  int regressions = (baselines.empty() == false) ? compareBaseline(baselines, results, tolerance) : 0;
+
+  if (baselines.empty() == false) {regressions += compareSketches(baselines, sizes, tolerance);}
+
+  if (regressions != 0) {fprintf(stderr, "%d regression(s) over %.1f%% tolerance\n", regressions, tolerance);}
+
+  return ((failed != 0) || (regressions != 0)) ? 1 : 0;
+}
@@ -0,0 +1,526 @@
+/***************************************************************************************************/
+/*
+   This is a Linux command line tool for scripting & benchmarking DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - runs DFPlayer library over serial device (USB-UART adapter), pseudo-terminal
+     or in-process module emulator, "-e <chip>" replaces <tty> & sets default "-m"
+   - commands are read from script file or stdin, one command per line, "#" starts comment
+   - every command prints result, elapsed time & raw TX/RX frames
+   - "bench <command> <count> [args]" prints latency statistics & frames per operation
+
+   - "-m", "-e", "model" & "calibrate" take any built-in profile by name:
+     mini, yx5300, jl, fn, hw247a/gd3200b, mh2024k, nochecksum
+
+   usage: dfplayer_cli [-m <profile>] [-t timeout] [-f] [-b] [-q] <tty> [script]
+          dfplayer_cli -e <profile> [-m <profile>] [-t timeout] [-f] [-b] [-q] [script]
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "HostStream.h"
+#include "Emulator.h"
+#include "DFPlayer.h"
+
+
+#define CLI_MAX_ARGS 8 //max number of words in command line
+
+
+typedef long (*CLI_HANDLER)(DFPlayer &mp3, int argc, char **argv); //return value printed as result, -1=no value
+
+typedef struct
+{
+  const char  *name;  //short name
+  const char  *alias; //library API name
+  CLI_HANDLER  handler;
+  const char  *help;
+}
+CLI_COMMAND;
+
+typedef struct
+{
+  const char             *name;    //"-m", "-e", "model" & "calibrate" argument
+  const DFPLAYER_PROFILE *profile; //built-in profile
+  EMULATOR_CHIP           chip;    //emulated chip for "-e"
+}
+CLI_PROFILE;
+
+
+static LogStream *logStream = NULL;
+
+static const CLI_PROFILE profiles[] =
+{
+  {"mini",       &DFPLAYER_PROFILE_YX5200,      EMULATOR_YX5200},      //YX5200 chip
+  {"yx5300",     &DFPLAYER_PROFILE_YX5300,      EMULATOR_YX5200},
+  {"jl",         &DFPLAYER_PROFILE_JL_AAXXXX,   EMULATOR_YX5200},
+  {"fn",         &DFPLAYER_PROFILE_FN6100,      EMULATOR_FN6100},
+  {"hw247a",     &DFPLAYER_PROFILE_GD3200B,     EMULATOR_GD3200B},
+  {"gd3200b",    &DFPLAYER_PROFILE_GD3200B,     EMULATOR_GD3200B},     //same as "hw247a"
+  {"mh2024k",    &DFPLAYER_PROFILE_MH2024K,     EMULATOR_GD3200B},
+  {"nochecksum", &DFPLAYER_PROFILE_NO_CHECKSUM, EMULATOR_NO_CHECKSUM},
+  {NULL,         NULL,                          EMULATOR_YX5200}
+};
+
+#define CLI_PROFILE_NAMES "mini|yx5300|jl|fn|hw247a|gd3200b|mh2024k|nochecksum"
+
+
+static const CLI_PROFILE *findProfile(const char *name)
+{
+  for (const CLI_PROFILE *entry = profiles; entry->name != NULL; entry++)
+  {
+    if (strcasecmp(entry->name, name) == 0) {return entry;}
+  }
+
+  return NULL;
+}
+
+
+static long argValue(int argc, char **argv, int index, long value)
+{
+  return (index < argc) ? strtol(argv[index], NULL, 0) : value;
+}
+
+static bool argEnable(int argc, char **argv, int index)
+{
+  return (index >= argc) || (strcasecmp(argv[index], "on") == 0) || (strcmp(argv[index], "1") == 0);
+}
+
+static char argSource(int argc, char **argv, int index)
+{
+  return (index < argc) ? argv[index][0] : 's'; //s=TF-card, u=USB-Disk, f=NOR-Flash
+}
+
+
+/* playback */
+static long cmdPlay(DFPlayer &mp3, int argc, char **argv)
+{
+  if (argc > 2) {mp3.playFolder(argValue(argc, argv, 1, 1), argValue(argc, argv, 2, 1));}
+  else          {mp3.playTrack(argValue(argc, argv, 1, 1));}
+
+  return -1;
+}
+
+static long cmdMP3(DFPlayer &mp3, int argc, char **argv)          {mp3.playMP3Folder(argValue(argc, argv, 1, 1));           return -1;}
+static long cmdAdvert(DFPlayer &mp3, int argc, char **argv)       {mp3.playAdvertFolder((uint16_t)argValue(argc, argv, 1, 1)); return -1;}
+static long cmdNext(DFPlayer &mp3, int, char **)                  {mp3.next();                                              return -1;}
+static long cmdPrevious(DFPlayer &mp3, int, char **)              {mp3.previous();                                          return -1;}
+static long cmdPause(DFPlayer &mp3, int, char **)                 {mp3.pause();                                             return -1;}
+static long cmdResume(DFPlayer &mp3, int, char **)                {mp3.resume();                                            return -1;}
+static long cmdStop(DFPlayer &mp3, int, char **)                  {mp3.stop();                                              return -1;}
+static long cmdRepeat(DFPlayer &mp3, int argc, char **argv)       {mp3.repeatTrack(argValue(argc, argv, 1, 1));             return -1;}
+static long cmdLoop(DFPlayer &mp3, int argc, char **argv)         {mp3.repeatCurrentTrack(argEnable(argc, argv, 1));        return -1;}
+static long cmdRepeatAll(DFPlayer &mp3, int argc, char **argv)    {mp3.repeatAll(argEnable(argc, argv, 1));                 return -1;}
+static long cmdRepeatFolder(DFPlayer &mp3, int argc, char **argv) {mp3.repeatFolder(argValue(argc, argv, 1, 1));            return -1;}
+static long cmdRandom(DFPlayer &mp3, int, char **)                {mp3.randomAll();                                         return -1;}
+static long cmdTrigger(DFPlayer &mp3, int, char **)               {mp3.trigger();                                           return -1;}
+
+static long cmdSetTrigger(DFPlayer &mp3, int argc, char **argv)
+{
+  mp3.setTrigger(argValue(argc, argv, 1, 1), argValue(argc, argv, 2, 1));
+
+  return -1;
+}
+
+/* settings */
+static long cmdVolume(DFPlayer &mp3, int argc, char **argv)       {mp3.setVolume(argValue(argc, argv, 1, 15));              return -1;}
+static long cmdVolumeUp(DFPlayer &mp3, int, char **)              {mp3.volumeUp();                                          return -1;}
+static long cmdVolumeDown(DFPlayer &mp3, int, char **)            {mp3.volumeDown();                                        return -1;}
+static long cmdEQ(DFPlayer &mp3, int argc, char **argv)           {mp3.setEQ(argValue(argc, argv, 1, 0));                   return -1;}
+static long cmdDAC(DFPlayer &mp3, int argc, char **argv)          {mp3.enableDAC(argEnable(argc, argv, 1));                 return -1;}
+static long cmdSource(DFPlayer &mp3, int argc, char **argv)       {mp3.setSource(argValue(argc, argv, 1, 2));               return -1;}
+static long cmdSleep(DFPlayer &mp3, int, char **)                 {mp3.sleep();                                             return -1;}
+static long cmdWakeup(DFPlayer &mp3, int argc, char **argv)       {mp3.wakeup(argValue(argc, argv, 1, 2));                  return -1;}
+static long cmdStandby(DFPlayer &mp3, int argc, char **argv)      {mp3.enableStandby(argEnable(argc, argv, 1));             return -1;}
+static long cmdReset(DFPlayer &mp3, int, char **)                 {mp3.reset();                                             return -1;}
+
+/* read commands */
+static long cmdStatus(DFPlayer &mp3, int, char **)                {return mp3.getStatus();}
+static long cmdGetVolume(DFPlayer &mp3, int, char **)             {return mp3.getVolume();}
+static long cmdGetEQ(DFPlayer &mp3, int, char **)                 {return mp3.getEQ();}
+static long cmdGetPlayMode(DFPlayer &mp3, int, char **)           {return mp3.getPlayMode();}
+static long cmdGetVersion(DFPlayer &mp3, int, char **)            {return mp3.getVersion();}
+static long cmdGetTotalFolders(DFPlayer &mp3, int, char **)       {return mp3.getTotalFolders();}
+static long cmdGetCommandStatus(DFPlayer &mp3, int, char **)      {return mp3.getCommandStatus();}
+
+static long cmdGetTotalTracksFolder(DFPlayer &mp3, int argc, char **argv)
+{
+  return mp3.getTotalTracksFolder(argValue(argc, argv, 1, 1));
+}
+
+static long cmdGetTotalTracks(DFPlayer &mp3, int argc, char **argv)
+{
+  switch (argSource(argc, argv, 1))
+  {
+    case 'u': return mp3.getTotalTracksUSB();
+    case 'f': return mp3.getTotalTracksNORFlash();
+    default : return mp3.getTotalTracksSD();
+  }
+}
+
+static long cmdGetTrack(DFPlayer &mp3, int argc, char **argv)
+{
+  switch (argSource(argc, argv, 1))
+  {
+    case 'u': return mp3.getTrackUSB();
+    case 'f': return mp3.getTrackNORFlash();
+    default : return mp3.getTrackSD();
+  }
+}
+
+/* library configuration */
+static long cmdModel(DFPlayer &mp3, int argc, char **argv)
+{
+  const CLI_PROFILE *entry = findProfile((argc > 1) ? argv[1] : "mini");
+
+  if (entry == NULL) {printf("unknown profile, use " CLI_PROFILE_NAMES "\n"); return -1;}
+
+  mp3.setProfile(*entry->profile);
+
+  return -1;
+}
+
+static long cmdCalibrate(DFPlayer &mp3, int argc, char **argv)
+{
+  static DFPLAYER_PROFILE profile;                                //not copied by "setProfile()", must stay alive
+
+  const CLI_PROFILE *entry = findProfile((argc > 1) ? argv[1] : "mini");
+
+  if (entry == NULL) {printf("unknown profile, use " CLI_PROFILE_NAMES "\n"); return -1;}
+
+  profile = *entry->profile;
+
+  mp3.setProfile(profile);
+
+  return mp3.calibrateGap(profile);
+}
+
+static long cmdTimeout(DFPlayer &mp3, int argc, char **argv)      {mp3.setTimeout(argValue(argc, argv, 1, DFPLAYER_CMD_DELAY)); return -1;}
+static long cmdFeedback(DFPlayer &mp3, int argc, char **argv)     {mp3.setFeedback(argEnable(argc, argv, 1));               return -1;}
+static long cmdNonBlocking(DFPlayer &mp3, int argc, char **argv)  {mp3.setNonBlocking(argEnable(argc, argv, 1));            return -1;}
+static long cmdIdle(DFPlayer &mp3, int argc, char **argv)         {mp3.setIdleTimeout(argValue(argc, argv, 1, 0));          return -1;}
+static long cmdUpdate(DFPlayer &mp3, int, char **)                {return (long)mp3.update();}
+static long cmdPowerState(DFPlayer &mp3, int, char **)            {return mp3.getPowerState();}
+static long cmdTriggerLatency(DFPlayer &mp3, int, char **)        {return (long)mp3.getTriggerLatency();}
+
+static long cmdWait(DFPlayer &mp3, int argc, char **argv)
+{
+  unsigned long waitTime  = argValue(argc, argv, 1, 1000);
+  unsigned long startTime = millis();
+
+  while ((millis() - startTime) < waitTime)
+  {
+    mp3.update();
+
+    delay(1);
+  }
+
+  return -1;
+}
+
+
+static const CLI_COMMAND commands[] =
+{
+  {"play",         "playTrack",            cmdPlay,                 "play <track> | play <folder> <track>"},
+  {"mp3",          "playMP3Folder",        cmdMP3,                  "mp3 <track>"},
+  {"advert",       "playAdvertFolder",     cmdAdvert,               "advert <track>"},
+  {"next",         "next",                 cmdNext,                 "next"},
+  {"prev",         "previous",             cmdPrevious,             "prev"},
+  {"pause",        "pause",                cmdPause,                "pause"},
+  {"resume",       "resume",               cmdResume,               "resume"},
+  {"stop",         "stop",                 cmdStop,                 "stop"},
+  {"repeat",       "repeatTrack",          cmdRepeat,               "repeat <track>"},
+  {"loop",         "repeatCurrentTrack",   cmdLoop,                 "loop on|off"},
+  {"repeatall",    "repeatAll",            cmdRepeatAll,            "repeatall on|off"},
+  {"repeatfolder", "repeatFolder",         cmdRepeatFolder,         "repeatfolder <folder>"},
+  {"random",       "randomAll",            cmdRandom,               "random"},
+  {"settrigger",   "setTrigger",           cmdSetTrigger,           "settrigger <folder> <track>"},
+  {"trigger",      "trigger",              cmdTrigger,              "trigger"},
+  {"vol",          "setVolume",            cmdVolume,               "vol <0..30>"},
+  {"volup",        "volumeUp",             cmdVolumeUp,             "volup"},
+  {"voldown",      "volumeDown",           cmdVolumeDown,           "voldown"},
+  {"eq",           "setEQ",                cmdEQ,                   "eq <0..5>"},
+  {"dac",          "enableDAC",            cmdDAC,                  "dac on|off"},
+  {"source",       "setSource",            cmdSource,               "source <1..6>"},
+  {"sleep",        "sleep",                cmdSleep,                "sleep"},
+  {"wakeup",       "wakeup",               cmdWakeup,               "wakeup [source]"},
+  {"standby",      "enableStandby",        cmdStandby,              "standby on|off"},
+  {"reset",        "reset",                cmdReset,                "reset"},
+  {"status",       "getStatus",            cmdStatus,               "status"},
+  {"getvol",       "getVolume",            cmdGetVolume,            "getvol"},
+  {"geteq",        "getEQ",                cmdGetEQ,                "geteq"},
+  {"mode",         "getPlayMode",          cmdGetPlayMode,          "mode"},
+  {"version",      "getVersion",           cmdGetVersion,           "version"},
+  {"tracks",       "getTotalTracksSD",     cmdGetTotalTracks,       "tracks [sd|usb|flash]"},
+  {"track",        "getTrackSD",           cmdGetTrack,             "track [sd|usb|flash]"},
+  {"foldertracks", "getTotalTracksFolder", cmdGetTotalTracksFolder, "foldertracks <folder>"},
+  {"folders",      "getTotalFolders",      cmdGetTotalFolders,      "folders"},
+  {"cmdstatus",    "getCommandStatus",     cmdGetCommandStatus,     "cmdstatus"},
+  {"model",        "setModel",             cmdModel,                "model " CLI_PROFILE_NAMES ", set built-in profile"},
+  {"calibrate",    "calibrateGap",         cmdCalibrate,            "calibrate " CLI_PROFILE_NAMES ", print write delay"},
+  {"timeout",      "setTimeout",           cmdTimeout,              "timeout <msec>"},
+  {"feedback",     "setFeedback",          cmdFeedback,             "feedback on|off"},
+  {"nonblocking",  "setNonBlocking",       cmdNonBlocking,          "nonblocking on|off"},
+  {"idle",         "setIdleTimeout",       cmdIdle,                 "idle <msec>, 0=disable power manager"},
+  {"update",       "update",               cmdUpdate,               "update, print next deadline"},
+  {"power",        "getPowerState",        cmdPowerState,           "power, 0=active, 1=waking up, 2=standby"},
+  {"latency",      "getTriggerLatency",    cmdTriggerLatency,       "latency, last trigger latency in usec"},
+  {"wait",         "wait",                 cmdWait,                 "wait <msec>, call update() meanwhile"}
+};
+
+
+/**************************************************************************/
+/*
+    findCommand()
+
+    Find command by short name or library API name, case insensitive
+*/
+/**************************************************************************/
+static const CLI_COMMAND *findCommand(const char *name)
+{
+  for (size_t i = 0; i < (sizeof(commands) / sizeof(commands[0])); i++)
+  {
+    if ((strcasecmp(name, commands[i].name) == 0) || (strcasecmp(name, commands[i].alias) == 0)) {return &commands[i];}
+  }
+
+  return NULL;
+}
+
+
+/**************************************************************************/
+/*
+    runCommand()
+
+    Run command once, print result, elapsed time & traffic
+*/
+/**************************************************************************/
+static void runCommand(DFPlayer &mp3, const CLI_COMMAND *command, int argc, char **argv)
+{
+  logStream->resetCounters();
+
+  unsigned long startTime = micros();
+  long          result    = command->handler(mp3, argc, argv);
+  unsigned long elapsed   = micros() - startTime;
+
+  logStream->flushLog();
+
+  if (result >= 0) {printf("%s = %ld", command->name, result);}
+  else             {printf("%s", command->name);}
+
+  printf(" (%.3f msec, TX %u bytes, RX %u bytes)\n", elapsed / 1000.0, logStream->getTxBytes(), logStream->getRxBytes());
+}
+
+
+/**************************************************************************/
+/*
+    runBench()
+
+    Run command "count" times, print latency statistics & frames per
+    operation
+
+    NOTE:
+    - raw frames aren't printed during benchmark
+*/
+/**************************************************************************/
+static void runBench(DFPlayer &mp3, int argc, char **argv)
+{
+  const CLI_COMMAND *command = (argc > 1) ? findCommand(argv[1]) : NULL;
+  long               count   = argValue(argc, argv, 2, 100);
+
+  if ((command == NULL) || (count <= 0))
+  {
+    printf("usage: bench <command> <count> [args]\n");
+    return;
+  }
+
+  std::vector<unsigned long> latency;
+
+  latency.reserve(count);
+
+  logStream->setEcho(false);
+  logStream->resetCounters();
+
+  for (long i = 0; i < count; i++)
+  {
+    unsigned long startTime = micros();
+
+    command->handler(mp3, argc - 2, argv + 2);
+
+    latency.push_back(micros() - startTime);
+  }
+
+  logStream->setEcho(true);
+
+  std::sort(latency.begin(), latency.end());
+
+  printf("bench %s x%ld: min %.3f, median %.3f, p99 %.3f, max %.3f msec, %.2f TX frames/op, %.2f RX frames/op, %.2f write calls/op\n",
+         command->alias, count,
+         latency.front() / 1000.0, latency[count / 2] / 1000.0, latency[(count * 99) / 100] / 1000.0, latency.back() / 1000.0,
+         (double)logStream->getTxBytes() / DFPLAYER_UART_FRAME_SIZE / count,
+         (double)logStream->getRxBytes() / DFPLAYER_UART_FRAME_SIZE / count,
+         (double)logStream->getTxCalls() / count);
+}
+
+
+/**************************************************************************/
+/*
+    runLine()
+
+    Split line into words & run it
+
+    NOTE:
+    - return false on "quit"
+*/
+/**************************************************************************/
+static bool runLine(DFPlayer &mp3, char *line)
+{
+  char *argv[CLI_MAX_ARGS];
+  int   argc = 0;
+
+  for (char *word = strtok(line, " \t\r\n"); (word != NULL) && (argc < CLI_MAX_ARGS); word = strtok(NULL, " \t\r\n"))
+  {
+    if (word[0] == '#') {break;} //comment
+
+    argv[argc++] = word;
+  }
+
+  if (argc == 0) {return true;}
+
+  if ((strcasecmp(argv[0], "quit") == 0) || (strcasecmp(argv[0], "exit") == 0)) {return false;}
+
+  if (strcasecmp(argv[0], "bench") == 0)
+  {
+    runBench(mp3, argc, argv);
+    return true;
+  }
+
+  if (strcasecmp(argv[0], "help") == 0)
+  {
+    for (size_t i = 0; i < (sizeof(commands) / sizeof(commands[0])); i++) {printf("  %-40s %s()\n", commands[i].help, commands[i].alias);}
+
+    printf("  %-40s\n  %-40s\n", "bench <command> <count> [args]", "quit");
+    return true;
+  }
+
+  const CLI_COMMAND *command = findCommand(argv[0]);
+
+  if (command == NULL) {printf("unknown command \"%s\", type \"help\"\n", argv[0]);}
+  else                 {runCommand(mp3, command, argc, argv);}
+
+  return true;
+}
+
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-m <profile>] [-t timeout] [-f] [-b] [-q] <tty> [script]\n", name);
+  fprintf(stderr, "       %s -e <profile> [-m <profile>] [-t timeout] [-f] [-b] [-q] [script]\n", name);
+  fprintf(stderr, "       profile: " CLI_PROFILE_NAMES "\n");
+}
+
+
+int main(int argc, char **argv)
+{
+  const CLI_PROFILE   *model     = NULL;                //"-m" profile
+  const CLI_PROFILE   *emulated  = NULL;                //"-e" profile
+  uint16_t             timeout   = DFPLAYER_CMD_DELAY;
+  bool                 feedback  = false;
+  bool                 bootDelay = false;
+  bool                 quiet     = false;
+  DFPlayerEmulator    *module    = NULL;
+  TtyStream            tty;
+  int                  option;
+
+  while ((option = getopt(argc, argv, "e:m:t:fbq")) != -1)
+  {
+    switch (option)
+    {
+      case 'e': emulated  = findProfile(optarg);      if (emulated == NULL) {usage(argv[0]); return 2;} break;
+      case 'm': model     = findProfile(optarg);      if (model    == NULL) {usage(argv[0]); return 2;} break;
+      case 't': timeout   = strtol(optarg, NULL, 0); break;
+      case 'f': feedback  = true;                    break;
+      case 'b': bootDelay = true;                    break;
+      case 'q': quiet     = true;                    break;
+
+      default:
+        usage(argv[0]);
+        return 2;
+    }
+  }
+
+  if ((emulated == NULL) && (optind >= argc))
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  if (emulated != NULL)
+  {
+    module = new DFPlayerEmulator(emulated->chip);
+
+    if (model == NULL) {model = emulated;}
+  }
+  else
+  {
+    if (tty.begin(argv[optind]) == false)
+    {
+      perror(argv[optind]);
+      return 1;
+    }
+
+    optind++;                  //script follows <tty>
+  }
+
+  FILE *script = stdin;
+
+  if ((optind < argc) && ((script = fopen(argv[optind], "r")) == NULL))
+  {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  LogStream log((module != NULL) ? (Stream &)*module : (Stream &)tty, stdout);
+  DFPlayer  mp3;
+
+  logStream = &log;
+
+  log.setEcho(!quiet);
+
+  mp3.begin(log, timeout, DFPLAYER_MINI, feedback, bootDelay);
+
+  if (model != NULL) {mp3.setProfile(*model->profile);}     //built-in profile, stays alive
+
+  char line[256];
+  bool prompt = (script == stdin) && isatty(STDIN_FILENO);
+
+  while (true)
+  {
+    if (prompt == true) {printf("> "); fflush(stdout);}
+
+    if (fgets(line, sizeof(line), script) == NULL) {break;}
+
+    if (runLine(mp3, line) == false) {break;}
+
+    fflush(stdout);
+  }
+
+  if (script != stdin) {fclose(script);}
+
+  delete module;
+
+  return 0;
+}
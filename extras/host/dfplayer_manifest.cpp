@@ -0,0 +1,339 @@
+/***************************************************************************************************/
+/*
+   This is a Linux media manifest generator for DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - scans SD card tree & writes C++ header with constexpr named track
+     numbers, sketch calls "playFolder(media::folder07::FOLDER, media::folder07::DOOR_BELL)"
+     instead of "playFolder(7, 23)"
+   - card is indexed by module emulator like the chip does, see
+     "DFPlayerEmulator::mount()", root tracks are numbered in FAT write
+     order, scan the card itself or loop mounted image for valid numbers
+   - name is taken from file name after leading number, "023 - Door bell.mp3"
+     is DOOR_BELL = 23, file without name gets TRACK_023
+   - header has per-folder track counts & content hash of card counts,
+     "DFPlayer::verifyManifest(media::MANIFEST)" checks card at boot, see
+     "DFPlayer::hashManifest()"
+   - "-d" adds MP3 durations of root, "01".."99" & "mp3" tracks, preloaded
+     into duration table by "verifyManifest()"
+
+   usage: dfplayer_manifest [-o header] [-n namespace] [-d] <card directory>
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Emulator.h"
+#include "MP3Duration.h"
+#include "DFPlayer.h"
+
+
+#define MANIFEST_MAX_FOLDER 99 //last numbered folder
+
+
+/* named track of one folder namespace */
+typedef struct
+{
+  std::string name;
+  uint16_t    track;
+  std::string file;
+}
+MANIFEST_TRACK;
+
+
+/**************************************************************************/
+/*
+    countFolders()
+
+    Get number of folders in card root, same as module "getTotalFolders()"
+
+    NOTE:
+    - every folder is counted, including "mp3", "advert" & not numbered
+      ones, see "DFPlayerEmulator::mount()"
+*/
+/**************************************************************************/
+static uint8_t countFolders(const char *path)
+{
+  DIR *directory = opendir(path);
+
+  if (directory == NULL) {return 0;}
+
+  uint16_t count = 0;
+
+  for (struct dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory))
+  {
+    if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {continue;}
+
+    std::string entryPath = std::string(path) + "/" + entry->d_name;
+    struct stat info;
+
+    if ((stat(entryPath.c_str(), &info) != 0) || (S_ISDIR(info.st_mode) == false)) {continue;}
+
+    DIR *folder = opendir(entryPath.c_str());
+
+    if (folder == NULL) {continue;}                //folder can't be listed & isn't indexed
+
+    closedir(folder);
+
+    count++;
+  }
+
+  closedir(directory);
+
+  return (count > 0xFF) ? 0xFF : count;
+}
+
+
+/**************************************************************************/
+/*
+    makeName()
+
+    Get C++ identifier from file name
+
+    NOTE:
+    - leading number, separators & extension are skipped, "023 - Door
+      bell.mp3" is DOOR_BELL, other characters are replaced by "_"
+*/
+/**************************************************************************/
+static std::string makeName(const std::string &path, uint16_t track)
+{
+  std::string fileName = path.substr(path.rfind('/') + 1);
+  size_t      end      = fileName.rfind('.');
+  size_t      start    = 0;
+
+  if (end == std::string::npos) {end = fileName.size();}
+
+  while ((start < end) && (isdigit((unsigned char)fileName[start]) != 0)) {start++;}
+
+  std::string name;
+
+  for (size_t i = start; i < end; i++)
+  {
+    unsigned char symbol = fileName[i];
+
+    if      (isalnum(symbol) != 0)                                       {name += toupper(symbol);}
+    else if ((name.empty() == false) && (name[name.size() - 1] != '_')) {name += '_';}
+  }
+
+  while ((name.empty() == false) && (name[name.size() - 1] == '_')) {name.erase(name.size() - 1);}
+
+  char number[16];
+
+  snprintf(number, sizeof(number), "TRACK_%03u", track);
+
+  if (name.empty() == true)              {return number;}
+  if (isdigit((unsigned char)name[0]) != 0) {return "T_" + name;}
+
+  return name;
+}
+
+
+/**************************************************************************/
+/*
+    addTrack()
+
+    Add file to folder namespace, duplicated name gets track number
+*/
+/**************************************************************************/
+static void addTrack(std::vector<MANIFEST_TRACK> &tracks, const EMULATOR_FILE &file)
+{
+  std::string fileName = file.path.substr(file.path.rfind('/') + 1);
+
+  if (fileName.compare(0, 2, "._") == 0) {return;} //macOS metadata, counted by module but never played
+
+  MANIFEST_TRACK entry = {makeName(file.path, file.track), file.track, fileName};
+
+  for (size_t i = 0; i < tracks.size(); i++)
+  {
+    if ((tracks[i].name != entry.name) && (entry.name != "FOLDER")) {continue;}
+
+    char suffix[8];
+
+    snprintf(suffix, sizeof(suffix), "_%03u", file.track);
+
+    entry.name += suffix;
+    break;
+  }
+
+  if (entry.name == "FOLDER") {entry.name += "_TRACK";}
+
+  tracks.push_back(entry);
+}
+
+
+static void printTracks(FILE *output, const char *space, const char *type, const std::vector<MANIFEST_TRACK> &tracks, int folder, const char *comment)
+{
+  size_t width = (folder >= 0) ? 6 : 0;                             //"FOLDER"
+
+  for (size_t i = 0; i < tracks.size(); i++) {width = std::max(width, tracks[i].name.size());}
+
+  fprintf(output, "  namespace %s //%s\n  {\n", space, comment);
+
+  if (folder >= 0) {fprintf(output, "    constexpr uint8_t %-*s = %d;\n\n", (int)width, "FOLDER", folder);}
+
+  for (size_t i = 0; i < tracks.size(); i++)
+  {
+    fprintf(output, "    constexpr %s %-*s = %u; //%s\n", type, (int)width, tracks[i].name.c_str(), tracks[i].track, tracks[i].file.c_str());
+  }
+
+  fprintf(output, "  }\n\n");
+}
+
+
+int main(int argc, char **argv)
+{
+  const char *outputPath = NULL;
+  const char *space      = "media";
+  bool        durations  = false;
+  int         option;
+
+  while ((option = getopt(argc, argv, "o:n:d")) != -1)
+  {
+    switch (option)
+    {
+      case 'o': outputPath = optarg; break;
+      case 'n': space      = optarg; break;
+      case 'd': durations  = true;   break;
+
+      default:
+        fprintf(stderr, "usage: %s [-o header] [-n namespace] [-d] <card directory>\n", argv[0]);
+        return 2;
+    }
+  }
+
+  if (optind >= argc)
+  {
+    fprintf(stderr, "usage: %s [-o header] [-n namespace] [-d] <card directory>\n", argv[0]);
+    return 2;
+  }
+
+  const char      *cardPath = argv[optind];
+  DFPlayerEmulator card;
+
+  if (card.mount(cardPath) == false)
+  {
+    fprintf(stderr, "can't open %s\n", cardPath);
+    return 1;
+  }
+
+  std::vector<MANIFEST_TRACK>    root, mp3, advert;
+  std::vector<MANIFEST_TRACK>    folders[MANIFEST_MAX_FOLDER + 1];
+  std::vector<DFPLAYER_DURATION> table;
+  uint8_t                        folderTracks[MANIFEST_MAX_FOLDER] = {0};
+  uint8_t                        lastFolder = 0;
+  uint32_t                       totalTracks = card.getTotalFiles();
+
+  for (uint32_t index = 0; index < totalTracks; index++)
+  {
+    const EMULATOR_FILE *file = card.getFile(index);
+
+    if ((file->folder >= 1) && (file->folder <= MANIFEST_MAX_FOLDER))
+    {
+      if (folderTracks[file->folder - 1] < 0xFF) {folderTracks[file->folder - 1]++;}
+      if (file->folder > lastFolder)             {lastFolder = file->folder;}
+    }
+
+    if (file->track == 0) {continue;}                                //no leading number, can't be played by number
+
+    if      (file->folder == DFPLAYER_FOLDER_ROOT)                    {addTrack(root, *file);}
+    else if (file->folder == DFPLAYER_FOLDER_MP3)                     {addTrack(mp3, *file);}
+    else if (file->folder == EMULATOR_FOLDER_ADVERT)                  {addTrack(advert, *file);}
+    else if (file->folder <= MANIFEST_MAX_FOLDER)                     {addTrack(folders[file->folder], *file);}
+    else                                                              {continue;} //"advert1".."advert9" & other folders
+
+    if ((durations == false) || (file->folder == EMULATOR_FOLDER_ADVERT)) {continue;}
+
+    uint32_t duration = mp3GetDuration(file->path.c_str());
+
+    if (duration == MP3_NO_DURATION) {continue;}
+
+    DFPLAYER_DURATION entry = {file->track, file->folder, 2, (uint16_t)((duration + 500) / 1000)}; //2=TF-Card, rounded to sec
+
+    if (entry.seconds != 0) {table.push_back(entry);}
+  }
+
+  uint8_t  folderCount = countFolders(cardPath);
+  uint16_t total       = (totalTracks > 0xFFFF) ? 0xFFFF : totalTracks;
+  uint32_t hash        = DFPlayer::hashManifest(total, folderCount, folderTracks, lastFolder);
+
+  FILE *output = stdout;
+
+  if ((outputPath != NULL) && ((output = fopen(outputPath, "w")) == NULL))
+  {
+    fprintf(stderr, "can't write %s\n", outputPath);
+    return 1;
+  }
+
+  std::string guard = space;
+
+  for (size_t i = 0; i < guard.size(); i++) {guard[i] = toupper((unsigned char)guard[i]);}
+
+  fprintf(output, "/* generated by dfplayer_manifest from \"%s\", don't edit, regenerate after card changes */\n\n", cardPath);
+  fprintf(output, "#ifndef %s_MANIFEST_h\n#define %s_MANIFEST_h\n\n#include <DFPlayer.h>\n\n\n", guard.c_str(), guard.c_str());
+  fprintf(output, "namespace %s\n{\n", space);
+
+  if (root.empty() == false) {printTracks(output, "root", "uint16_t", root, -1, "\"playTrack()\", FAT write order");}
+
+  for (uint8_t folder = 1; folder <= MANIFEST_MAX_FOLDER; folder++)
+  {
+    if (folders[folder].empty() == true) {continue;}
+
+    char name[16];
+
+    snprintf(name, sizeof(name), "folder%02u", folder);
+
+    printTracks(output, name, "uint8_t", folders[folder], folder, "\"playFolder()\"");
+  }
+
+  if (mp3.empty() == false)    {printTracks(output, "mp3", "uint16_t", mp3, -1, "\"playMP3Folder()\"");}
+  if (advert.empty() == false) {printTracks(output, "advert", "uint16_t", advert, -1, "\"playAdvertFolder()\"");}
+
+  fprintf(output, "  constexpr uint16_t TOTAL_TRACKS = %u; //\"getTotalTracksSD()\"\n", total);
+  fprintf(output, "  constexpr uint8_t  FOLDERS      = %u; //\"getTotalFolders()\"\n\n", folderCount);
+
+  fprintf(output, "  constexpr uint8_t  FOLDER_TRACKS[] = {");
+
+  for (uint8_t folder = 1; folder <= lastFolder; folder++) {fprintf(output, (folder == 1) ? "%u" : ", %u", folderTracks[folder - 1]);}
+
+  if (lastFolder == 0) {fprintf(output, "0");}                        //zero-size array isn't allowed
+
+  fprintf(output, "}; //tracks in folders 01..%02u\n", lastFolder);
+
+  if (table.empty() == false)
+  {
+    fprintf(output, "\n  constexpr DFPLAYER_DURATION DURATIONS[] = //track, folder, source, seconds\n  {\n");
+
+    for (size_t i = 0; i < table.size(); i++)
+    {
+      fprintf(output, "    {%u, %u, %u, %u}%s\n", table[i].track, table[i].folder, table[i].source, table[i].seconds, (i + 1 < table.size()) ? "," : "");
+    }
+
+    fprintf(output, "  };\n");
+  }
+
+  fprintf(output, "\n  constexpr DFPLAYER_MANIFEST MANIFEST = {0x%08X, TOTAL_TRACKS, FOLDERS, %u, FOLDER_TRACKS, %s, %u}; //see \"DFPlayer::verifyManifest()\"\n}\n\n#endif\n",
+          hash, lastFolder, (table.empty() == true) ? "NULL" : "DURATIONS", (unsigned)table.size());
+
+  if (output != stdout) {fclose(output);}
+
+  fprintf(stderr, "%u tracks, %u folders, hash 0x%08X\n", total, folderCount, hash);
+
+  return 0;
+}
@@ -0,0 +1,304 @@
+/***************************************************************************************************/
+/*
+   This is a Linux multi-instance scaling benchmark for DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - N emulated modules on independent virtual UARTs, every module has own
+     DFPlayer object in non-blocking mode, all of them are serviced by one
+     "update()" loop like on single MCU
+   - every player gets random command every "-i" msec: volume, EQ,
+     playlist or blocking query with "-q" percent probability, blocking
+     query stalls the whole loop like it does on MCU
+   - prints one JSON line per number of players:
+     - throughput, commands received by all modules per second
+     - per-player p99 latency from "setVolume()" until module applied it,
+       median & worst of all players, in usec
+     - host CPU time per "update()" call, in nsec, serial reads included
+     - RAM per instance, sizeof(DFPlayer), serial buffers aren't included
+   - without "-p" number of players is swept 1, 2, 4..64, "-p" runs one
+     number of players, e.g. to profile with "perf record ./dfplayer_scale -p 64"
+
+   usage: dfplayer_scale [-p players] [-t seconds] [-i interval] [-q percent] [-m mini|hw247a] [-f] [-s seed]
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Emulator.h"
+#include "DFPlayer.h"
+
+
+#define SCALE_MAX_PLAYERS 64         //max number of emulated modules
+#define SCALE_BUSY_PIN    2          //emulated BUSY-pin of the first module, next modules use next pins
+
+
+typedef struct
+{
+  DFPlayerEmulator     *module;
+  DFPlayer             *mp3;
+  uint32_t              nextCommand; //time of next command, in msec
+  int16_t               volume;      //volume waiting to be applied by module, -1=none
+  uint32_t              volumeTime;  //time when "setVolume()" was called, in usec
+  std::vector<uint32_t> latency;     //"setVolume()" latency, in usec
+}
+SCALE_PLAYER;
+
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom(uint32_t range)
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+
+  return randomState % range;
+}
+
+
+static uint64_t cpuTimeNs()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+
+  return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+
+/**************************************************************************/
+/*
+    timerOverhead()
+
+    Get CPU time of empty "cpuTimeNs()" pair, in nsec, it's subtracted from
+    every measured loop
+*/
+/**************************************************************************/
+static uint64_t timerOverhead()
+{
+  uint64_t best = UINT64_MAX;
+
+  for (uint16_t i = 0; i < 1000; i++)
+  {
+    uint64_t startTime = cpuTimeNs();
+    uint64_t elapsed   = cpuTimeNs() - startTime;
+
+    if (elapsed < best) {best = elapsed;}
+  }
+
+  return best;
+}
+
+
+static double percentile(std::vector<uint32_t> &samples, uint8_t percent)
+{
+  if (samples.empty() == true) {return 0;}
+
+  std::sort(samples.begin(), samples.end());
+
+  return samples[(samples.size() * percent) / 100];
+}
+
+
+/**************************************************************************/
+/*
+    sendCommand()
+
+    Send random command to one player
+*/
+/**************************************************************************/
+static void sendCommand(SCALE_PLAYER &player, uint8_t queryPercent)
+{
+  if (nextRandom(100) < queryPercent)
+  {
+    player.mp3->getStatus();                        //blocking, whole loop waits
+    return;
+  }
+
+  switch (nextRandom(10))
+  {
+    case 0:
+    case 1:
+      player.mp3->setEQ(nextRandom(6));
+      break;
+
+    case 2:
+    case 3:
+      player.mp3->playTrack(nextRandom(player.module->getTotalFiles()) + 1);
+      break;
+
+    case 4:
+      player.mp3->next();
+      break;
+
+    default:
+      if (player.volume < 0) {player.volumeTime = micros();} //new value replaces queued one, latency counts from the first
+
+      player.volume = nextRandom(31);
+
+      player.mp3->setVolume(player.volume);
+      break;
+  }
+}
+
+
+/**************************************************************************/
+/*
+    runPlayers()
+
+    Run "count" players for "seconds" of virtual time & print results
+*/
+/**************************************************************************/
+static void runPlayers(uint8_t count, uint32_t seconds, uint32_t interval, uint8_t queryPercent, EMULATOR_CHIP chip, DFPLAYER_MODULE_TYPE model, const char *chipName, bool feedback)
+{
+  static uint64_t overhead = timerOverhead();
+
+  std::vector<SCALE_PLAYER> players(count);
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    players[i].module      = new DFPlayerEmulator(chip);
+    players[i].mp3         = new DFPlayer();
+    players[i].nextCommand = millis() + nextRandom(interval);
+    players[i].volume      = -1;
+
+    players[i].module->setBusyPin(SCALE_BUSY_PIN + i);
+
+    players[i].mp3->begin(*players[i].module, DFPLAYER_CMD_DELAY, model, feedback, false);
+    players[i].mp3->setBusyPin(SCALE_BUSY_PIN + i);
+    players[i].mp3->setNonBlocking(true);
+
+    players[i].module->resetStats();
+  }
+
+  uint64_t cpuTime   = 0;
+  uint64_t updates   = 0;
+  uint32_t startTime = millis();
+
+  while ((millis() - startTime) < (seconds * 1000))
+  {
+    uint32_t timeNow = millis();
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if ((int32_t)(timeNow - players[i].nextCommand) < 0) {continue;}
+
+      players[i].nextCommand = timeNow + (interval / 2) + nextRandom(interval); //average "interval"
+
+      sendCommand(players[i], queryPercent);
+    }
+
+    uint64_t loopStart = cpuTimeNs();
+
+    for (uint8_t i = 0; i < count; i++) {players[i].mp3->update();}
+
+    uint64_t loopTime  = cpuTimeNs() - loopStart;
+
+    cpuTime += (loopTime > overhead) ? (loopTime - overhead) : 0;
+    updates += count;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if ((players[i].volume < 0) || (players[i].module->getVolume() != players[i].volume)) {continue;}
+
+      players[i].latency.push_back(micros() - players[i].volumeTime);
+      players[i].volume = -1;
+    }
+
+    delay(1);                                       //1kHz loop
+  }
+
+  uint32_t              frames = 0;
+  std::vector<uint32_t> playerP99;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    frames += players[i].module->getStats().frames;
+
+    playerP99.push_back(percentile(players[i].latency, 99));
+
+    delete players[i].mp3;
+    delete players[i].module;
+  }
+
+  double elapsed = (millis() - startTime) / 1000.0;
+  double worst   = *std::max_element(playerP99.begin(), playerP99.end());
+
+  printf("{\"chip\":\"%s\",\"players\":%u,\"seconds\":%.0f,\"frames\":%u,\"throughput_cps\":%.1f,\"p99_us_median\":%.0f,\"p99_us_max\":%.0f,\"update_ns\":%.0f,\"ram_per_player\":%u}\n",
+         chipName, count, elapsed, frames, frames / elapsed, percentile(playerP99, 50), worst, (updates != 0) ? ((double)cpuTime / updates) : 0,
+         (unsigned)sizeof(DFPlayer));
+
+  fflush(stdout);
+}
+
+
+int main(int argc, char **argv)
+{
+  long                 count        = 0;
+  long                 seconds      = 60;
+  long                 interval     = 500;
+  long                 queryPercent = 0;
+  EMULATOR_CHIP        chip         = EMULATOR_YX5200;
+  DFPLAYER_MODULE_TYPE model        = DFPLAYER_MINI;
+  const char          *chipName     = "mini";
+  bool                 feedback     = false;
+  int                  option;
+
+  while ((option = getopt(argc, argv, "p:t:i:q:m:fs:")) != -1)
+  {
+    switch (option)
+    {
+      case 'p': count        = strtol(optarg, NULL, 0);  break;
+      case 't': seconds      = strtol(optarg, NULL, 0);  break;
+      case 'i': interval     = strtol(optarg, NULL, 0);  break;
+      case 'q': queryPercent = strtol(optarg, NULL, 0);  break;
+      case 'f': feedback     = true;                     break;
+      case 's': randomState  = strtoul(optarg, NULL, 0); break;
+
+      case 'm':
+        if (strcasecmp(optarg, "hw247a") == 0)
+        {
+          chip     = EMULATOR_GD3200B;
+          model    = DFPLAYER_HW_247A;
+          chipName = "hw247a";
+        }
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-p players] [-t seconds] [-i interval] [-q percent] [-m mini|hw247a] [-f] [-s seed]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  if (randomState == 0) {randomState = 1;}
+
+  seconds      = constrain(seconds, 1, 86400);
+  interval     = constrain(interval, 1, 60000);
+  queryPercent = constrain(queryPercent, 0, 100);
+
+  hostSetVirtualTime(true);
+
+  if (count != 0)
+  {
+    runPlayers(constrain(count, 1, SCALE_MAX_PLAYERS), seconds, interval, queryPercent, chip, model, chipName, feedback);
+    return 0;
+  }
+
+  for (count = 1; count <= SCALE_MAX_PLAYERS; count *= 2) {runPlayers(count, seconds, interval, queryPercent, chip, model, chipName, feedback);}
+
+  return 0;
+}
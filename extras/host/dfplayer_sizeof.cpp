@@ -0,0 +1,68 @@
+/***************************************************************************************************/
+/*
+   This is a Linux per-instance RAM report for DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - built once per configuration by "make sizes", every build gets own
+     feature switches in CXXFLAGS & configuration name in SIZEOF_CONFIG
+   - prints one JSON line per configuration:
+     - sizeof(DFPlayer), RAM per instance
+     - shared bytes, duration table shared by all instances, see
+       DFPLAYER_SHARED_DURATIONS, & TX batch buffer, see DFPLAYER_TX_BATCH
+     - feature switches the library was built with
+   - exit code is 1 if sizeof(DFPlayer) is over SIZEOF_MAX or shared bytes
+     are over SHARED_MAX, bounds are set per configuration in Makefile
+
+   usage: dfplayer_sizeof
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <stdio.h>
+
+#include "DFPlayer.h"
+
+
+#ifndef SIZEOF_CONFIG
+#define SIZEOF_CONFIG "default"
+#endif
+
+#ifndef SIZEOF_MAX
+#define SIZEOF_MAX    0xFFFFFFFF //no bound
+#endif
+
+#ifndef SHARED_MAX
+#define SHARED_MAX    0xFFFFFFFF //no bound
+#endif
+
+
+int main()
+{
+  uint32_t sharedBytes = 0;
+
+  #if (DFPLAYER_DURATION_TABLE_SIZE != 0) && (DFPLAYER_SHARED_DURATIONS == 1)
+  sharedBytes = DFPLAYER_DURATION_TABLE_SIZE * sizeof(DFPLAYER_DURATION);
+  #endif
+
+  #if (DFPLAYER_TX_BATCH > 1)
+  sharedBytes += DFPLAYER_TX_BATCH * DFPLAYER_UART_FRAME_SIZE + sizeof(DFPlayer*) + sizeof(uint16_t);
+  #endif
+
+  printf("{\"config\":\"%s\",\"sizeof\":%u,\"shared_bytes\":%u,\"power_manager\":%u,\"trigger\":%u,\"transactions\":%u,\"config_restore\":%u,\"snapshot\":%u,\"half_duplex\":%u,\"calibration\":%u,\"tx_batch\":%u,\"queue_size\":%u,\"duration_table_size\":%u,\"shared_durations\":%u}\n",
+         SIZEOF_CONFIG, (unsigned)sizeof(DFPlayer), (unsigned)sharedBytes, DFPLAYER_POWER_MANAGER, DFPLAYER_TRIGGER, DFPLAYER_TRANSACTIONS, DFPLAYER_CONFIG_RESTORE, DFPLAYER_SNAPSHOT, DFPLAYER_HALF_DUPLEX, DFPLAYER_CALIBRATION, DFPLAYER_TX_BATCH, DFPLAYER_QUEUE_SIZE,
+         DFPLAYER_DURATION_TABLE_SIZE, DFPLAYER_SHARED_DURATIONS);
+
+  if ((sizeof(DFPlayer) > SIZEOF_MAX) || (sharedBytes > SHARED_MAX))
+  {
+    fprintf(stderr, "%s: sizeof %u, max %u, shared bytes %u, max %u\n", SIZEOF_CONFIG, (unsigned)sizeof(DFPlayer), (unsigned)SIZEOF_MAX, (unsigned)sharedBytes, (unsigned)SHARED_MAX);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,488 @@
+/***************************************************************************************************/
+/*
+   This is a Linux long-run soak test for DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - runs randomized workload against emulated module in virtual time:
+     playlists, volume & EQ changes, queries, pause/resume, resets, card
+     swaps, idle periods serviced by "update()", blocking & non-blocking
+     mode
+   - checks:
+     - settings drift, module volume/EQ differ from last requested after
+       queue is settled
+     - playback drift, library position differs from module position after
+       idle period, when all commands are sent & feedback is parsed
+     - query errors, query returned value different from module state
+     - queue starvation, write command delivered later than
+       SOAK_MAX_SETTLE after it was requested
+     - latency growth, blocking query p99 of the last 10% of queries is 2
+       times worse than of the first 10%, non-blocking query also waits
+       for queued commands & isn't measured
+     - memory growth, process RSS grows after the first 10% of run
+   - with "-w" run starts 1 minute before "millis()" wraparound, with "-W"
+     1 minute before "millis()" passes 2^31 & signed time differences
+     change sign, see "hostSetTimeOffset()", "millis_wrapped" is true if
+     the boundary was crossed
+   - with "-H aware" transport is half-duplex & library schedules TX around
+     RX frames, see "DFPlayer::setHalfDuplex()", with "-H blind" library
+     isn't told & collisions break frames, drift checks are off like with
+     faults
+   - every failed drift or query check is printed to stderr with step,
+     seed & action, JSON summary has step of the first one, -1=none,
+     checks that can't fail with faults or blind half-duplex aren't printed
+   - exit code is 1 if any check failed
+
+   usage: dfplayer_soak [-n commands] [-s seed] [-m mini|hw247a] [-f] [-w|-W] [-F rate] [-H aware|blind] [-d directory]
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Emulator.h"
+#include "FaultStream.h"
+#include "DFPlayer.h"
+
+
+#define SOAK_BUSY_PIN      2          //emulated BUSY-pin
+#define SOAK_MAX_SETTLE    5000       //max time to deliver queued commands, in msec
+#define SOAK_POSITION_DIFF 1000       //max difference between library & module position, in msec
+#define SOAK_QUIET_TIME    500        //time without commands for module feedback to arrive, in msec
+#define SOAK_WRAP_OFFSET   ((0x100000000ULL - 60000) * 1000) //"millis()" overflows 1 minute after start, in usec
+#define SOAK_SIGN_OFFSET   ((0x80000000ULL  - 60000) * 1000) //"millis()" passes 2^31 1 minute after start, in usec
+
+
+typedef struct
+{
+  uint32_t settingsDrift;
+  uint32_t playbackDrift;
+  uint32_t queryErrors;
+  uint32_t starvation;
+  uint32_t resets;
+  uint32_t cardSwaps;
+  uint32_t maxSettle;   //longest time to deliver queued commands, in msec
+  long     firstStep;   //step of first failed check, -1=none
+}
+SOAK_STATS;
+
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom(uint32_t range)
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+
+  return randomState % range;
+}
+
+
+/**************************************************************************/
+/*
+    report()
+
+    Print failed check with step, seed & action to reproduce it
+
+    NOTE:
+    - run with the same seed & options repeats the failure at the same step
+*/
+/**************************************************************************/
+static void report(SOAK_STATS &stats, const char *check, long step, uint32_t seed, uint32_t action, uint32_t expected, uint32_t actual)
+{
+  fprintf(stderr, "%s: step %ld, seed %u, action %u, expected %u, got %u\n", check, step, seed, action, expected, actual);
+
+  if (stats.firstStep < 0) {stats.firstStep = step;}
+}
+
+
+/**************************************************************************/
+/*
+    getHours()
+
+    Get virtual time since start of run, in hours
+
+    NOTE:
+    - "-w" & "-W" start offset isn't counted, see SOAK_WRAP_OFFSET
+*/
+/**************************************************************************/
+static double getHours(uint64_t offset)
+{
+  return (hostGetTime() - offset) / 3600000000.0;
+}
+
+
+static long getRSS()
+{
+  struct rusage usage;
+
+  getrusage(RUSAGE_SELF, &usage);
+
+  return usage.ru_maxrss; //in kbytes
+}
+
+
+/**************************************************************************/
+/*
+    settle()
+
+    Service library with "update()" like tickless sketch until module has
+    expected volume & EQ
+
+    NOTE:
+    - return time it took, in msec, or SOAK_MAX_SETTLE+1 on starvation
+*/
+/**************************************************************************/
+static uint32_t settle(DFPlayer &mp3, DFPlayerEmulator &module, uint8_t volume, uint8_t eq, bool checkEQ)
+{
+  uint32_t startTime = millis();
+
+  while ((module.getVolume() != volume) || ((checkEQ == true) && (module.getEQ() != eq)))
+  {
+    uint32_t elapsed = millis() - startTime;
+
+    if (elapsed > SOAK_MAX_SETTLE) {return SOAK_MAX_SETTLE + 1;}
+
+    uint32_t deadline = mp3.update();
+
+    delay((deadline < 10) ? deadline : 10);
+
+    if (deadline == 0) {delay(1);}
+  }
+
+  return millis() - startTime;
+}
+
+
+/**************************************************************************/
+/*
+    idle()
+
+    Service library with "update()" for specific time
+
+    NOTE:
+    - "update()" is called once more at the end, like RX-pin wakes up
+      tickless sketch, feedback received during last sleep is parsed
+      before checks
+*/
+/**************************************************************************/
+static void idle(DFPlayer &mp3, uint32_t time)
+{
+  uint32_t startTime = millis();
+
+  while ((millis() - startTime) < time)
+  {
+    uint32_t deadline = mp3.update();
+    uint32_t left     = time - (millis() - startTime);
+
+    delay(constrain(deadline, 1, left));
+  }
+
+  mp3.update();
+}
+
+
+/**************************************************************************/
+/*
+    quiet()
+
+    Service library with "update()" until module receives no commands for
+    SOAK_QUIET_TIME
+
+    NOTE:
+    - queued commands are sent & their feedback is parsed by library
+*/
+/**************************************************************************/
+static void quiet(DFPlayer &mp3, DFPlayerEmulator &module)
+{
+  uint32_t frames;
+
+  do
+  {
+    frames = module.getStats().frames;
+
+    idle(mp3, SOAK_QUIET_TIME);
+  }
+  while (module.getStats().frames != frames);
+}
+
+
+static double p99(std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last)
+{
+  if (first == last) {return 0;}
+
+  std::vector<uint32_t> samples(first, last);
+
+  std::sort(samples.begin(), samples.end());
+
+  return samples[(samples.size() * 99) / 100];
+}
+
+
+int main(int argc, char **argv)
+{
+  long                 count     = 1000000;
+  DFPLAYER_MODULE_TYPE model     = DFPLAYER_MINI;
+  EMULATOR_CHIP        chip      = EMULATOR_YX5200;
+  bool                 feedback  = false;
+  uint64_t             offset    = 0;                    //"-w" or "-W" start offset, in usec
+  float                faultRate = 0;
+  const char          *duplex    = NULL;                 //half-duplex transport, "aware" or "blind" library
+  const char          *mediaPath = NULL;
+  int                  option;
+
+  while ((option = getopt(argc, argv, "n:s:m:fwWF:H:d:")) != -1)
+  {
+    switch (option)
+    {
+      case 'n': count       = strtol(optarg, NULL, 0);  break;
+      case 's': randomState = strtoul(optarg, NULL, 0); break;
+      case 'f': feedback    = true;                     break;
+      case 'w': offset      = SOAK_WRAP_OFFSET;         break;
+      case 'W': offset      = SOAK_SIGN_OFFSET;         break;
+      case 'F': faultRate   = strtod(optarg, NULL);     break;
+      case 'H': duplex      = optarg;                   break;
+      case 'd': mediaPath   = optarg;                   break;
+
+      case 'm':
+        if (strcasecmp(optarg, "hw247a") == 0)
+        {
+          model = DFPLAYER_HW_247A;
+          chip  = EMULATOR_GD3200B;
+        }
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n commands] [-s seed] [-m mini|hw247a] [-f] [-w|-W] [-F rate] [-H aware|blind] [-d directory]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  if (randomState == 0) {randomState = 1;}
+
+  uint32_t seed = randomState;
+
+  hostSetVirtualTime(true);
+
+  hostSetTimeOffset(offset);
+
+  DFPlayerEmulator module(chip);
+  FaultStream      faults(module, randomState);
+  DFPlayer         mp3;
+
+  if ((mediaPath != NULL) && (module.mount(mediaPath) == false))
+  {
+    perror(mediaPath);
+    return 1;
+  }
+
+  module.setBusyPin(SOAK_BUSY_PIN);
+  faults.setFaultRate(faultRate);
+  faults.setHalfDuplex(duplex != NULL);
+
+  mp3.begin(faults, DFPLAYER_CMD_DELAY, model, feedback, false);
+  mp3.setBusyPin(SOAK_BUSY_PIN);
+
+  #if (DFPLAYER_HALF_DUPLEX == 1)
+  mp3.setHalfDuplex((duplex != NULL) && (strcasecmp(duplex, "aware") == 0));
+  #endif
+
+  bool strict = (faultRate == 0) && ((duplex == NULL) || (strcasecmp(duplex, "aware") == 0)); //drift is expected with faults & blind half-duplex
+
+  SOAK_STATS            stats;
+  std::vector<uint32_t> latency;                        //blocking query latency, in usec
+  uint8_t               volume    = module.getVolume(); //expected module state
+  uint8_t               eq        = module.getEQ();
+  bool                  checkEQ   = mp3.isSupported(DFPLAYER_SET_EQ);
+  bool                  volumeSet = false;              //volume sent by library, restored after reset
+  bool                  eqSet     = false;
+  long                  rssStart  = 0;
+  uint32_t              startTime = millis();
+
+  memset(&stats, 0x00, sizeof(stats));
+
+  stats.firstStep = -1;
+
+  for (long i = 0; i < count; i++)
+  {
+    bool nonBlocking = ((i / 10000) % 2) != 0;            //alternate blocking & non-blocking periods
+
+    if ((i % 10000) == 0) {mp3.setNonBlocking(nonBlocking);}
+
+    if (i == (count / 10)) {rssStart = getRSS();}
+
+    if ((i != 0) && ((i % 100000) == 0)) {fprintf(stderr, "%ld commands, %.1f hours virtual time\n", i, getHours(offset));}
+
+    uint32_t total  = module.getTotalFiles();
+    uint32_t action = nextRandom(1000);
+
+    if (action < 250)                                      //playlist
+    {
+      switch (nextRandom(6))
+      {
+        case 0:  if (total != 0) {mp3.playTrack(nextRandom(total) + 1);} break;
+        case 1:  mp3.playFolder(nextRandom(10) + 1, nextRandom(20) + 1); break;
+        case 2:  mp3.next();                                               break;
+        case 3:  mp3.previous();                                           break;
+        case 4:  mp3.pause();                                              break;
+        default: mp3.resume();                                             break;
+      }
+    }
+    else if (action < 450)                                 //volume
+    {
+      switch (nextRandom(3))
+      {
+        case 0:  volume = nextRandom(31); volumeSet = true; mp3.setVolume(volume); break;
+        case 1:  if (volume < 30) {volume++;} mp3.volumeUp();    break;
+        default: if (volume > 0)  {volume--;} mp3.volumeDown();  break;
+      }
+    }
+    else if ((action < 500) && (checkEQ == true))          //EQ
+    {
+      eq    = nextRandom(6);
+      eqSet = true;
+
+      mp3.setEQ(eq);
+    }
+    else if (action < 750)                                 //query, compared to module state
+    {
+      uint32_t queryTime = micros();
+      uint8_t  expected  = 0;
+      uint8_t  actual    = 0;
+
+      switch (nextRandom(3))
+      {
+        case 0:  actual = mp3.getVolume(); expected = module.getVolume();                     break;
+        case 1:  if (checkEQ == true) {actual = mp3.getEQ(); expected = module.getEQ();}      break;
+        default: mp3.getStatus();                                                             break;
+      }
+
+      if (actual != expected)
+      {
+        stats.queryErrors++;
+
+        if (strict == true) {report(stats, "query error", i, seed, action, expected, actual);}
+      }
+
+      if (nonBlocking == false) {latency.push_back(micros() - queryTime);}
+    }
+    else if (action < 752)                                 //reset, module restores defaults & library restores sent settings
+    {
+      mp3.reset();
+
+      #if (DFPLAYER_CONFIG_RESTORE == 1)
+      if (volumeSet == false) {volume = DFPLAYER_DEFAULT_VOLUME;}
+      if (eqSet == false)     {eq     = 0;}
+      #else
+      volume = DFPLAYER_DEFAULT_VOLUME;
+      eq     = 0;
+      #endif
+
+      idle(mp3, DFPLAYER_BOOT_DELAY);                     //commands wait for full boot time, back-to-back resets would exceed SOAK_MAX_SETTLE
+      stats.resets++;
+    }
+    else if (action < 753)                                 //card swap
+    {
+      module.setCardInserted(false);
+      idle(mp3, 200);
+
+      module.setTracks(nextRandom(200), nextRandom(20), nextRandom(255) + 1, nextRandom(100));
+      module.setCardInserted(true);
+      idle(mp3, 500);
+
+      stats.cardSwaps++;
+    }
+    else                                                   //idle, tickless loop
+    {
+      idle(mp3, 100 + nextRandom(3000));                   //enough for module feedback to arrive
+    }
+
+    /* settle & compare library cache with module */
+    uint32_t settleTime = settle(mp3, module, volume, eq, checkEQ);
+
+    if (settleTime > SOAK_MAX_SETTLE)
+    {
+      if (strict == true) {stats.starvation++;}
+
+      stats.settingsDrift++;
+
+      if (strict == true) {report(stats, "settings drift", i, seed, action, volume, module.getVolume());}
+
+      volume = module.getVolume(); //resync expectation, keep counting new drifts only
+      eq     = module.getEQ();
+    }
+    else if (settleTime > stats.maxSettle)
+    {
+      stats.maxSettle = settleTime;
+    }
+
+    if (action < 753) {continue;}                          //compare playback only after idle
+
+    quiet(mp3, module);                                    //last queued command may be sent at the end of idle
+
+    uint32_t libPosition = mp3.getPosition();
+    uint32_t modPosition = module.getPosition();
+
+    if ((libPosition != 0) && (module.getState() == EMULATOR_PLAYING))
+    {
+      uint32_t difference = (libPosition > modPosition) ? (libPosition - modPosition) : (modPosition - libPosition);
+
+      if (difference > SOAK_POSITION_DIFF)
+      {
+        stats.playbackDrift++;
+
+        if (strict == true) {report(stats, "playback drift", i, seed, action, modPosition, libPosition);}
+      }
+    }
+    else if ((libPosition != 0) && (module.getState() == EMULATOR_STOP))
+    {
+      idle(mp3, SOAK_QUIET_TIME);                          //track may have just finished, feedback is on the way
+
+      if ((mp3.getPosition() != 0) && (module.getState() == EMULATOR_STOP))  //library thinks track is still playing
+      {
+        stats.playbackDrift++;
+
+        if (strict == true) {report(stats, "playback drift", i, seed, action, 0, mp3.getPosition());}
+      }
+    }
+  }
+
+  size_t window   = latency.size() / 10;
+  double firstP99 = p99(latency.begin(), latency.begin() + window);
+  double lastP99  = p99(latency.end() - window, latency.end());
+  long   rssEnd   = getRSS();
+  bool   wrapped  = ((offset == SOAK_WRAP_OFFSET) && (millis() < startTime)) || ((offset == SOAK_SIGN_OFFSET) && ((int32_t)millis() < 0));
+
+  bool failed = (stats.starvation != 0) || ((strict == true) && ((stats.settingsDrift != 0) || (stats.playbackDrift != 0) || (stats.queryErrors != 0))) ||
+                ((firstP99 != 0) && (lastP99 > (2 * firstP99))) || (rssEnd > (rssStart + 1024));
+
+  uint32_t collisionsAvoided = 0;
+  uint32_t framesLost        = 0;
+
+  #if (DFPLAYER_HALF_DUPLEX == 1)
+  collisionsAvoided = mp3.getCollisionsAvoided();
+  framesLost        = mp3.getFramesLost();
+  #endif
+
+  printf("{\"commands\":%ld,\"seed\":%u,\"virtual_hours\":%.1f,\"millis_wrapped\":%s,\"settings_drift\":%u,\"playback_drift\":%u,\"query_errors\":%u,\"starvation\":%u,"
+         "\"max_settle_ms\":%u,\"resets\":%u,\"card_swaps\":%u,\"query_p99_first_us\":%.0f,\"query_p99_last_us\":%.0f,\"rss_start_kb\":%ld,\"rss_end_kb\":%ld,"
+         "\"tx_collisions\":%u,\"collisions_avoided\":%u,\"frames_lost\":%u,\"first_failed_step\":%ld,\"result\":\"%s\"}\n",
+         count, seed, getHours(offset), (wrapped == true) ? "true" : "false",
+         stats.settingsDrift, stats.playbackDrift, stats.queryErrors, stats.starvation, stats.maxSettle, stats.resets, stats.cardSwaps,
+         firstP99, lastP99, rssStart, rssEnd, faults.getStats().collisions, collisionsAvoided, framesLost, stats.firstStep, (failed == true) ? "FAIL" : "PASS");
+
+  return (failed == true) ? 1 : 0;
+}
@@ -0,0 +1,1507 @@
+/***************************************************************************************************/
+/*
+   This is a Linux regression test for DFPlayer library
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - every test runs library against fresh emulated module in virtual time,
+     results are repeatable & don't depend on host load
+   - prints one line per test, failed check is printed with its line
+   - exit code is 1 if any test failed
+
+   usage: dfplayer_test [test name]
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Emulator.h"
+#include "FaultStream.h"
+#include "DFPlayer.h"
+#include "DFPlayerDeck.h"
+
+
+#define TEST_BUSY_PIN 2    //emulated BUSY-pin
+#define TEST_BUSY_PIN_B 3  //emulated BUSY-pin of second module
+#define TEST_BUSY_PIN_LAG 4 //BUSY-pin driven by test, lags behind module
+#define TEST_TIMEOUT  5000 //max time to wait for emulated module, in msec
+
+#define CHECK(condition) do {if ((condition) == false) {fprintf(stderr, "  %s:%d: %s\n", __FILE__, __LINE__, #condition); return false;}} while (0)
+
+
+typedef struct
+{
+  const char *name;
+  bool      (*run)();
+}
+TEST_CASE;
+
+
+/**************************************************************************/
+/*
+    WireTap
+
+    Stream between library & emulated module, records command of every
+    frame written by library in wire order
+
+    NOTE:
+    - library writes whole frames, command is 4-th byte of every frame
+*/
+/**************************************************************************/
+class WireTap : public Stream
+{
+  public:
+   WireTap(Stream &stream) : _stream(&stream), _count(0) {}
+
+   std::vector<uint8_t> commands;
+
+   int    available()                                {return _stream->available();}
+   int    read()                                     {return _stream->read();}
+   int    peek()                                     {return _stream->peek();}
+   size_t write(uint8_t data)                        {_record(&data, 1);  return _stream->write(data);}
+   size_t write(const uint8_t *buffer, size_t size)  {_record(buffer, size); return _stream->write(buffer, size);}
+   int    availableForWrite()                        {return _stream->availableForWrite();}
+   void   flush()                                    {_stream->flush();}
+
+  private:
+   Stream   *_stream;
+   uint32_t  _count;  //bytes written
+
+   void _record(const uint8_t *buffer, size_t size)
+   {
+     for (size_t i = 0; i < size; i++, _count++)
+     {
+       if ((_count % DFPLAYER_UART_FRAME_SIZE) == 3) {commands.push_back(buffer[i]);}
+     }
+   }
+};
+
+
+/**************************************************************************/
+/*
+    service()
+
+    Service library with "update()" like tickless sketch for specific time
+*/
+/**************************************************************************/
+static void service(DFPlayer &mp3, uint32_t time)
+{
+  uint32_t startTime = millis();
+
+  while ((millis() - startTime) < time)
+  {
+    uint32_t deadline = mp3.update();
+    uint32_t left     = time - (millis() - startTime);
+
+    delay(constrain(deadline, 1, left));
+  }
+}
+
+
+/**************************************************************************/
+/*
+    waitFor()
+
+    Service library with "update()" until "done" returns true
+
+    NOTE:
+    - return false on timeout
+*/
+/**************************************************************************/
+template <typename DONE>
+static bool waitFor(DFPlayer &mp3, DONE done)
+{
+  uint32_t startTime = millis();
+
+  while (done() == false)
+  {
+    if ((millis() - startTime) > TEST_TIMEOUT) {return false;}
+
+    mp3.update();
+    delay(1);
+  }
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    serviceDeck()
+
+    Service deck with "update()" for specific time, "sample" is called
+    after every "update()"
+*/
+/**************************************************************************/
+template <typename SAMPLE>
+static void serviceDeck(DFPlayerDeck &deck, uint32_t time, SAMPLE sample)
+{
+  uint32_t startTime = millis();
+
+  while ((millis() - startTime) < time)
+  {
+    deck.update();
+    sample();
+    delay(1);
+  }
+}
+
+
+/**************************************************************************/
+/*
+    testSourceNonBlocking()
+
+    Non-blocking "setSource()" doesn't block caller & next queued command
+    waits for source selection
+*/
+/**************************************************************************/
+static bool testSourceNonBlocking()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setNonBlocking(true);
+
+  uint32_t startTime = millis();
+
+  mp3.setSource(2);
+
+  CHECK((millis() - startTime) < 5);
+
+  mp3.playTrack(3);
+
+  CHECK(waitFor(mp3, [&]() {return module.getState() == EMULATOR_PLAYING;}) == true);
+  CHECK((millis() - startTime) >= DFPLAYER_WAKEUP_DELAY);
+  CHECK(module.getTrack()  == 3);
+  CHECK(module.getSource() == 2);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testResetSourcePlay()
+
+    Play queued behind reset & "set source" isn't moved ahead of them
+*/
+/**************************************************************************/
+static bool testResetSourcePlay()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setNonBlocking(true);
+
+  mp3.reset();
+  mp3.setSource(2);
+  mp3.playTrack(3);
+
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  service(mp3, 500);
+
+  CHECK(module.getState() == EMULATOR_PLAYING);
+  CHECK(module.getTrack() == 3);
+  CHECK(mp3.getPosition() != 0);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testStandbyWakePlay()
+
+    Queued standby, wake up & play are sent in order, settings queued with
+    them are still sorted between barriers
+*/
+/**************************************************************************/
+static bool testStandbyWakePlay()
+{
+  DFPlayerEmulator module(EMULATOR_GD3200B);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_HW_247A, false, false);
+  mp3.setNonBlocking(true);
+
+  mp3.setVolume(10);                    //write delay, next commands are queued
+  mp3.enableStandby(true);
+  mp3.setEQ(3);
+  mp3.wakeup(2);
+  mp3.setVolume(12);
+  mp3.playTrack(4);
+
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  service(mp3, 500);
+
+  CHECK(module.getState()           == EMULATOR_PLAYING);
+  CHECK(module.getTrack()           == 4);
+  CHECK(module.getVolume()          == 12);
+  CHECK(module.getEQ()              == 3);
+  CHECK(module.getStats().dropped   == 0);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testTriggerWriteDelay()
+
+    Command sent right after "trigger()" waits for chip delay after write
+    command, not just for trigger guard
+*/
+/**************************************************************************/
+static bool testTriggerWriteDelay()
+{
+  DFPlayerEmulator module(EMULATOR_GD3200B);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_HW_247A, false, false);
+  mp3.setNonBlocking(true);
+  mp3.setTrigger(1, 2);
+
+  service(mp3, 500);
+
+  mp3.trigger();
+  mp3.setVolume(7);
+
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  service(mp3, 500);
+
+  CHECK(module.getState()         == EMULATOR_PLAYING);
+  CHECK(module.getFolder()        == 1);
+  CHECK(module.getTrack()         == 2);
+  CHECK(module.getVolume()        == 7);
+  CHECK(module.getStats().dropped == 0);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testBusyPauseResume()
+
+    Pause, resume & next track with BUSY-pin aren't reported as finished
+    track & BUSY-pin doesn't need "update()" every msec
+*/
+/**************************************************************************/
+static bool testBusyPauseResume()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  module.setBusyPin(TEST_BUSY_PIN);
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setBusyPin(TEST_BUSY_PIN);
+  mp3.setNonBlocking(true);
+
+  mp3.playTrack(3);
+  service(mp3, 500);
+
+  mp3.pause();
+  service(mp3, 500);
+
+  CHECK(mp3.getFinishedTrack() == DFPLAYER_TRACK_NONE);
+
+  mp3.resume();
+  service(mp3, 500);
+
+  CHECK(mp3.getFinishedTrack() == DFPLAYER_TRACK_NONE);
+  CHECK(module.getState()      == EMULATOR_PLAYING);
+  CHECK(mp3.update()           >= 50);              //BUSY-pin is polled coarsely, not every msec
+
+  mp3.pause();
+  service(mp3, 500);
+  mp3.next();
+  service(mp3, 500);
+
+  CHECK(mp3.getFinishedTrack() == DFPLAYER_TRACK_NONE);
+  CHECK(module.getState()      == EMULATOR_PLAYING);
+  CHECK(module.getTrack()      == 4);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testQueryAfterErrors()
+
+    Query skips "track not found" errors of play commands sent before it
+*/
+/**************************************************************************/
+static bool testQueryAfterErrors()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setNonBlocking(true);
+  mp3.setVolume(12);
+
+  service(mp3, 100);
+
+  for (uint8_t i = 1; i <= 5; i++) {mp3.playFolder(99, i);} //folder not on card
+
+  CHECK(mp3.getVolume() == 12);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testQueueFullOrder()
+
+    Command sent to full TX queue waits for oldest queued one & isn't sent
+    ahead of the queue
+*/
+/**************************************************************************/
+static bool testQueueFullOrder()
+{
+  DFPlayerEmulator module(EMULATOR_GD3200B);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_HW_247A, false, false);
+  mp3.setNonBlocking(true);
+
+  mp3.setVolume(10);                                        //write delay, next commands are queued
+
+  for (uint8_t i = 0; i < (DFPLAYER_QUEUE_SIZE - 2); i++) {mp3.next();}
+
+  mp3.setEQ(2);
+  mp3.setVolume(27);
+  mp3.volumeUp();                                           //queue is full
+
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  service(mp3, 500);
+
+  CHECK(module.getVolume()        == 28);
+  CHECK(module.getEQ()            == 2);
+  CHECK(module.getStats().dropped == 0);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testPauseAtTrackEnd()
+
+    Track finished while pause is on the way is reported by BUSY-pin &
+    resume doesn't continue old position
+*/
+/**************************************************************************/
+static bool testPauseAtTrackEnd()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  module.setBusyPin(TEST_BUSY_PIN);
+  module.setTrackDuration(2000);
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setBusyPin(TEST_BUSY_PIN);
+
+  mp3.playTrack(3);
+
+  CHECK(waitFor(mp3, [&]() {return module.getState() == EMULATOR_PLAYING;}) == true);
+
+  uint32_t endTime = millis() + 2000 - module.getPosition();
+
+  service(mp3, endTime - millis() - 5);                     //pause frame takes ~10msec, track ends on the way
+
+  mp3.pause();
+  service(mp3, 50);
+
+  CHECK(module.getState()      == EMULATOR_STOP);   //pause arrived after end of track
+  CHECK(mp3.getFinishedTrack() == 3);
+
+  mp3.resume();
+  service(mp3, 1000);
+
+  CHECK(module.getState() == EMULATOR_PLAYING);
+  CHECK(mp3.getPosition() <= module.getPosition());
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    checkFinishBeforeBusyHigh()
+
+    See "testFinishBeforeBusyHigh()"
+*/
+/**************************************************************************/
+static bool checkFinishBeforeBusyHigh()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  module.setBusyPin(TEST_BUSY_PIN);
+  module.setTrackDuration(2000);
+  digitalWrite(TEST_BUSY_PIN_LAG, HIGH);
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setBusyPin(TEST_BUSY_PIN_LAG);
+
+  mp3.playTrack(3);
+
+  CHECK(waitFor(mp3, [&]() {return module.getState() == EMULATOR_PLAYING;}) == true);
+
+  digitalWrite(TEST_BUSY_PIN_LAG, LOW);
+  service(mp3, 200);
+
+  uint16_t finished = DFPLAYER_TRACK_NONE;
+
+  CHECK(waitFor(mp3, [&]() {finished = mp3.getFinishedTrack(); return finished != DFPLAYER_TRACK_NONE;}) == true);
+  CHECK(finished                   == 3);    //"track finished" arrived, lagging pin is still low
+  CHECK(digitalRead(TEST_BUSY_PIN) == HIGH); //module pin is already high
+
+  service(mp3, DFPLAYER_FINISHED_WINDOW + 500);
+  digitalWrite(TEST_BUSY_PIN_LAG, HIGH);
+  service(mp3, 200);
+
+  CHECK(mp3.getFinishedTrack() == DFPLAYER_TRACK_NONE); //pin high later isn't second finish
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testFinishBeforeBusyHigh()
+
+    "Track finished" feedback ahead of BUSY-pin going high is reported
+    once, also after "millis()" passed 2^31, ~24.8 days of uptime
+*/
+/**************************************************************************/
+static bool testFinishBeforeBusyHigh()
+{
+  hostSetTimeOffset(((uint64_t)0x80000000 + 256) * 1000);
+
+  bool ok = checkFinishBeforeBusyHigh();
+
+  hostSetTimeOffset(0);
+
+  return ok;
+}
+
+
+/**************************************************************************/
+/*
+    testDeckGapless()
+
+    Deck starts next track on idle module ahead of known end of current
+    track, there is no silence between tracks
+*/
+/**************************************************************************/
+static bool testDeckGapless()
+{
+  DFPlayerEmulator moduleA(EMULATOR_YX5200);
+  DFPlayerEmulator moduleB(EMULATOR_YX5200);
+  DFPlayer         mp3A;
+  DFPlayer         mp3B;
+  DFPlayerDeck     deck;
+
+  moduleA.setTrackDuration(3000);
+  moduleB.setTrackDuration(3000);
+  moduleA.setBusyPin(TEST_BUSY_PIN);
+  moduleB.setBusyPin(TEST_BUSY_PIN_B);
+
+  mp3A.begin(moduleA, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3B.begin(moduleB, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3A.setBusyPin(TEST_BUSY_PIN);
+  mp3B.setBusyPin(TEST_BUSY_PIN_B);
+
+  for (uint8_t track = 1; track <= 3; track++) {mp3A.setDuration(1, track, 3);} //learned earlier, deck B gets them from deck A
+
+  deck.begin(mp3A, mp3B, 20);
+  deck.setPlaylist(1, 1, 3, false);
+  deck.setCrossfade(0);
+  deck.play();
+
+  uint32_t silence   = 0;                                             //longest time without audio after first track started
+  uint32_t quietTime = 0;
+  bool     started   = false;
+
+  serviceDeck(deck, 8500, [&]()
+  {
+    bool playing = (moduleA.getState() == EMULATOR_PLAYING) || (moduleB.getState() == EMULATOR_PLAYING);
+
+    if (playing == true)
+    {
+      started   = true;
+      quietTime = millis();
+    }
+    else if ((started == true) && ((millis() - quietTime) > silence))
+    {
+      silence = millis() - quietTime;
+    }
+  });
+
+  CHECK(started == true);
+  CHECK(silence < 20);                                                //only sampling step, no gap between tracks
+  CHECK(deck.getTrack()        == 3);
+  CHECK(deck.getActiveDeck()   == 0);                                 //1 on A, 2 on B, 3 on A
+  CHECK(moduleA.getTrack()     == 3);
+  CHECK(moduleB.getTrack()     == 2);
+  CHECK(moduleA.getVolume()    == 20);
+  CHECK(moduleB.getVolume()    == 20);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testDeckCrossfade()
+
+    Durations learned by BUSY-pins on first pass give crossfade on second
+    pass, volumes ramp in opposite directions & faded out module stops
+*/
+/**************************************************************************/
+static bool testDeckCrossfade()
+{
+  DFPlayerEmulator moduleA(EMULATOR_YX5200);
+  DFPlayerEmulator moduleB(EMULATOR_YX5200);
+  DFPlayer         mp3A;
+  DFPlayer         mp3B;
+  DFPlayerDeck     deck;
+
+  moduleA.setTrackDuration(4000);
+  moduleB.setTrackDuration(4000);
+  moduleA.setBusyPin(TEST_BUSY_PIN);
+  moduleB.setBusyPin(TEST_BUSY_PIN_B);
+
+  mp3A.begin(moduleA, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3B.begin(moduleB, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3A.setBusyPin(TEST_BUSY_PIN);
+  mp3B.setBusyPin(TEST_BUSY_PIN_B);
+
+  deck.begin(mp3A, mp3B, 20);
+  deck.setPlaylist(1, 1, 2, false);
+  deck.setCrossfade(1000);
+  deck.play();
+
+  serviceDeck(deck, 9500, [](){});                                    //first pass learns durations, tracks follow with usual gap
+
+  CHECK(deck.getTrack()           == DFPLAYER_DECK_NO_TRACK);
+  CHECK(mp3A.getDuration(1, 1)    == 4);
+  CHECK(mp3B.getDuration(1, 2)    == 4);
+
+  deck.play();                                                        //track 1 on deck B, duration copied from deck A
+
+  uint8_t           active    = deck.getActiveDeck();
+  DFPlayerEmulator &outgoing  = (active == 0) ? moduleA : moduleB;
+  DFPlayerEmulator &incoming  = (active == 0) ? moduleB : moduleA;
+  uint32_t          overlap   = 0;                                    //time both modules played
+  uint8_t           volumeIn  = 0;
+  uint8_t           volumeOut = 20;
+  bool              rampsOk   = true;
+
+  serviceDeck(deck, 5000, [&]()
+  {
+    if ((outgoing.getState() != EMULATOR_PLAYING) || (incoming.getState() != EMULATOR_PLAYING)) {return;}
+
+    overlap++;
+
+    if ((incoming.getVolume() < volumeIn) || (outgoing.getVolume() > volumeOut)) {rampsOk = false;}
+
+    volumeIn  = incoming.getVolume();
+    volumeOut = outgoing.getVolume();
+  });
+
+  CHECK(rampsOk                == true);
+  CHECK(overlap                 > 800);                               //crossfade, not gapless cut
+  CHECK(overlap                 < 1300);
+  CHECK(deck.getTrack()        == 2);
+  CHECK(deck.getActiveDeck()   != active);
+  CHECK(outgoing.getState()    == EMULATOR_STOP);                     //faded out module is stopped
+  CHECK(incoming.getState()    == EMULATOR_PLAYING);
+  CHECK(incoming.getTrack()    == 2);
+  CHECK(incoming.getVolume()   == 20);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testDeckLastTrack()
+
+    Last track of not repeated playlist isn't started again & deck
+    deadline covers its end when modules have nothing pending
+*/
+/**************************************************************************/
+static bool testDeckLastTrack()
+{
+  DFPlayerEmulator moduleA(EMULATOR_YX5200);
+  DFPlayerEmulator moduleB(EMULATOR_YX5200);
+  DFPlayer         mp3A;
+  DFPlayer         mp3B;
+  DFPlayerDeck     deck;
+
+  moduleA.setTrackDuration(3000);
+  moduleB.setTrackDuration(3000);
+
+  mp3A.begin(moduleA, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, true, false); //"track finished" feedback, no BUSY-pin
+  mp3B.begin(moduleB, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, true, false);
+
+  for (uint8_t track = 1; track <= 2; track++)
+  {
+    mp3A.setDuration(1, track, 3);
+    mp3B.setDuration(1, track, 3);
+  }
+
+  deck.begin(mp3A, mp3B, 20);
+  deck.setPlaylist(1, 1, 2, false);
+  deck.setCrossfade(500);
+  deck.play();
+
+  uint8_t  starts     = 0;                                            //tracks started on both modules
+  bool     playingA   = false;
+  bool     playingB   = false;
+  bool     deadlineOk = true;
+  uint32_t startTime  = millis();
+
+  while ((millis() - startTime) < 12000)
+  {
+    uint32_t deadline = deck.update();
+
+    if ((deck.getTrack() == 2) && (deck.isFading() == false))
+    {
+      DFPlayer &last      = (deck.getActiveDeck() == 0) ? mp3A : mp3B;
+      uint32_t  remaining = last.getRemaining();
+
+      if ((remaining != 0) && (deadline > remaining)) {deadlineOk = false;} //end of last track would be missed by sleeping MCU
+    }
+
+    if ((moduleA.getState() == EMULATOR_PLAYING) && (playingA == false)) {starts++;}
+    if ((moduleB.getState() == EMULATOR_PLAYING) && (playingB == false)) {starts++;}
+
+    playingA = (moduleA.getState() == EMULATOR_PLAYING);
+    playingB = (moduleB.getState() == EMULATOR_PLAYING);
+
+    delay(1);
+  }
+
+  CHECK(deadlineOk             == true);
+  CHECK(starts                 == 2);
+  CHECK(deck.getTrack()        == DFPLAYER_DECK_NO_TRACK);
+  CHECK(moduleA.getState()     == EMULATOR_STOP);
+  CHECK(moduleB.getState()     == EMULATOR_STOP);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testQueryResults()
+
+    Result getters tell value "0" apart from module error & timeout
+*/
+/**************************************************************************/
+static bool testQueryResults()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  FaultStream      link(module);
+  DFPlayer         mp3;
+
+  mp3.begin(link, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setVolume(0);
+
+  DFPLAYER_RESULT result = mp3.getVolumeResult();
+
+  CHECK(result.status == DFPLAYER_RESULT_OK);
+  CHECK(result.value  == 0);
+
+  result = mp3.getTotalTracksUSBResult(); //no USB-Disk, module replies with error frame
+
+  CHECK(result.status == 0x06);
+  CHECK(result.value  == 0);
+
+  FAULT_CONFIG faults = {1, 0, 0, 0, 0, 0, 0}; //every byte is lost
+
+  link.setFaults(faults);
+
+  result = mp3.getVolumeResult();
+
+  CHECK(result.status   == DFPLAYER_RESULT_TIMEOUT);
+  CHECK(result.value    == 0);
+  CHECK(mp3.getStatus() == 4);                //4=communication error
+
+  return true;
+}
+
+
+#if (DFPLAYER_TRANSACTIONS == 1)
+/**************************************************************************/
+/*
+    testTransactionOrder()
+
+    Transaction is sent in order as one unit, command queued after it isn't
+    moved into it & transaction bigger than TX queue fails as a whole
+*/
+/**************************************************************************/
+static bool testTransactionOrder()
+{
+  DFPlayerEmulator module(EMULATOR_GD3200B);
+  WireTap          tap(module);
+  DFPlayer         mp3;
+
+  mp3.begin(tap, DFPLAYER_CMD_DELAY, DFPLAYER_HW_247A, false, false);
+  mp3.setNonBlocking(true);
+
+  mp3.setVolume(10);                    //write delay, next commands are queued
+
+  CHECK(mp3.beginTransaction() == true);
+  mp3.setVolume(20);
+  mp3.playFolder(1, 2);                 //would be sent ahead of volume outside of transaction
+  CHECK(mp3.endTransaction()   == true);
+
+  mp3.setEQ(3);
+
+  CHECK(mp3.getTransactionStatus() == DFPLAYER_TRANSACTION_PENDING);
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  CHECK(mp3.getTransactionStatus() == DFPLAYER_TRANSACTION_DONE);
+  CHECK(mp3.getTransactionStatus() == DFPLAYER_TRANSACTION_NONE); //result is returned once
+
+  const uint8_t order[] = {DFPLAYER_SET_VOL, DFPLAYER_SET_VOL, DFPLAYER_PLAY_FOLDER, DFPLAYER_SET_EQ};
+
+  CHECK(tap.commands.size() == sizeof(order));
+  CHECK(memcmp(tap.commands.data(), order, sizeof(order)) == 0);
+
+  service(mp3, 500);
+
+  CHECK(module.getState()  == EMULATOR_PLAYING);
+  CHECK(module.getFolder() == 1);
+  CHECK(module.getTrack()  == 2);
+  CHECK(module.getVolume() == 20);
+  CHECK(module.getEQ()     == 3);
+
+  tap.commands.clear();
+
+  CHECK(mp3.beginTransaction() == true);
+
+  for (uint8_t i = 0; i <= DFPLAYER_QUEUE_SIZE; i++) {mp3.stop();} //stop is never cancelled, 1 more than TX queue
+
+  CHECK(mp3.endTransaction()       == false);
+  CHECK(mp3.getTransactionStatus() == DFPLAYER_TRANSACTION_FAILED);
+
+  service(mp3, 500);
+
+  CHECK(tap.commands.empty() == true);  //whole transaction is dropped
+  CHECK(module.getState()    == EMULATOR_PLAYING);
+
+  return true;
+}
+
+#endif
+
+
+#if (DFPLAYER_CONFIG_RESTORE == 1)
+/**************************************************************************/
+/*
+    testRestoreAfterReset()
+
+    Settings are sent again after "reset()" & after unexpected reboot of
+    module, queued play waits for them
+*/
+/**************************************************************************/
+static bool testRestoreAfterReset()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setNonBlocking(true);
+
+  mp3.setVolume(12);
+  mp3.setEQ(3);
+
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+
+  mp3.reset();
+  mp3.playTrack(3);
+
+  CHECK(mp3.isConfigRestored() == false);
+  CHECK(waitFor(mp3, [&]() {return module.getState() == EMULATOR_PLAYING;}) == true);
+  CHECK(mp3.isConfigRestored() == true);
+  CHECK(module.getVolume()     == 12);
+  CHECK(module.getEQ()         == 3);
+  CHECK(module.getTrack()      == 3);
+
+  module.powerUp();                     //brown-out, module sends "ready" after boot
+
+  CHECK(module.getVolume() == 30);
+  CHECK(waitFor(mp3, [&]() {return (module.getVolume() == 12) && (module.getEQ() == 3);}) == true);
+  CHECK(mp3.isConfigRestored() == true);
+  CHECK(module.getStats().dropped == 0);
+
+  return true;
+}
+#endif
+
+
+#if (DFPLAYER_SNAPSHOT == 1)
+/**************************************************************************/
+/*
+    testSnapshotRoundTrip()
+
+    Position is frozen while paused, snapshot restores position, learned
+    duration & calibrated write delay on warm start, damaged blob is
+    rejected, every built-in profile is restored as itself
+*/
+/**************************************************************************/
+static bool testSnapshotRoundTrip()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPLAYER_PROFILE profile = DFPLAYER_PROFILE_YX5200;
+  DFPlayer         mp3;
+  uint8_t          blob[DFPLAYER_SNAPSHOT_SIZE];
+
+  module.setBusyPin(TEST_BUSY_PIN);
+  module.setTrackDuration(2000);
+
+  profile.writeDelay = 40;              //e.g. found by "calibrateGap()"
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setProfile(profile);
+  mp3.setBusyPin(TEST_BUSY_PIN);
+  mp3.setNonBlocking(true);
+
+  mp3.setVolume(12);
+  mp3.playTrack(2);
+
+  CHECK(waitFor(mp3, [&]() {return mp3.getFinishedTrack() == 2;}) == true);
+  CHECK(mp3.getDuration(DFPLAYER_FOLDER_ROOT, 2) == 2);
+
+  mp3.playTrack(3);
+  service(mp3, 1000);
+  mp3.pause();
+  service(mp3, 100);
+
+  uint32_t position = mp3.getPosition();
+
+  CHECK(module.getState() == EMULATOR_PAUSE);
+  CHECK(position          != 0);
+
+  service(mp3, 500);
+
+  CHECK(mp3.getPosition() == position); //frozen while paused
+
+  uint16_t size = mp3.saveSnapshot(blob, sizeof(blob));
+
+  CHECK(size != 0);
+
+  DFPLAYER_PROFILE restored = DFPLAYER_PROFILE_YX5200;
+  DFPlayer         warm;                //MCU restarted, module kept running
+
+  warm.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  warm.setBusyPin(TEST_BUSY_PIN);
+
+  blob[size - 3] ^= 0x01;               //damaged blob
+  CHECK(warm.restoreSnapshot(blob, size, &restored) == false);
+  blob[size - 3] ^= 0x01;
+
+  CHECK(warm.restoreSnapshot(blob, size - 1, &restored) == false);
+  CHECK(warm.restoreSnapshot(blob, size, &restored)     == true);
+  CHECK(restored.writeDelay                             == 40);
+  CHECK(warm.getPosition()                              == position);
+  CHECK(warm.getDuration(DFPLAYER_FOLDER_ROOT, 2)       == 2);
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  CHECK(warm.getPowerState() == DFPLAYER_POWER_ACTIVE);
+  #endif
+
+  warm.resume();
+  service(warm, 500);
+
+  CHECK(module.getState()  == EMULATOR_PLAYING);
+  CHECK(warm.getPosition() >= (position + 400));
+  CHECK(warm.getPosition() <= (module.getPosition() + 25)); //counted from commands, module starts when frame arrives
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  warm.enableStandby(true);
+  service(warm, 500);
+
+  size = warm.saveSnapshot(blob, sizeof(blob));
+
+  DFPlayer sleeping;                    //power manager disabled, module stays in standby
+
+  sleeping.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+
+  CHECK(sleeping.restoreSnapshot(blob, size) == true);
+  CHECK(sleeping.getPowerState()             == DFPLAYER_POWER_ACTIVE);
+  #endif
+
+  const DFPLAYER_PROFILE *profiles[] = {&DFPLAYER_PROFILE_YX5200,  &DFPLAYER_PROFILE_YX5300,  &DFPLAYER_PROFILE_JL_AAXXXX, &DFPLAYER_PROFILE_FN6100,
+                                        &DFPLAYER_PROFILE_GD3200B, &DFPLAYER_PROFILE_MH2024K, &DFPLAYER_PROFILE_NO_CHECKSUM};
+  const EMULATOR_CHIP     chips[]    = {EMULATOR_YX5200,           EMULATOR_YX5200,           EMULATOR_YX5200,            EMULATOR_FN6100,
+                                        EMULATOR_GD3200B,          EMULATOR_GD3200B,          EMULATOR_NO_CHECKSUM};
+
+  for (uint8_t i = 0; i < (sizeof(chips) / sizeof(chips[0])); i++) //every built-in profile is restored as itself
+  {
+    DFPlayerEmulator chip(chips[i]);
+    DFPlayer         saved;
+    DFPlayer         other;
+    uint8_t          again[DFPLAYER_SNAPSHOT_SIZE];
+
+    saved.begin(chip, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+    saved.setProfile(*profiles[i]);
+
+    size = saved.saveSnapshot(blob, sizeof(blob));
+
+    CHECK(blob[4] != DFPLAYER_CONFIG_UNKNOWN);
+
+    other.begin(chip, DFPLAYER_CMD_DELAY, (chips[i] == EMULATOR_FN6100) ? DFPLAYER_MINI : DFPLAYER_FN_X10P, false, false); //wrong checksum until restored
+
+    CHECK(other.restoreSnapshot(blob, size)         == true);
+    CHECK(other.saveSnapshot(again, sizeof(again)) == size);
+    CHECK(again[4]                                 == blob[4]);
+  }
+
+  return true;
+}
+#endif
+
+
+#if (DFPLAYER_TRANSACTIONS == 1) && (DFPLAYER_TX_BATCH > 1)
+/**************************************************************************/
+/*
+    testBatchWrites()
+
+    Back-to-back frames are written by one serial call, up to
+    DFPLAYER_TX_BATCH frames & free space of TX buffer, paced chip gets
+    one frame per call
+*/
+/**************************************************************************/
+static bool testBatchWrites()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setNonBlocking(true);
+
+  service(mp3, 100);
+  module.resetStats();
+
+  mp3.beginTransaction();               //4 frames, no write delay
+  mp3.setVolume(10);
+  mp3.setEQ(2);
+  mp3.setDACGain(5);
+  mp3.playTrack(1);
+  mp3.endTransaction();
+
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  service(mp3, 500);
+
+  CHECK(module.getStats().writes  == 1);
+  CHECK(module.getStats().frames  == 4);
+  CHECK(module.getState()         == EMULATOR_PLAYING);
+  CHECK(module.getVolume()        == 10);
+
+  module.resetStats();
+
+  mp3.beginTransaction();               //6 frames, stop is never cancelled
+
+  for (uint8_t i = 0; i < 6; i++) {mp3.stop();}
+
+  mp3.endTransaction();
+
+  CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  service(mp3, 500);
+
+  CHECK(module.getStats().writes  == 2); //DFPLAYER_TX_BATCH=4 frames, then 2 frames
+  CHECK(module.getStats().frames  == 6);
+  CHECK(module.getStats().dropped == 0);
+
+  DFPlayerEmulator paced(EMULATOR_GD3200B);
+  DFPlayer         slow;
+
+  slow.begin(paced, DFPLAYER_CMD_DELAY, DFPLAYER_HW_247A, false, false);
+  slow.setNonBlocking(true);
+
+  service(slow, 500);
+  paced.resetStats();
+
+  slow.beginTransaction();              //write delay between frames, one frame per write
+  slow.setVolume(10);
+  slow.setEQ(2);
+  slow.setDACGain(5);
+  slow.playTrack(1);
+  slow.endTransaction();
+
+  CHECK(waitFor(slow, [&]() {return slow.update() == DFPLAYER_NO_DEADLINE;}) == true);
+  service(slow, 500);
+
+  CHECK(paced.getStats().writes  == 4);
+  CHECK(paced.getStats().frames  == 4);
+  CHECK(paced.getStats().dropped == 0);
+
+  return true;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    testPacingAfterTx()
+
+    Write delay is counted from the last stop bit of previous frame, not
+    from the moment buffered "write()" returned
+*/
+/**************************************************************************/
+static bool testPacingAfterTx()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPLAYER_PROFILE profile = DFPLAYER_PROFILE_YX5200;
+  DFPlayer         mp3;
+
+  profile.writeDelay = 30;              //module is busy 30msec after last stop bit, frame end to frame end is 40.4msec
+
+  module.setTiming(20000, (30000 + (DFPLAYER_UART_FRAME_SIZE * EMULATOR_BYTE_TIME)), 1500000);
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setProfile(profile);
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    mp3.setNonBlocking(i != 0);         //blocking waits & non-blocking queue are paced the same
+
+    mp3.setVolume(5);
+    mp3.setEQ(2);
+    mp3.setDACGain(5);
+    mp3.setVolume(7 + i);
+
+    CHECK(waitFor(mp3, [&]() {return mp3.update() == DFPLAYER_NO_DEADLINE;}) == true);
+    service(mp3, 100);
+
+    CHECK(module.getStats().dropped == 0);
+    CHECK(module.getVolume()        == (7 + i));
+    CHECK(module.getEQ()            == 2);
+  }
+
+  return true;
+}
+
+
+#if (DFPLAYER_CALIBRATION == 1)
+/**************************************************************************/
+/*
+    testCalibrateGap()
+
+    Calibration finds module gap within search step & adds margin, module
+    taking back-to-back commands still gets minimal margin
+*/
+/**************************************************************************/
+static bool testCalibrateGap()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPLAYER_PROFILE profile = DFPLAYER_PROFILE_YX5200;
+  DFPlayer         mp3;
+
+  module.setTiming(20000, (60000 + (DFPLAYER_UART_FRAME_SIZE * EMULATOR_BYTE_TIME)), 1500000); //module is busy 60msec after last stop bit
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+
+  uint16_t gap = mp3.calibrateGap(profile);
+
+  CHECK(gap                >= ((60 * (100 + DFPLAYER_CALIBRATION_MARGIN)) / 100));
+  CHECK(gap                <= (((60 + DFPLAYER_CALIBRATION_STEP) * (100 + DFPLAYER_CALIBRATION_MARGIN)) / 100));
+  CHECK(profile.writeDelay == gap);
+
+  mp3.setProfile(profile);
+  module.resetStats();
+
+  for (uint8_t i = 0; i < 10; i++) {mp3.setVolume(10 + i);}
+
+  CHECK(module.getStats().dropped == 0); //calibrated gap is reliable
+  CHECK(module.getVolume()        == 19);
+
+  module.setTiming(20000, 0, 1500000);  //module takes back-to-back commands
+
+  CHECK(mp3.calibrateGap(profile) == DFPLAYER_CALIBRATION_MARGIN_MIN);
+  CHECK(profile.writeDelay        == DFPLAYER_CALIBRATION_MARGIN_MIN);
+
+  return true;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    testProfileGaps()
+
+    Command missing on chip isn't sent & its query returns
+    "DFPLAYER_RESULT_UNSUPPORTED" without waiting for timeout
+*/
+/**************************************************************************/
+static bool testProfileGaps()
+{
+  DFPlayerEmulator module(EMULATOR_GD3200B);
+  WireTap          tap(module);
+  DFPlayer         mp3;
+
+  mp3.begin(tap, DFPLAYER_CMD_DELAY, DFPLAYER_HW_247A, false, false);
+  mp3.setProfile(DFPLAYER_PROFILE_MH2024K);
+
+  CHECK(mp3.getTotalFoldersResult().status        == DFPLAYER_RESULT_UNSUPPORTED);
+  CHECK(mp3.getTotalTracksNORFlashResult().status == DFPLAYER_RESULT_UNSUPPORTED);
+  CHECK(mp3.getVolumeResult().status              == DFPLAYER_RESULT_OK);
+
+  mp3.setProfile(DFPLAYER_PROFILE_YX5300);
+  mp3.playAdvertFolder(1);
+
+  CHECK(mp3.getTotalTracksUSBResult().status      == DFPLAYER_RESULT_UNSUPPORTED);
+
+  CHECK(tap.commands.size() == 1);
+  CHECK(tap.commands[0]     == DFPLAYER_GET_VOL);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testCorruptedReplies()
+
+    Reply with flipped bit fails checksum, corrupted value is never returned
+    with "DFPLAYER_RESULT_OK" status at any fault rate, for both checksum
+    types
+*/
+/**************************************************************************/
+static bool testCorruptedReplies()
+{
+  const EMULATOR_CHIP        chips[]  = {EMULATOR_YX5200, EMULATOR_FN6100};
+  const DFPLAYER_MODULE_TYPE models[] = {DFPLAYER_MINI,   DFPLAYER_FN_X10P};
+  const float                rates[]  = {0.001, 0.005, 0.01, 0.02, 0.05};
+
+  for (uint8_t chip = 0; chip < (sizeof(chips) / sizeof(chips[0])); chip++)
+  {
+    for (uint8_t i = 0; i < (sizeof(rates) / sizeof(rates[0])); i++)
+    {
+      DFPlayerEmulator module(chips[chip]);
+      FaultStream      link(module, 1 + i);
+      DFPlayer         mp3;
+
+      mp3.begin(link, DFPLAYER_CMD_DELAY, models[chip], false, false);
+
+      CHECK(mp3.getVolumeResult().status == DFPLAYER_RESULT_OK); //valid reply isn't rejected
+
+      FAULT_CONFIG faults = {0, rates[i], 0, 0, 0, 0, 0};        //flipped bits only
+
+      link.setFaults(faults);
+
+      uint16_t valid = 0;
+
+      for (uint8_t volume = 0; volume < 200; volume++)
+      {
+        mp3.setVolume(volume % 31);
+
+        DFPLAYER_RESULT result = mp3.getVolumeResult();
+
+        if (result.status != DFPLAYER_RESULT_OK) {continue;}
+
+        CHECK(result.value == module.getVolume());
+
+        valid++;
+      }
+
+      CHECK(link.getStats().flipped > 0);
+      CHECK(valid                   > 0);
+    }
+  }
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testVerifyManifest()
+
+    Manifest of the card matches & preloads durations, manifest of other
+    card fails & durations aren't preloaded
+*/
+/**************************************************************************/
+static bool testVerifyManifest()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  module.setTracks(4, 2, 3);            //4 root tracks, folders 01 & 02 with 3 tracks each
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+
+  static const uint8_t           folderTracks[] = {3, 3};
+  static const uint8_t           otherTracks[]  = {3, 4};
+  static const DFPLAYER_DURATION durations[]    = {{2, 1, 2, 95}}; //"01/002.mp3" on TF-Card, 95sec
+
+  DFPLAYER_MANIFEST card  = {DFPlayer::hashManifest(10, 2, folderTracks, 2), 10, 2, 2, folderTracks, durations, 1};
+  DFPLAYER_MANIFEST other = {DFPlayer::hashManifest(11, 2, otherTracks,  2), 11, 2, 2, otherTracks,  durations, 1};
+
+  module.resetStats();
+
+  CHECK(mp3.verifyManifest(other)  == false);
+  CHECK(module.getStats().frames   == 1);  //total tracks mismatch, nothing else is queried
+  CHECK(mp3.getDuration(1, 2)      == 0);
+
+  other.totalTracks = 10;                  //same counts as card except folder 02, hash differs
+  other.hash        = DFPlayer::hashManifest(10, 2, otherTracks, 2);
+
+  module.resetStats();
+
+  CHECK(mp3.verifyManifest(other)  == false);
+  CHECK(module.getStats().frames   == 4);  //total tracks, folders & 2 folder queries
+  CHECK(mp3.getDuration(1, 2)      == 0);
+
+  CHECK(mp3.verifyManifest(card)   == true);
+  CHECK(mp3.getDuration(1, 2)      == 95);
+
+  return true;
+}
+
+
+#if (DFPLAYER_POWER_MANAGER == 1)
+/**************************************************************************/
+/*
+    testWakeQueuesWrites()
+
+    Write commands sent while module wakes up from standby wait for it &
+    query waits for the rest of wake up time
+*/
+/**************************************************************************/
+static bool testWakeQueuesWrites()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setIdleTimeout(1000);
+
+  service(mp3, 1500);
+
+  CHECK(mp3.getPowerState() == DFPLAYER_POWER_STANDBY);
+  CHECK(module.getState()   == EMULATOR_SLEEP);
+
+  mp3.playTrack(3);
+  mp3.setVolume(7);
+  mp3.setEQ(2);
+
+  CHECK(mp3.getVolume() == 7);
+
+  service(mp3, 500);
+
+  CHECK(module.getState()            == EMULATOR_PLAYING);
+  CHECK(module.getTrack()            == 3);
+  CHECK(module.getVolume()           == 7);
+  CHECK(module.getEQ()               == 2);
+  CHECK(module.getStats().badFrames  == 0);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testWakeProbeRetry()
+
+    First command after too short wake up is resent by "update()" & wake up
+    latency grows
+*/
+/**************************************************************************/
+static bool testWakeProbeRetry()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  module.setWakeTime(DFPLAYER_WAKEUP_DELAY * 1000UL + 100000); //longer than library expects
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, true, false);
+  mp3.setNonBlocking(true);
+  mp3.setIdleTimeout(1000);
+
+  service(mp3, 1500);
+
+  CHECK(mp3.getPowerState() == DFPLAYER_POWER_STANDBY);
+
+  mp3.playTrack(5);
+
+  CHECK(waitFor(mp3, [&]() {return module.getState() == EMULATOR_PLAYING;}) == true);
+  CHECK(module.getTrack()       == 5);
+  CHECK(mp3.getWakeupLatency()   > DFPLAYER_WAKEUP_DELAY);
+
+  return true;
+}
+
+/**************************************************************************/
+/*
+    testIdleStandbyPaced()
+
+    "update()" puts paced module in standby without waiting for pacing
+    gap, in non-blocking & blocking mode
+*/
+/**************************************************************************/
+static bool testIdleStandbyPaced()
+{
+  for (uint8_t mode = 0; mode < 2; mode++)
+  {
+    DFPlayerEmulator module(EMULATOR_YX5200);
+    DFPlayer         mp3;
+    DFPLAYER_PROFILE paced = DFPLAYER_PROFILE_YX5200;
+
+    paced.writeDelay = 200;
+
+    mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+    mp3.setProfile(paced);
+    mp3.setNonBlocking(mode == 0);
+    mp3.setIdleTimeout(50);
+    mp3.setVolume(10);                    //pacing gap is longer than idle timeout
+
+    uint32_t startTime = millis();
+
+    while ((mp3.getPowerState() != DFPLAYER_POWER_STANDBY) && ((millis() - startTime) < TEST_TIMEOUT))
+    {
+      uint64_t timeNow = hostGetTime();
+
+      mp3.update();
+
+      CHECK(hostGetTime() == timeNow);
+      delay(1);
+    }
+
+    CHECK(mp3.getPowerState() == DFPLAYER_POWER_STANDBY);
+
+    service(mp3, 500);
+
+    CHECK(module.getVolume() == 10);
+    CHECK(module.getStats().dropped == 0);
+  }
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    testDisableInStandby()
+
+    Power manager disabled in standby wakes module up first, next playback
+    command isn't lost
+*/
+/**************************************************************************/
+static bool testDisableInStandby()
+{
+  DFPlayerEmulator module(EMULATOR_YX5200);
+  DFPlayer         mp3;
+
+  mp3.begin(module, DFPLAYER_CMD_DELAY, DFPLAYER_MINI, false, false);
+  mp3.setIdleTimeout(1000);
+
+  service(mp3, 1500);
+
+  CHECK(mp3.getPowerState() == DFPLAYER_POWER_STANDBY);
+  CHECK(module.getState()   == EMULATOR_SLEEP);
+
+  mp3.setIdleTimeout(0);
+
+  CHECK(mp3.getPowerState() == DFPLAYER_POWER_ACTIVE);
+
+  mp3.playTrack(3);
+  service(mp3, 500);
+
+  CHECK(module.getState()   == EMULATOR_PLAYING);
+  CHECK(module.getTrack()   == 3);
+
+  return true;
+}
+#endif
+
+
+static const TEST_CASE tests[] =
+{
+  {"sourceNonBlocking", testSourceNonBlocking},
+  {"resetSourcePlay",   testResetSourcePlay},
+  {"standbyWakePlay",   testStandbyWakePlay},
+  {"triggerWriteDelay", testTriggerWriteDelay},
+  {"busyPauseResume",   testBusyPauseResume},
+  {"queryAfterErrors",  testQueryAfterErrors},
+  {"queueFullOrder",    testQueueFullOrder},
+  {"pauseAtTrackEnd",   testPauseAtTrackEnd},
+  {"finishBeforeBusy",  testFinishBeforeBusyHigh},
+  {"deckGapless",       testDeckGapless},
+  {"deckCrossfade",     testDeckCrossfade},
+  {"deckLastTrack",     testDeckLastTrack},
+  {"queryResults",      testQueryResults},
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  {"transactionOrder",  testTransactionOrder},
+  #endif
+  #if (DFPLAYER_CONFIG_RESTORE == 1)
+  {"restoreAfterReset", testRestoreAfterReset},
+  #endif
+  #if (DFPLAYER_SNAPSHOT == 1)
+  {"snapshotRoundTrip", testSnapshotRoundTrip},
+  #endif
+  {"profileGaps",       testProfileGaps},
+  {"corruptedReplies",  testCorruptedReplies},
+  {"verifyManifest",    testVerifyManifest},
+  {"pacingAfterTx",     testPacingAfterTx},
+  #if (DFPLAYER_CALIBRATION == 1)
+  {"calibrateGap",      testCalibrateGap},
+  #endif
+  #if (DFPLAYER_TRANSACTIONS == 1) && (DFPLAYER_TX_BATCH > 1)
+  {"batchWrites",       testBatchWrites},
+  #endif
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  {"wakeQueuesWrites",  testWakeQueuesWrites},
+  {"wakeProbeRetry",    testWakeProbeRetry},
+  {"idleStandbyPaced",  testIdleStandbyPaced},
+  {"disableInStandby",  testDisableInStandby},
+  #endif
+  {NULL,                NULL}
+};
+
+
+int main(int argc, char **argv)
+{
+  const char *filter = (argc > 1) ? argv[1] : NULL;
+  int         failed = 0;
+  int         passed = 0;
+
+  hostSetVirtualTime(true);
+
+  for (const TEST_CASE *test = tests; test->name != NULL; test++)
+  {
+    if ((filter != NULL) && (strcmp(filter, test->name) != 0)) {continue;}
+
+    bool ok = test->run();
+
+    printf("%s %s\n", (ok == true) ? "PASS" : "FAIL", test->name);
+
+    if (ok == true) {passed++;}
+    else            {failed++;}
+  }
+
+  printf("%d passed, %d failed\n", passed, failed);
+
+  return (failed != 0) ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+/***************************************************************************************************/
+/*
+   This is an ESP8266 EEPROM stub for building DFPlayer library examples on Linux host
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - EEPROM is kept in RAM, it's erased (0xFF) on every start
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef EEPROM_HOST_h
+#define EEPROM_HOST_h
+
+#include "Sketch.h"
+
+
+#define EEPROM_HOST_SIZE 512 //emulated sector size, in bytes
+
+
+class EEPROMClass
+{
+  public:
+   EEPROMClass() {memset(_data, 0xFF, sizeof(_data));}
+
+   void begin(size_t) {}
+   bool commit()      {return true;}
+
+   template <typename T> T       &get(int address, T &value)       {memcpy(&value, &_data[address], sizeof(T)); return value;}
+   template <typename T> const T &put(int address, const T &value) {memcpy(&_data[address], &value, sizeof(T)); return value;}
+
+  private:
+   uint8_t _data[EEPROM_HOST_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
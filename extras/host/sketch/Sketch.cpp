@@ -0,0 +1,136 @@
+/***************************************************************************************************/
+/*
+   This is a board stub for building DFPlayer library examples on Linux host
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include <stdio.h>
+
+#include "Sketch.h"
+#include "EEPROM.h"
+
+
+HardwareSerial Serial;
+EEPROMClass    EEPROM;
+
+
+/**************************************************************************/
+/*
+    HardwareSerial()
+
+    Constructor
+
+    NOTE:
+    - port without pins is console, other ports are sinks
+*/
+/**************************************************************************/
+HardwareSerial::HardwareSerial(uint8_t rxPin, uint8_t txPin)
+{
+  _console = (rxPin == 0) && (txPin == 0);
+}
+
+void HardwareSerial::begin(unsigned long, uint8_t)
+{
+}
+
+void HardwareSerial::swap()
+{
+}
+
+
+/**************************************************************************/
+/*
+    print()
+
+    Print value, "println()" adds new line
+*/
+/**************************************************************************/
+size_t HardwareSerial::print(const char *text)
+{
+  return write((const uint8_t *)text, strlen(text));
+}
+
+size_t HardwareSerial::print(char value)
+{
+  return write(value);
+}
+
+size_t HardwareSerial::print(int value)
+{
+  return print((long)value);
+}
+
+size_t HardwareSerial::print(unsigned int value)
+{
+  return print((unsigned long)value);
+}
+
+size_t HardwareSerial::print(long value)
+{
+  char text[24];
+
+  snprintf(text, sizeof(text), "%ld", value);
+
+  return print(text);
+}
+
+size_t HardwareSerial::print(unsigned long value)
+{
+  char text[24];
+
+  snprintf(text, sizeof(text), "%lu", value);
+
+  return print(text);
+}
+
+
+int HardwareSerial::available()
+{
+  return 0;
+}
+
+int HardwareSerial::read()
+{
+  return -1;
+}
+
+int HardwareSerial::peek()
+{
+  return -1;
+}
+
+size_t HardwareSerial::write(uint8_t data)
+{
+  if (_console == true) {putchar(data);}
+
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (_console == true) {fwrite(buffer, 1, size, stdout);}
+
+  return size;
+}
+
+
+/**************************************************************************/
+/*
+    main()
+
+    Arduino startup, "setup()" once & "loop()" forever
+*/
+/**************************************************************************/
+int main()
+{
+  setup();
+
+  while (true) {loop();}
+}
@@ -0,0 +1,69 @@
+/***************************************************************************************************/
+/*
+   This is a board stub for building DFPlayer library examples on Linux host
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - sketch is force included after this file, see "make sketches"
+   - sketches are built only to measure code & data size, serial ports
+     are sinks, "Serial" prints to stdout
+   - STM32 pin names are numbered from 0, PA0..PA15 & PB0..PB15
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef SKETCH_HOST_h
+#define SKETCH_HOST_h
+
+#include "Arduino.h"
+
+
+#define SERIAL_8N1 0x06
+#define F(string)  (string)
+
+enum
+{
+  PA0 = 0, PA1,  PA2,  PA3,  PA4,  PA5,  PA6,  PA7,  PA8,  PA9,  PA10, PA11, PA12, PA13, PA14, PA15,
+  PB0,     PB1,  PB2,  PB3,  PB4,  PB5,  PB6,  PB7,  PB8,  PB9,  PB10, PB11, PB12, PB13, PB14, PB15
+};
+
+
+class HardwareSerial : public Stream
+{
+  public:
+   HardwareSerial(uint8_t rxPin = 0, uint8_t txPin = 0);
+
+   void   begin(unsigned long baud, uint8_t config = SERIAL_8N1);
+   void   swap();
+
+   size_t print(const char *text);
+   size_t print(char value);
+   size_t print(int value);
+   size_t print(unsigned int value);
+   size_t print(long value);
+   size_t print(unsigned long value);
+
+   template <typename T> size_t println(T value) {size_t size = print(value); return size + print("\r\n");}
+
+   int    available();
+   int    read();
+   int    peek();
+   size_t write(uint8_t data);
+   size_t write(const uint8_t *buffer, size_t size);
+
+  private:
+   bool   _console; //true=stdout, false=sink
+};
+
+extern HardwareSerial Serial;
+
+
+void setup();
+void loop();
+
+#endif
@@ -0,0 +1,45 @@
+/***************************************************************************************************/
+/*
+   This is a SoftwareSerial stub for building DFPlayer library examples on Linux host
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - covers EspSoftwareSerial & STM32 SoftwareSerial API used by examples,
+     port is a sink, see "Sketch.h"
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef SOFTWARE_SERIAL_HOST_h
+#define SOFTWARE_SERIAL_HOST_h
+
+#include "Sketch.h"
+
+
+#define SWSERIAL_8N1 0x1C
+
+
+class SoftwareSerial : public Stream
+{
+  public:
+   SoftwareSerial() {}
+   SoftwareSerial(uint8_t, uint8_t, bool = false) {}
+
+   void   begin(unsigned long) {}
+   void   begin(unsigned long, uint8_t, int8_t, int8_t, bool, int, int) {}
+   void   enableRx(bool)   {}
+   bool   listen()         {return true;}
+   bool   stopListening()  {return true;}
+
+   int    available()      {return 0;}
+   int    read()           {return -1;}
+   int    peek()           {return -1;}
+   size_t write(uint8_t)   {return 1;}
+};
+
+#endif
@@ -38,6 +38,76 @@
 #include "DFPlayer.h"
 
 
+/* built-in personality profiles, see "setProfile()" */
+const DFPLAYER_PROFILE DFPLAYER_PROFILE_YX5200 =
+{
+  DFPLAYER_CHECKSUM_0000, DFPLAYER_WAKEUP_SOURCE, 0, DFPLAYER_WAKEUP_DELAY, DFPLAYER_BOOT_DELAY, DFPLAYER_ALL_COMMANDS, DFPLAYER_ALL_QUERIES,
+  {{0x0200, 0}, {0x0201, 1}, {0x0202, 2}, {0x0002, 3}, {0x0001, 5}, {0x0000, 4}} //yy=02 TF-card & xx=00 stop/01 playing/02 pause, yy=00 & xx=02 sleep
+};
+
+const DFPLAYER_PROFILE DFPLAYER_PROFILE_YX5300 =
+{
+  DFPLAYER_CHECKSUM_0000, DFPLAYER_WAKEUP_NORMAL_MODE, 0, DFPLAYER_WAKEUP_DELAY, DFPLAYER_BOOT_DELAY,
+  DFPLAYER_ALL_COMMANDS & ~(DFPLAYER_ADVERT_COMMANDS | DFPLAYER_COMMAND_BIT(DFPLAYER_SET_DAC_GAIN)),
+  DFPLAYER_ALL_QUERIES  & ~(DFPLAYER_USB_QUERIES | DFPLAYER_FLASH_QUERIES),
+  {{0x0200, 0}, {0x0201, 1}, {0x0202, 2}, {0x0002, 3}, {0x0001, 5}, {0x0000, 4}}
+};
+
+const DFPLAYER_PROFILE DFPLAYER_PROFILE_JL_AAXXXX =
+{
+  DFPLAYER_CHECKSUM_0000, DFPLAYER_WAKEUP_SOURCE, 0, DFPLAYER_WAKEUP_DELAY, DFPLAYER_BOOT_DELAY,
+  DFPLAYER_ALL_COMMANDS & ~DFPLAYER_COMMAND_BIT(DFPLAYER_PLAY_ADVERT_FOLDER_N),
+  DFPLAYER_ALL_QUERIES  & ~DFPLAYER_FLASH_QUERIES,
+  {{0x0200, 0}, {0x0201, 1}, {0x0202, 2}, {0x0002, 3}, {0x0001, 5}, {0x0000, 4}}
+};
+
+const DFPLAYER_PROFILE DFPLAYER_PROFILE_FN6100 =
+{
+  DFPLAYER_CHECKSUM_FFFF, DFPLAYER_WAKEUP_SOURCE, 0, DFPLAYER_WAKEUP_DELAY, DFPLAYER_BOOT_DELAY, DFPLAYER_ALL_COMMANDS, DFPLAYER_ALL_QUERIES,
+  {{0x0200, 0}, {0x0201, 1}, {0x0202, 2}, {0x0002, 3}, {0x0001, 5}, {0x0000, 4}}
+};
+
+const DFPLAYER_PROFILE DFPLAYER_PROFILE_GD3200B =
+{
+  DFPLAYER_CHECKSUM_0000, DFPLAYER_WAKEUP_SOURCE, DFPLAYER_DELAY_TIMEOUT, DFPLAYER_WAKEUP_DELAY, DFPLAYER_BOOT_DELAY,
+  DFPLAYER_ALL_COMMANDS,
+  DFPLAYER_ALL_QUERIES  & ~DFPLAYER_QUERY_BIT(DFPLAYER_GET_QNT_FOLDERS),
+  {{0x0200, 0}, {0x0201, 1}, {0x0202, 2}, {0x0002, 3}, {0x0001, 1}, {0x0000, 0}} //GD3200B reports yy=00 & xx=00 stop/01 playing
+};
+
+const DFPLAYER_PROFILE DFPLAYER_PROFILE_MH2024K =
+{
+  DFPLAYER_CHECKSUM_0000, DFPLAYER_WAKEUP_SOURCE, DFPLAYER_DELAY_TIMEOUT, DFPLAYER_WAKEUP_DELAY, DFPLAYER_BOOT_DELAY,
+  DFPLAYER_ALL_COMMANDS,
+  DFPLAYER_ALL_QUERIES  & ~(DFPLAYER_QUERY_BIT(DFPLAYER_GET_QNT_FOLDERS) | DFPLAYER_FLASH_QUERIES),
+  {{0x0200, 0}, {0x0201, 1}, {0x0202, 2}, {0x0002, 3}, {0x0001, 1}, {0x0000, 0}} //same status decoding as GD3200B
+};
+
+const DFPLAYER_PROFILE DFPLAYER_PROFILE_NO_CHECKSUM =
+{
+  DFPLAYER_CHECKSUM_NONE, DFPLAYER_WAKEUP_SOURCE, 0, DFPLAYER_WAKEUP_DELAY, DFPLAYER_BOOT_DELAY, DFPLAYER_ALL_COMMANDS, DFPLAYER_ALL_QUERIES,
+  {{0x0200, 0}, {0x0201, 1}, {0x0202, 2}, {0x0002, 3}, {0x0001, 5}, {0x0000, 4}}
+};
+
+#if (DFPLAYER_SNAPSHOT == 1)
+static const DFPLAYER_PROFILE *const DFPLAYER_SNAPSHOT_PROFILES[] =                //built-in profiles by PROFILE byte of snapshot, never reorder
+{
+  &DFPLAYER_PROFILE_YX5200, &DFPLAYER_PROFILE_FN6100, &DFPLAYER_PROFILE_GD3200B, &DFPLAYER_PROFILE_NO_CHECKSUM,
+  &DFPLAYER_PROFILE_YX5300, &DFPLAYER_PROFILE_JL_AAXXXX, &DFPLAYER_PROFILE_MH2024K
+};
+#endif
+
+#if (DFPLAYER_DURATION_TABLE_SIZE != 0) && (DFPLAYER_SHARED_DURATIONS == 1)
+DFPLAYER_DURATION DFPlayer::_durations[DFPLAYER_DURATION_TABLE_SIZE]; //learned track durations shared by all instances, see DFPLAYER_SHARED_DURATIONS
+#endif
+
+#if (DFPLAYER_TX_BATCH > 1)
+DFPlayer *DFPlayer::_txBatchOwner = NULL;                                      //see "_openBatch()"
+uint8_t   DFPlayer::_txBatch[DFPLAYER_TX_BATCH * DFPLAYER_UART_FRAME_SIZE];
+uint16_t  DFPlayer::_txBatchLength = 0;
+#endif
+
+
 /**************************************************************************/
 /*
     Constructor
@@ -76,10 +146,91 @@ void DFPlayer::begin(Stream &stream, uint16_t threshold, DFPLAYER_MODULE_TYPE mo
   _serial     = &stream;    //serial stream
   _threshold  = threshold;  //timeout for feedback (delay after read command), in msec
   _ack        = feedback;   //0x01=module return feedback after the command, 0x00=module not return feedback after the command
-  _moduleType = moduleType; //DFPlayer or Clone, differ in how checksum is calculated
 
-  if (bootDelay == true) {delay(DFPLAYER_BOOT_DELAY);} //wait for player to boot
+  setModel(moduleType);     //DFPlayer or Clone, differ in checksum, timing & status decoding
+
+  _rxIndex         = 0;
+  _commandStatus   = 0;
+  _playing         = false;
+  _looping         = false;
+  _queueHead       = 0;
+  _queueCount      = 0;
+  _nonBlocking     = false;                 //write commands wait for pacing gap by default
+
+  _busyPin         = DFPLAYER_NO_BUSY_PIN;
+  _busyLow         = false;
+  _pausePending    = false;
+  _source          = 2;                     //TF-Card selected by default
+  _playKnown       = false;
+  _playFolder      = DFPLAYER_FOLDER_ROOT;
+  _playTrack       = 0;
+  _finishedTrack   = DFPLAYER_TRACK_NONE;
+  _lastFinished    = DFPLAYER_TRACK_UNKNOWN;
+  _trackMismatch   = false;
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  _powerState      = DFPLAYER_POWER_ACTIVE;
+  _wakeupSource    = 2;
+  _wakeupScheduled = false;
+  _wakeupProbe     = false;
+  _wakeupRetry     = false;
+  _wakeupLatency   = _profile->sourceDelay;
+  _idleTimeout     = 0;                     //power manager disabled by default
+  #endif
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  _groupPos          = 0;
+  _groupLength       = 0;
+  _groupOpen         = false;
+  _groupFailed       = false;
+  _groupStarted      = false;
+  _transactionStatus = DFPLAYER_TRANSACTION_NONE;
+  #endif
+
+  #if (DFPLAYER_CONFIG_RESTORE == 1)
+  _volume            = DFPLAYER_CONFIG_UNKNOWN;
+  _eq                = DFPLAYER_CONFIG_UNKNOWN;
+  _dacGain           = DFPLAYER_CONFIG_UNKNOWN;
+  _restoreStep       = 0;
+  _dacDisabled       = false;
+  _dacGainEnabled    = false;
+  _restorePending    = false;
+  _configRestored    = false;
+  #endif
+
+  #if (DFPLAYER_HALF_DUPLEX == 1)
+  _halfDuplex        = false;
+  _txHeld            = false;
+  _collisions        = 0;
+  _framesLost        = 0;
+  #endif
+
+  #if (DFPLAYER_TRIGGER == 1)
+  _triggerLength     = 0;
+  _triggerPending    = false;
+  _triggerLatency    = 0;
+  _triggerLatencyMax = 0;
+  #endif
+
+  #if (DFPLAYER_DURATION_TABLE_SIZE != 0) && (DFPLAYER_SHARED_DURATIONS == 0)
+  memset(_durations, 0x00, sizeof(_durations)); //shared table is kept, other players may already use it
+  #endif
+
+  if (bootDelay == true) {delay(_profile->bootDelay);} //wait for player to boot
 //if (millis() < 6000) {delay(6000 - millis());        //minimum 2100msec + 3000msec = 5100msec, see NOTE
+
+  _txReadyTime  = millis();
+  _txDoneTime   = micros();
+  _finishedTime = _txReadyTime - DFPLAYER_FINISHED_WINDOW; //first "track finished" isn't duplicate
+  _playStart    = _txReadyTime;
+  _pauseStart   = _txReadyTime;
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  _lastActivity = _txReadyTime;
+  _stateStart   = _txReadyTime;
+
+  memset(_powerStateTime, 0x00, sizeof(_powerStateTime));
+  #endif
 }
 
 
@@ -105,12 +256,73 @@ void DFPlayer::begin(Stream &stream, uint16_t threshold, DFPLAYER_MODULE_TYPE mo
           crystal oscillator)
 
     - DFPlayer clones have more or less the same commands, the difference
-      is in the checksum calculation
+      is in the checksum calculation, timing & status decoding
+    - selects built-in personality profile, see "setProfile()"
 */
 /**************************************************************************/
 void DFPlayer::setModel(DFPLAYER_MODULE_TYPE moduleType)
 {
-  _moduleType = moduleType;
+  switch (moduleType)
+  {
+    case DFPLAYER_FN_X10P:
+      setProfile(DFPLAYER_PROFILE_FN6100);
+      break;
+
+    case DFPLAYER_HW_247A:
+      setProfile(DFPLAYER_PROFILE_GD3200B);
+      break;
+
+    case DFPLAYER_NO_CHECKSUM:
+      setProfile(DFPLAYER_PROFILE_NO_CHECKSUM);
+      break;
+
+    case DFPLAYER_MINI:
+    default:
+      setProfile(DFPLAYER_PROFILE_YX5200);
+      break;
+  }
+}
+
+
+/**************************************************************************/
+/*
+    setProfile()
+
+    Set chip personality profile
+
+    NOTE:
+    - built-in profiles:
+      - DFPLAYER_PROFILE_YX5200, DFPLAYER_PROFILE_YX5300,
+        DFPLAYER_PROFILE_JL_AAXXXX
+      - DFPLAYER_PROFILE_FN6100
+      - DFPLAYER_PROFILE_GD3200B, DFPLAYER_PROFILE_MH2024K
+      - DFPLAYER_PROFILE_NO_CHECKSUM
+    - for a new clone copy closest built-in profile & change checksum,
+      timing, supported commands or status decoding
+    - profile is not copied, it must exist as long as the class
+*/
+/**************************************************************************/
+void DFPlayer::setProfile(const DFPLAYER_PROFILE &profile)
+{
+  _profile = &profile;
+}
+
+
+/**************************************************************************/
+/*
+    isSupported()
+
+    Check if command is supported by current profile
+
+    NOTE:
+    - unsupported write command isn't sent, unsupported read command
+      returns "0" without waiting for timeout
+*/
+/**************************************************************************/
+bool DFPlayer::isSupported(uint8_t command)
+{
+  if (command >= DFPLAYER_GET_STATUS) {return (_profile->queries  & DFPLAYER_QUERY_BIT(command))   != 0;}
+                                       return (_profile->commands & DFPLAYER_COMMAND_BIT(command)) != 0;
 }
 
 
@@ -146,6 +358,76 @@ void DFPlayer::setFeedback(bool enable)
 }
 
 
+#if (DFPLAYER_CALIBRATION == 1)
+/**************************************************************************/
+/*
+    calibrateGap()
+
+    Find smallest reliable gap between commands & set it as profile
+    write delay, return new write delay in msec
+
+    NOTE:
+    - bursts of "getVolume()" queries are sent at tested gap, gap is
+      reliable if module replied to every query of the burst, lost reply
+      means module was still busy with previous frame & ignored next one
+    - gap is counted from last stop bit of previous frame, search starts
+      at profile write delay or at feedback timeout if profile has none,
+      back-to-back queries are tried next, then tested range is halved
+      down to DFPLAYER_CALIBRATION_STEP
+    - DFPLAYER_CALIBRATION_MARGIN percent, at least
+      DFPLAYER_CALIBRATION_MARGIN_MIN msec, is added to found gap, also
+      to zero gap, clones differ between production batches
+    - profile must be writable copy of built-in profile, set it by
+      "setProfile()" to apply result, save result to EEPROM & skip
+      calibration on next boot
+    - blocks for about 1sec per tested gap, queued commands are sent
+      first, module must be awake
+    - on half-duplex transport replies may collide with next query, found
+      gap is longer than needed, see "setHalfDuplex()"
+    - return DFPLAYER_CALIBRATION_FAILED & profile isn't changed if
+      module doesn't reply at starting gap or doesn't support "getVolume()"
+*/
+/**************************************************************************/
+uint16_t DFPlayer::calibrateGap(DFPLAYER_PROFILE &profile, uint8_t burst)
+{
+  if ((isSupported(DFPLAYER_GET_VOL) == false) || (burst < 2)) {return DFPLAYER_CALIBRATION_FAILED;}
+
+  _drainQueue();
+
+  delay(_getTxDelay());                                               //module finished previous command
+
+  uint16_t reliable = _getDelay(profile.writeDelay);                  //smallest gap without lost replies
+  uint16_t failed   = 0;                                              //largest gap with lost replies
+
+  if (reliable == 0) {reliable = _threshold;}
+
+  if (_testGap(reliable, burst) == false) {return DFPLAYER_CALIBRATION_FAILED;}
+
+  if (_testGap(0, burst) == true) {reliable = 0;}                     //module takes back-to-back commands
+
+  while ((reliable - failed) > DFPLAYER_CALIBRATION_STEP)
+  {
+    uint16_t gap = failed + ((reliable - failed) / 2);
+
+    if (_testGap(gap, burst) == true) {reliable = gap;}
+    else                              {failed   = gap;}
+  }
+
+  uint32_t margin = ((uint32_t)reliable * DFPLAYER_CALIBRATION_MARGIN) / 100;
+
+  if (margin < DFPLAYER_CALIBRATION_MARGIN_MIN) {margin = DFPLAYER_CALIBRATION_MARGIN_MIN;} //also if back-to-back burst passed, one lucky burst isn't proof
+
+  margin += reliable;
+
+  reliable = (margin < DFPLAYER_DELAY_TIMEOUT) ? margin : (DFPLAYER_DELAY_TIMEOUT - 1);     //DFPLAYER_DELAY_TIMEOUT has own meaning
+
+  profile.writeDelay = reliable;
+
+  return reliable;
+}
+#endif
+
+
 /**************************************************************************/
 /*
     setSource()
@@ -165,7 +447,9 @@ void DFPlayer::setFeedback(bool enable)
     - module automatically detect source if source is on-line
     - module automatically enter standby after setting source
     - this command interrupt playback!!!
-    - wait 200ms to select source
+    - wait 200ms to select source, see "DFPLAYER_PROFILE"
+    - in non-blocking mode doesn't wait, next command waits for source in
+      TX queue, see "_writeFrame()"
 */
 /**************************************************************************/
 void DFPlayer::setSource(uint8_t source)
@@ -174,7 +458,11 @@ void DFPlayer::setSource(uint8_t source)
 
   _sendData(DFPLAYER_SET_PLAY_SRC, 0, source);
 
-  if (source != 6) {delay(200);} //6=Sleep
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  if (_groupOpen == true) {return;}                                         //next command of transaction waits for source, see "_sendNext()"
+  #endif
+
+  if ((_nonBlocking == false) && (source != 6)) {delay(_profile->sourceDelay);} //6=Sleep
 }
 
 
@@ -699,9 +987,13 @@ void DFPlayer::enableStandby(bool enable, uint8_t source)
   {
     _sendData(DFPLAYER_SET_STANDBY_MODE, 0, 0);
   }
+  else if (_profile->wakeup == DFPLAYER_WAKEUP_NORMAL_MODE)
+  {
+    _sendData(DFPLAYER_SET_NORMAL_MODE, 0, 0);
+  }
   else
   {
-   wakeup(source); //for some reason "DFPLAYER_SET_NORMAL_MODE" doesn't work here
+    wakeup(source); //for some reason "DFPLAYER_SET_NORMAL_MODE" doesn't work on most chips, see "DFPLAYER_PROFILE"
   }
 }
 
@@ -713,14 +1005,23 @@ void DFPlayer::enableStandby(bool enable, uint8_t source)
     Reset all settings to factory default
 
     NOTE:
-    - wait for player to boot, 1.5sec..3sec depends on SD-card size
+    - wait for player to boot, 1.5sec..3sec depends on SD-card size,
+      "ready" feedback ends wait early
+    - in non-blocking mode commands wait in TX queue until player boots,
+      see "_writeFrame()"
+    - settings sent before reset are restored after boot, in non-blocking
+      mode by "update()", see "isConfigRestored()"
 */
 /**************************************************************************/
 void DFPlayer::reset()
 {
   _sendData(DFPLAYER_RESET, 0, 0);
 
-  delay(DFPLAYER_BOOT_DELAY); //wait for player to boot
+  #if (DFPLAYER_CONFIG_RESTORE == 1)
+  if (_nonBlocking == true) {return;}
+
+  while (_restorePending == true) {_restoreConfig();}
+  #endif
 }
 
 
@@ -750,35 +1051,52 @@ void DFPlayer::reset()
         - xx=00 stop (for GD3200B chip only)
         - xx=01 playing (for GD3200B chip only)
         - xx=02 standby/sleep
+    - decoding differs between chips, see "DFPLAYER_PROFILE"
 */
 /**************************************************************************/
 uint8_t DFPlayer::getStatus()
 {
-  _sendData(DFPLAYER_GET_STATUS, 0, 0);
+  return getStatusResult().value;
+}
 
-  switch (_getResponse(DFPLAYER_GET_STATUS))
-  {
-    case 0x0200:    
-      return 0; //TF-card stop
 
-    case 0x0201:
-      return 1; //TF-card playing
+/**************************************************************************/
+/*
+    getStatusResult()
 
-    case 0x0202:
-      return 2; //TF-card pause
+    Get current module status & status of query, see "getStatus()"
 
-    case 0x0002:
-      return 3; //sleep or standby
+    NOTE:
+    - value is 4=communication error if status isn't DFPLAYER_RESULT_OK,
+      see "DFPLAYER_RESULT"
+    - response 0x0000 is a valid state for some chips, e.g. GD3200B stop,
+      status tells it apart from timeout
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getStatusResult()
+{
+  _sendData(DFPLAYER_GET_STATUS, 0, 0);
 
-    case 0x0001:
-      return ((_moduleType != DFPLAYER_HW_247A) ? 5 : 1); //5=unknown state, 1=GD3200B playing
+  DFPLAYER_RESULT result = _getResponse(DFPLAYER_GET_STATUS);
 
-    case 0x0000:
-      return ((_moduleType != DFPLAYER_HW_247A) ? 4 : 0); //4=communication error, 0=GD3200B stop
+  if (result.status != DFPLAYER_RESULT_OK)
+  {
+    result.value = 4; //communication error
+    return result;
+  }
 
-    default:
-      return 5; //unknown state
+  for (uint8_t i = 0; i < DFPLAYER_STATUS_CODES; i++)
+  {
+    if (_profile->status[i].response == result.value) //see "DFPLAYER_PROFILE"
+    {
+      result.value = _profile->status[i].status;
+      return result;
+    }
   }
+
+  result.value = 5; //unknown state
+
+  return result;
 }
 
 
@@ -795,6 +1113,22 @@ uint8_t DFPlayer::getStatus()
 */
 /**************************************************************************/
 uint8_t DFPlayer::getVolume()
+{
+  return getVolumeResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getVolumeResult()
+
+    Get current volume & status of query, see "getVolume()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getVolumeResult()
 {
   _sendData(DFPLAYER_GET_VOL, 0, 0);
 
@@ -816,6 +1150,22 @@ uint8_t DFPlayer::getVolume()
 */
 /**************************************************************************/
 uint8_t DFPlayer::getEQ()
+{
+  return getEQResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getEQResult()
+
+    Get current EQ & status of query, see "getEQ()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getEQResult()
 {
   _sendData(DFPLAYER_GET_EQ, 0, 0);
 
@@ -837,6 +1187,22 @@ uint8_t DFPlayer::getEQ()
 */
 /**************************************************************************/
 uint8_t DFPlayer::getPlayMode()
+{
+  return getPlayModeResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getPlayModeResult()
+
+    Get current play mode & status of query, see "getPlayMode()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getPlayModeResult()
 {
   _sendData(DFPLAYER_GET_PLAY_MODE, 0, 0);
 
@@ -862,6 +1228,22 @@ uint8_t DFPlayer::getPlayMode()
 */
 /**************************************************************************/
 uint8_t DFPlayer::getVersion()
+{
+  return getVersionResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getVersionResult()
+
+    Get software version & status of query, see "getVersion()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getVersionResult()
 {
   _sendData(DFPLAYER_GET_VERSION, 0, 0);
 
@@ -882,6 +1264,22 @@ uint8_t DFPlayer::getVersion()
 */
 /**************************************************************************/
 uint16_t DFPlayer::getTotalTracksSD()
+{
+  return getTotalTracksSDResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getTotalTracksSDResult()
+
+    Get total number of tracks on TF-Card & status of query, see "getTotalTracksSD()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTotalTracksSDResult()
 {
   _sendData(DFPLAYER_GET_QNT_TF_FILES, 0, 0);
 
@@ -901,6 +1299,22 @@ uint16_t DFPlayer::getTotalTracksSD()
 */
 /**************************************************************************/
 uint16_t DFPlayer::getTotalTracksUSB()
+{
+  return getTotalTracksUSBResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getTotalTracksUSBResult()
+
+    Get total number of tracks on USB-Disk & status of query, see "getTotalTracksUSB()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTotalTracksUSBResult()
 {
   _sendData(DFPLAYER_GET_QNT_USB_FILES, 0, 0);
 
@@ -921,6 +1335,22 @@ uint16_t DFPlayer::getTotalTracksUSB()
 */
 /**************************************************************************/
 uint16_t DFPlayer::getTotalTracksNORFlash()
+{
+  return getTotalTracksNORFlashResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getTotalTracksNORFlashResult()
+
+    Get total number of tracks on NOR-Flash & status of query, see "getTotalTracksNORFlash()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTotalTracksNORFlashResult()
 {
   _sendData(DFPLAYER_GET_QNT_FLASH_FILES, 0, 0);
 
@@ -941,6 +1371,22 @@ uint16_t DFPlayer::getTotalTracksNORFlash()
 */
 /**************************************************************************/
 uint16_t DFPlayer::getTrackSD()
+{
+  return getTrackSDResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getTrackSDResult()
+
+    Get currently playing track number on TF-Card & status of query, see "getTrackSD()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTrackSDResult()
 {
   _sendData(DFPLAYER_GET_TF_TRACK, 0, 0);
 
@@ -961,6 +1407,22 @@ uint16_t DFPlayer::getTrackSD()
 */
 /**************************************************************************/
 uint16_t DFPlayer::getTrackUSB()
+{
+  return getTrackUSBResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getTrackUSBResult()
+
+    Get currently playing track number on USB-Disk & status of query, see "getTrackUSB()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTrackUSBResult()
 {
   _sendData(DFPLAYER_GET_USB_TRACK, 0, 0);
 
@@ -980,6 +1442,22 @@ uint16_t DFPlayer::getTrackUSB()
 */
 /**************************************************************************/
 uint16_t DFPlayer::getTrackNORFlash()
+{
+  return getTrackNORFlashResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getTrackNORFlashResult()
+
+    Get currently playing track number on NOR-Flash & status of query, see "getTrackNORFlash()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTrackNORFlashResult()
 {
   _sendData(DFPLAYER_GET_FLASH_TRACK, 0, 0);
 
@@ -999,6 +1477,22 @@ uint16_t DFPlayer::getTrackNORFlash()
 */
 /**************************************************************************/
 uint8_t DFPlayer::getTotalTracksFolder(uint8_t folder)
+{
+  return getTotalTracksFolderResult(folder).value;
+}
+
+
+/**************************************************************************/
+/*
+    getTotalTracksFolderResult()
+
+    Get total number of tracks in folder & status of query, see "getTotalTracksFolder()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTotalTracksFolderResult(uint8_t folder)
 {
   _sendData(DFPLAYER_GET_QNT_FOLDER_FILES, 0, folder);
 
@@ -1023,6 +1517,22 @@ uint8_t DFPlayer::getTotalTracksFolder(uint8_t folder)
 */
 /**************************************************************************/
 uint8_t DFPlayer::getTotalFolders()
+{
+  return getTotalFoldersResult().value;
+}
+
+
+/**************************************************************************/
+/*
+    getTotalFoldersResult()
+
+    Get total number of root folders in current source & status of query, see "getTotalFolders()"
+
+    NOTE:
+    - value is "0" if status isn't DFPLAYER_RESULT_OK, see "DFPLAYER_RESULT"
+*/
+/**************************************************************************/
+DFPLAYER_RESULT DFPlayer::getTotalFoldersResult()
 {
   _sendData(DFPLAYER_GET_QNT_FOLDERS, 0, 0);
 
@@ -1061,137 +1571,2936 @@ uint8_t DFPlayer::getTotalFolders()
 /**************************************************************************/
 uint8_t DFPlayer::getCommandStatus()
 {
-  switch (_dataBuffer[3])
-  {
-    case DFPLAYER_RETURN_ERROR:
-      return _dataBuffer[6]; //error values, see NOTE
-
-    case DFPLAYER_RETURN_CODE_OK_ACK:
-      return 0x0B;
-
-    case DFPLAYER_RETURN_CODE_DONE:
-      return 0x0C;
-
-    case DFPLAYER_RETURN_CODE_READY:
-      return 0x0D;
-
-    default:
-      return 0x00;
-  }
+  return _commandStatus;
 }
 
 
-/**********************************private*********************************/
+#if (DFPLAYER_CONFIG_RESTORE == 1)
 /**************************************************************************/
 /*
-    _sendData()
+    isConfigRestored()
 
-    Send data via Serial port
+    Check if settings were restored after reset or unexpected reboot since
+    last call
 
     NOTE:
-    - DFPlayer TX data frame format:
+    - module returns to factory defaults after "reset()", brown-out or
+      power loss & sends "ready" feedback, see "_parseEvent()"
+    - only settings sent by library & different from factory defaults are
+      restored: source, volume, EQ, DAC & DAC gain, playback isn't resumed
+    - settings are sent back to back with pacing gap only, queued commands
+      wait until all settings are restored
+    - after unexpected reboot settings are restored by "update()"
+*/
+/**************************************************************************/
+bool DFPlayer::isConfigRestored()
+{
+  bool restored = _configRestored;
+
+  _configRestored = false;
+
+  return restored;
+}
+#endif
+
+
+#if (DFPLAYER_POWER_MANAGER == 1)
+/**************************************************************************/
+/*
+    setIdleTimeout()
+
+    Enable power manager, put module in standby after idle period
+
+    NOTE:
+    - idleTime in msec, 0=disable power manager
+    - module is idle when nothing is playing & no command was sent during
+      "idleTime"
+    - any playback command wakes module up by selecting "source", write
+      commands sent before module is ready are queued & sent by "update()",
+      read command blocks by "delay()" for the rest of wake up time, even
+      in non-blocking mode, see "setNonBlocking()"
+    - "update()" must be called in the main loop
+    - wake up time is refined from module reply only if feedback is
+      enabled, otherwise profile source delay is used, see
+      "getWakeupLatency()"
+    - "0" in standby or during wake up wakes module up first & blocks by
+      "delay()" for the rest of wake up time, commands after it aren't lost
+
+    - source:
+      - 1=USB-Disk
+      - 2=TF-Card
+      - 3=Aux
+      - 5=NOR-Flash
+    - source 3..5 may not be supported by some modules!!!
+*/
+/**************************************************************************/
+void DFPlayer::setIdleTimeout(uint32_t idleTime, uint8_t source)
+{
+  _idleTimeout  = idleTime;
+  _wakeupSource = ((source != 4) && (source != 6)) ? constrain(source, 1, 5) : 2; //4=sleep for YX5200 & 6=Sleep prohibited
+  _lastActivity = millis();
+
+  if ((_idleTimeout == 0) && (_powerState != DFPLAYER_POWER_ACTIVE))
+  {
+    if (_powerState == DFPLAYER_POWER_STANDBY) {_startWakeup();}       //module is still in standby
+
+    uint32_t elapsed = millis() - _stateStart;
+
+    if (elapsed < _wakeupLatency) {delay(_wakeupLatency - elapsed);} //"update()" doesn't finish wake up without power manager
+
+    _finishWakeup();
+    _drainQueue();
+  }
+}
+
+
+/**************************************************************************/
+/*
+    scheduleWakeup()
+
+    Wake module up ahead of known playback time
+
+    NOTE:
+    - playbackTime is absolute "millis()" value of upcoming playback
+    - module is woken up "getWakeupLatency()" msec before "playbackTime",
+      so first playback command is sent without waiting for source
+    - only one wake up can be scheduled, new call replaces previous one
+*/
+/**************************************************************************/
+void DFPlayer::scheduleWakeup(uint32_t playbackTime)
+{
+  _wakeupTime      = playbackTime;
+  _wakeupScheduled = true;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    setNonBlocking()
+
+    Enable/disable non-blocking write commands
+
+    NOTE:
+    - true=write commands never wait, commands sent during pacing gap are
+      queued & sent by "update()", if TX queue is full oldest queued
+      command is sent first, so command waits for one pacing gap & order
+      is kept, see DFPLAYER_QUEUE_SIZE
+    - false=write commands wait for pacing gap, like GD3200B/MH2024K delay
+      after write command
+    - read commands always block until module response, queued commands
+      are sent before read command
+*/
+/**************************************************************************/
+void DFPlayer::setNonBlocking(bool enable)
+{
+  if (enable == false) {_drainQueue();}
+
+  _nonBlocking = enable;
+}
+
+
+/**************************************************************************/
+/*
+    update()
+
+    Process module feedback, TX queue & power manager, call it in the main
+    loop
+
+    NOTE:
+    - collects unsolicited feedback, like "track finished" or "ready after
+      reset", without blocking
+    - sends queued commands as soon as pacing & wake up allow, puts module
+      in standby after idle period, see "setIdleTimeout()"
+    - never waits for pacing gap, also in blocking mode
+
+    - return time until library needs next "update()" call, in msec
+      - 0, call again as soon as possible
+      - DFPLAYER_NO_DEADLINE, nothing pending, only module feedback
+        can change state, see "isRxWakeupNeeded()"
+    - MCU can sleep until deadline or until next byte on RX-pin
+*/
+/**************************************************************************/
+uint32_t DFPlayer::update()
+{
+  _readEvents();
+
+  #if (DFPLAYER_TRIGGER == 1)
+  _checkTrigger();
+  #endif
+
+  _checkBusyPin();
+
+  uint32_t deadline = DFPLAYER_NO_DEADLINE;
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if (_idleTimeout != 0)
+  {
+    uint32_t timeNow     = millis();
+    bool     nonBlocking = _nonBlocking;
+
+    switch (_powerState)
+    {
+      case DFPLAYER_POWER_ACTIVE:
+        if ((_wakeupScheduled == true) && ((int32_t)(_wakeupTime - timeNow) <= 0)) {_wakeupScheduled = false;} //playback time passed
+
+        if ((_playing == true) || (_queueCount != 0)) {break;}                                                 //"track finished" feedback or queue will restart idle timer
+
+        if ((timeNow - _lastActivity) < _idleTimeout)
+        {
+          deadline = _idleTimeout - (timeNow - _lastActivity);
+          break;
+        }
+
+        if ((_wakeupScheduled == true) && ((_wakeupTime - timeNow) <= (_idleTimeout + _wakeupLatency)))        //playback is coming soon, stay awake
+        {
+          deadline = _wakeupTime - timeNow;
+          break;
+        }
+
+        if (_getTxDelay() != 0)                                                                                 //standby waits for pacing gap, "update()" never blocks
+        {
+          deadline = _getTxDelay();
+          break;
+        }
+
+        _nonBlocking = true;                                                                                   //gap after standby is kept by next command, see "_writeFrame()"
+        _writeFrame(DFPLAYER_SET_STANDBY_MODE, 0, 0);
+        _nonBlocking = nonBlocking;
+        break;
+
+      case DFPLAYER_POWER_WAKING:
+        if ((timeNow - _stateStart) < _wakeupLatency)
+        {
+          deadline = _wakeupLatency - (timeNow - _stateStart);
+          break;
+        }
+
+        _finishWakeup();
+
+        deadline = _idleTimeout;
+        break;
+
+      case DFPLAYER_POWER_STANDBY:
+        if (_wakeupScheduled == false) {break;}
+
+        if ((int32_t)(_wakeupTime - timeNow) > (int32_t)_wakeupLatency)
+        {
+          deadline = _wakeupTime - timeNow - _wakeupLatency;
+          break;
+        }
+
+        _wakeupScheduled = false;
+
+        _startWakeup();
+
+        deadline = _wakeupLatency;
+        break;
+    }
+  }
+  #endif
+
+  if ((_busyPin != DFPLAYER_NO_BUSY_PIN) && (_playing == false) && (_busyLow == true)) {deadline = 1;} //pause frame is on the way, see "_checkBusyPin()"
+
+  if ((_busyPin != DFPLAYER_NO_BUSY_PIN) && (_playing == true))                    //poll BUSY-pin
+  {
+    uint32_t remaining = (_busyLow == true) ? getRemaining() : 0;                  //pin must be seen low before track end
+    uint32_t busyPoll  = (remaining != 0)   ? remaining      : DFPLAYER_BUSY_POLL;
+
+    if (busyPoll < deadline) {deadline = busyPoll;}
+  }
+
+  #if (DFPLAYER_TRIGGER == 1)
+  if (_triggerPending == true) {deadline = 1;}                                     //poll trigger pin
+  #endif
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if (_powerState == DFPLAYER_POWER_WAKING) {return deadline;}                      //queued commands wait for wake up
+  #endif
+
+  #if (DFPLAYER_CONFIG_RESTORE == 1)
+  while ((_restorePending == true) && (_getTxDelay() == 0)) {_restoreConfig();}
+
+  if (_restorePending == true)                                                      //queued commands wait for restored settings
+  {
+    uint32_t txDelay = _getTxDelay();
+
+    return (txDelay < deadline) ? txDelay : deadline;
+  }
+  #endif
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if ((_wakeupRetry == true) && (_getTxDelay() == 0))
+  {
+    _wakeupRetry = false;
+
+    _writeFrame(_wakeupCommand.command, _wakeupCommand.dataMSB, _wakeupCommand.dataLSB); //module wasn't ready, see "_parseEvent()"
+
+    if (_wakeupLatency < DFPLAYER_WAKEUP_DELAY_MAX) {_startProbe();}                    //check again, wait grows until module accepts
+  }
+  #endif
+
+  _sendQueue();
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if (_wakeupRetry == true)
+  {
+    uint32_t txDelay = _getTxDelay();
+
+    if (txDelay < deadline) {deadline = txDelay;}
+  }
+  #endif
+
+  if (_queueCount != 0)
+  {
+    uint32_t txDelay = _getTxDelay();
+
+    if (txDelay < deadline) {deadline = txDelay;}
+  }
+
+  return deadline;
+}
+
+
+/**************************************************************************/
+/*
+    isRxWakeupNeeded()
+
+    Check if MCU sleeping between "update()" calls should wake up on RX-pin
+    activity
+
+    NOTE:
+    - true=module feedback is expected, like "track finished" or reply
+      to the first command after wake up, or frame is partially received
+    - module sends "ready" feedback after brown-out at any time, keep RX
+      wake up enabled if it matters
+*/
+/**************************************************************************/
+bool DFPlayer::isRxWakeupNeeded()
+{
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if (_wakeupProbe == true) {return true;}
+  #endif
+
+  return (_playing == true) || (_rxIndex != 0);
+}
+
+
+#if (DFPLAYER_HALF_DUPLEX == 1)
+/**************************************************************************/
+/*
+    setHalfDuplex()
+
+    Enable/disable TX scheduling for half-duplex transport
+
+    NOTE:
+    - true=transport can't receive while transmitting, e.g. SoftwareSerial
+      on AVR or old EspSoftwareSerial, query sent while module sends
+      "track finished" feedback breaks both frames
+    - write commands wait while RX frame is in progress, start byte was
+      received & frame isn't complete, & are sent in quiet window
+    - in non-blocking mode write commands wait in TX queue, see "update()"
+    - incomplete frame is dropped after DFPLAYER_RX_FRAME_TIMEOUT
+    - "trigger()" never waits
+*/
+/**************************************************************************/
+void DFPlayer::setHalfDuplex(bool enable)
+{
+  _halfDuplex = enable;
+  _txHeld     = false;
+}
+
+
+/**************************************************************************/
+/*
+    getCollisionsAvoided()
+
+    Get number of write commands delayed until RX frame was received
+
+    NOTE:
+    - see "setHalfDuplex()"
+    - value overflows after 65535
+*/
+/**************************************************************************/
+uint16_t DFPlayer::getCollisionsAvoided()
+{
+  return _collisions;
+}
+
+
+/**************************************************************************/
+/*
+    getFramesLost()
+
+    Get number of broken & incomplete RX frames
+
+    NOTE:
+    - counted in both full & half-duplex mode, compare before & after
+      "setHalfDuplex()" to see if transport is half-duplex
+    - noise & lost bytes are counted too
+    - frames with wrong checksum are counted too
+    - value overflows after 65535
+*/
+/**************************************************************************/
+uint16_t DFPlayer::getFramesLost()
+{
+  return _framesLost;
+}
+#endif
+
+
+#if (DFPLAYER_TRANSACTIONS == 1)
+/**************************************************************************/
+/*
+    beginTransaction()
+
+    Start collecting write commands into transaction, group of commands
+    sent as one unit
+
+    NOTE:
+    - use for sequences that must not be interleaved with other traffic,
+      like "stop()" & "playFolder()", or "setSource()", "setVolume()" &
+      "playTrack()"
+    - commands are collected into TX queue until "endTransaction()", other
+      commands are never sent between them & never cancel them, see
+      "_cancelCommands()"
+    - commands inside transaction cancel obsolete ones of the same
+      transaction, e.g. 2-nd volume replaces 1-st one
+    - "setSource()" doesn't block inside transaction, next command of the
+      transaction waits for source instead
+    - read commands aren't part of transaction, they are sent right away
+    - one transaction at a time, return false if previous one isn't sent
+      yet, see "getTransactionStatus()"
+*/
+/**************************************************************************/
+bool DFPlayer::beginTransaction()
+{
+  if ((_groupOpen == true) || (_groupLength != 0)) {return false;} //previous transaction isn't sent yet
+
+  _groupPos          = _queueCount;                                //transaction starts after queued commands
+  _groupLength       = 0;
+  _groupOpen         = true;
+  _groupFailed       = false;
+  _groupStarted      = false;
+  _transactionStatus = DFPLAYER_TRANSACTION_PENDING;
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    endTransaction()
+
+    Release collected commands for sending as one unit
+
+    NOTE:
+    - in non-blocking mode transaction is sent by "update()", back to back
+      with pacing gap only, otherwise it's sent right away
+    - if power manager is enabled & transaction has playback command,
+      module is woken up first, see "setIdleTimeout()"
+    - return false if transaction wasn't started or didn't fit TX queue,
+      whole transaction is dropped, see DFPLAYER_QUEUE_SIZE
+*/
+/**************************************************************************/
+bool DFPlayer::endTransaction()
+{
+  if (_groupOpen == false) {return false;}
+
+  _groupOpen = false;
+
+  if (_groupFailed == true)
+  {
+    _abortTransaction();
+    return false;
+  }
+
+  if (_groupLength == 0)
+  {
+    _transactionStatus = DFPLAYER_TRANSACTION_DONE;              //empty transaction
+    return true;
+  }
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if (_idleTimeout != 0)
+  {
+    _lastActivity = millis();
+
+    for (uint8_t i = 0; i < _groupLength; i++)
+    {
+      if ((_powerState == DFPLAYER_POWER_STANDBY) && (_isPlaybackCommand(_queue[(_queueHead + _groupPos + i) % DFPLAYER_QUEUE_SIZE].command) == true)) {_startWakeup();}
+    }
+  }
+  #endif
+
+  if (_nonBlocking == false) {_drainQueue();}
+  else                       {_sendQueue();}
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    getTransactionStatus()
+
+    Get status of last transaction
+
+    NOTE:
+    - DFPLAYER_TRANSACTION_PENDING, commands are collected or waiting in
+      TX queue
+    - DFPLAYER_TRANSACTION_DONE, all commands sent, returned once
+    - DFPLAYER_TRANSACTION_FAILED, transaction didn't fit TX queue or
+      module returned error while transaction was sent, rest of the
+      transaction is dropped, returned once
+    - DFPLAYER_TRANSACTION_NONE, no transaction or result already read
+    - error is detected only if module returns it before the last command
+      is sent, enable feedback to get errors for every command, see "begin()"
+*/
+/**************************************************************************/
+uint8_t DFPlayer::getTransactionStatus()
+{
+  uint8_t status = _transactionStatus;
+
+  if (status != DFPLAYER_TRANSACTION_PENDING) {_transactionStatus = DFPLAYER_TRANSACTION_NONE;}
+
+  return status;
+}
+#endif
+
+
+#if (DFPLAYER_POWER_MANAGER == 1)
+/**************************************************************************/
+/*
+    getPowerState()
+
+    Get current power manager state
+
+    NOTE:
+    - 0=active, 1=waking up, 2=standby
+*/
+/**************************************************************************/
+DFPLAYER_POWER_STATE DFPlayer::getPowerState()
+{
+  return _powerState;
+}
+
+
+/**************************************************************************/
+/*
+    getPowerStateTime()
+
+    Get total time spent in specific power state since "begin()", in msec
+
+    NOTE:
+    - value overflows after 49.7 days
+*/
+/**************************************************************************/
+uint32_t DFPlayer::getPowerStateTime(DFPLAYER_POWER_STATE state)
+{
+  if (state == _powerState) {return _powerStateTime[state] + (millis() - _stateStart);}
+                             return _powerStateTime[state];
+}
+
+
+/**************************************************************************/
+/*
+    getWakeupLatency()
+
+    Get measured time from wake up command to module ready, in msec
+
+    NOTE:
+    - latency is refined only if feedback is enabled, see "setFeedback()",
+      module reply to the first command after wake up shows if the wait
+      was long enough
+    - without feedback latency stays at profile source delay or value
+      restored from snapshot, see "restoreSnapshot()"
+    - read command sent while module wakes up blocks by "delay()" for up
+      to this latency, keep it in mind for time critical loops
+*/
+/**************************************************************************/
+uint16_t DFPlayer::getWakeupLatency()
+{
+  return _wakeupLatency;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    setBusyPin()
+
+    Set MCU pin connected to module BUSY-pin
+
+    NOTE:
+    - BUSY-pin is low while module is playing
+    - used to measure trigger to playback latency, see "trigger()"
+    - while playing "update()" deadline is time left until end of track,
+      if duration is known, see "getRemaining()", or DFPLAYER_BUSY_POLL,
+      so end of track is seen up to DFPLAYER_BUSY_POLL msec late
+    - for instant end of track on sleeping MCU attach pin change
+      interrupt to BUSY-pin & call "update()" after wake up, rising
+      edge is end of track
+    - DFPLAYER_NO_BUSY_PIN=not connected
+*/
+/**************************************************************************/
+void DFPlayer::setBusyPin(uint8_t pin)
+{
+  _busyPin = pin;
+
+  if (_busyPin != DFPLAYER_NO_BUSY_PIN) {pinMode(_busyPin, INPUT);}
+}
+
+
+#if (DFPLAYER_TRIGGER == 1)
+/**************************************************************************/
+/*
+    setTrigger()
+
+    Pre-encode play command for "trigger()"
+
+    NOTE:
+    - folder name must be 01..99
+    - up to 001..255 songs in each folder
+    - call again after "setModel()" or "setFeedback()", checksum & ACK
+      byte are encoded in advance
+*/
+/**************************************************************************/
+void DFPlayer::setTrigger(uint8_t folder, uint8_t track)
+{
+  folder = constrain(folder, 1, 99); //folder limit 1..99
+  track  = constrain(track, 1, 255); //track  limit 1..255
+
+  _triggerLength = _encodeFrame(_triggerFrame, DFPLAYER_PLAY_FOLDER, folder, track);
+}
+
+
+/**************************************************************************/
+/*
+    trigger()
+
+    Play track set by "setTrigger()" with lowest possible latency
+
+    NOTE:
+    - pre-encoded frame is written straight to the Serial port, bypassing
+      TX queue, pacing gap & GD3200B/MH2024K delay after write command
+    - never blocks, safe to call from task or loop deferred from ISR, not
+      from ISR itself (Serial port is not reentrant)
+    - other commands are paused for DFPLAYER_TRIGGER_GUARD msec or
+      GD3200B/MH2024K delay after write command, whichever is longer, to
+      keep the line clear for the module, pending longer pause isn't
+      shortened
+    - if power manager put module in standby, trigger is sent as normal
+      play command & waits for wake up, see "scheduleWakeup()"
+    - latency to BUSY-pin low is measured by "update()", resolution
+      depends on how often "update()" is called
+*/
+/**************************************************************************/
+void DFPlayer::trigger()
+{
+  if (_triggerLength == 0) {return;} //trigger not set
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if (_powerState != DFPLAYER_POWER_ACTIVE)
+  {
+    _sendData(DFPLAYER_PLAY_FOLDER, _triggerFrame[5], _triggerFrame[6]);
+    return;
+  }
+  #endif
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  if ((_groupOpen == true) || (_groupLength != 0))
+  {
+    _sendData(DFPLAYER_PLAY_FOLDER, _triggerFrame[5], _triggerFrame[6]); //transaction isn't interrupted, see "beginTransaction()"
+    return;
+  }
+  #endif
+
+  _writeBytes(_triggerFrame, _triggerLength);
+
+  uint16_t guard   = _getDelay(_profile->writeDelay);                      //GD3200B/MH2024K needs delay after write command
+  uint32_t txReady = millis() + ((_getTxTime() + 999) / 1000);             //guard starts after last stop bit
+
+  if (guard < DFPLAYER_TRIGGER_GUARD) {guard = DFPLAYER_TRIGGER_GUARD;}
+
+  txReady += guard;
+
+  _triggerStart   = micros();
+  _triggerPending = (_busyPin != DFPLAYER_NO_BUSY_PIN);
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  _lastActivity   = millis();
+  #endif
+
+  if ((int32_t)(txReady - _txReadyTime) > 0) {_txReadyTime = txReady;}    //don't shorten pending pacing gap or wake up hold
+
+  _trackCommand(DFPLAYER_PLAY_FOLDER, _triggerFrame[5], _triggerFrame[6]);
+}
+
+
+/**************************************************************************/
+/*
+    getTriggerLatency()
+
+    Get last trigger to BUSY-pin low time, in usec
+
+    NOTE:
+    - return "0" if not measured yet or BUSY-pin not set
+*/
+/**************************************************************************/
+uint32_t DFPlayer::getTriggerLatency()
+{
+  return _triggerLatency;
+}
+
+
+/**************************************************************************/
+/*
+    getTriggerLatencyMax()
+
+    Get worst trigger to BUSY-pin low time since "begin()", in usec
+*/
+/**************************************************************************/
+uint32_t DFPlayer::getTriggerLatencyMax()
+{
+  return _triggerLatencyMax;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    getDuration()
+
+    Get learned track duration, in sec
+
+    NOTE:
+    - folder:
+      - DFPLAYER_FOLDER_ROOT, track played by "playTrack()" or "repeatTrack()"
+      - 1..99, track played by "playFolder()"
+      - DFPLAYER_FOLDER_MP3, track played by "playMP3Folder()"
+      - DFPLAYER_FOLDER_3000, track played by "play3000Folder()"
+    - source, 1=USB-Disk, 2=TF-Card, 5=NOR-Flash
+
+    - duration is learned from playback command to "track finished"
+      feedback or BUSY-pin high, see "setBusyPin()", & refined on repeated
+      plays
+    - tracks started by "next()", "previous()", "repeatFolder()" or
+      "randomAll()" aren't learned, track number unknown
+    - return "0" if duration unknown
+*/
+/**************************************************************************/
+uint16_t DFPlayer::getDuration(uint8_t folder, uint16_t track, uint8_t source)
+{
+  #if (DFPLAYER_DURATION_TABLE_SIZE == 0)
+  (void)folder; (void)track; (void)source;
+
+  return 0;                                    //duration learning compiled out
+  #else
+  int16_t index = _findDuration(source, folder, track);
+
+  if (index < 0) {return 0;}
+                  return _durations[index].seconds;
+  #endif
+}
+
+
+/**************************************************************************/
+/*
+    setDuration()
+
+    Preload track duration, in sec
+
+    NOTE:
+    - see "getDuration()" for folder & source values
+    - use to restore table from EEPROM/flash or media manifest, learned
+      durations refine preloaded ones
+*/
+/**************************************************************************/
+void DFPlayer::setDuration(uint8_t folder, uint16_t track, uint16_t seconds, uint8_t source)
+{
+  #if (DFPLAYER_DURATION_TABLE_SIZE == 0)
+  (void)folder; (void)track; (void)seconds; (void)source;
+  #else
+  _storeDuration(source, folder, track, seconds, true);
+  #endif
+}
+
+
+/**************************************************************************/
+/*
+    getPosition()
+
+    Get playback position of current track, in msec
+
+    NOTE:
+    - counted from the last playback command, pause doesn't count
+    - position is frozen while track is paused & continues after
+      "resume()", paused track is stopped one with known number
+    - return "0" if nothing is playing or track number is unknown
+*/
+/**************************************************************************/
+uint32_t DFPlayer::getPosition()
+{
+  if (_playKnown == false) {return 0;}
+
+  uint32_t timeNow = millis();
+
+  if ((_playing == false) && ((int32_t)(timeNow - _pauseStart) > 0)) {timeNow = _pauseStart;} //paused, pause starts when frame arrives
+
+  return timeNow - _playStart;
+}
+
+
+/**************************************************************************/
+/*
+    getRemaining()
+
+    Get time left until current track is finished, in msec
+
+    NOTE:
+    - return "0" if nothing is playing or duration is unknown
+    - add to "millis()" to get time for "scheduleWakeup()" or next
+      playback
+*/
+/**************************************************************************/
+uint32_t DFPlayer::getRemaining()
+{
+  uint32_t position = getPosition();
+
+  if (position == 0) {return 0;}
+
+  uint32_t duration = getDuration(_playFolder, _playTrack, _source) * 1000UL;
+
+  if (duration > position) {return duration - position;}
+                            return 0;
+}
+
+
+/**************************************************************************/
+/*
+    getFinishedTrack()
+
+    Get track finished since last call, use to advance playlist
+
+    NOTE:
+    - "track finished" feedback & BUSY-pin are collected by "update()",
+      see "setBusyPin()"
+    - every track is reported once, duplicated feedback & late feedback
+      of previous track are filtered out, see "_finishTrack()"
+    - track number is global number reported by module, for "playTrack()"
+      & "repeatTrack()" it's the number sent by play command
+    - return DFPLAYER_TRACK_NONE if no track finished since last call
+    - return DFPLAYER_TRACK_UNKNOWN if finish was detected by BUSY-pin &
+      number is unknown, e.g. track started by "next()" without feedback
+*/
+/**************************************************************************/
+uint16_t DFPlayer::getFinishedTrack()
+{
+  uint16_t track = _finishedTrack;
+
+  _finishedTrack = DFPLAYER_TRACK_NONE;
+
+  return track;
+}
+
+
+/**************************************************************************/
+/*
+    isTrackMismatch()
+
+    Check if "track finished" feedback didn't match started track since
+    last call
+
+    NOTE:
+    - usually late feedback of previous track after new play command,
+      it's ignored & current track keeps playing
+    - repeated mismatch means module numbers tracks differently, e.g.
+      FAT order differs from upload order
+*/
+/**************************************************************************/
+bool DFPlayer::isTrackMismatch()
+{
+  bool mismatch = _trackMismatch;
+
+  _trackMismatch = false;
+
+  return mismatch;
+}
+
+
+#if (DFPLAYER_SNAPSHOT == 1)
+/**************************************************************************/
+/*
+    saveSnapshot()
+
+    Save library state to buffer for warm start, return blob size
+
+    NOTE:
+    - blob keeps built-in profile, sent settings, current track & position,
+      learned durations, measured wake up latency & write delay of profile,
+      e.g. found by "calibrateGap()", see "restoreSnapshot()"
+    - buffer size DFPLAYER_SNAPSHOT_SIZE is always enough, real size
+      depends on number of learned durations
+    - return "0" if buffer is too small
+    - commands waiting in TX queue aren't saved, save after "update()"
+      returned DFPLAYER_NO_DEADLINE
+
+    - blob format, multi-byte values are little-endian:
+      0      1        2..3    4      5       6       7..8   9      10..13
+      MAGIC, VERSION, LENGTH, PROFILE, SOURCE, FOLDER, TRACK, FLAGS, POSITION,
+      14      15  16        17..18  19..20       21     22..
+      VOLUME, EQ, DAC_GAIN, WAKEUP, WRITE_DELAY, COUNT, DURATIONS * 6,
+      last 2-bytes
+      CHECKSUM
+*/
+/**************************************************************************/
+uint16_t DFPlayer::saveSnapshot(uint8_t *buffer, uint16_t size)
+{
+  uint8_t count = 0;
+
+  #if (DFPLAYER_DURATION_TABLE_SIZE != 0)
+  for (uint8_t i = 0; i < DFPLAYER_DURATION_TABLE_SIZE; i++)
+  {
+    if (_durations[i].seconds != 0) {count++;}
+  }
+  #endif
+
+  uint16_t length = DFPLAYER_SNAPSHOT_SIZE - ((DFPLAYER_DURATION_TABLE_SIZE - count) * 6);
+
+  if (size < length) {return 0;}
+
+  uint8_t builtin = DFPLAYER_CONFIG_UNKNOWN;                                              //custom profile, set again by sketch
+
+  for (uint8_t i = 0; i < (sizeof(DFPLAYER_SNAPSHOT_PROFILES) / sizeof(DFPLAYER_SNAPSHOT_PROFILES[0])); i++)
+  {
+    if (_profile == DFPLAYER_SNAPSHOT_PROFILES[i]) {builtin = i;}
+  }
+
+  uint32_t position = getPosition();
+  uint16_t wakeup   = 0;
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  wakeup = _wakeupLatency;
+  #endif
+
+  buffer[0]  = DFPLAYER_SNAPSHOT_MAGIC;
+  buffer[1]  = DFPLAYER_SNAPSHOT_VERSION;
+  buffer[2]  = length;
+  buffer[3]  = length >> 8;
+  buffer[4]  = builtin;
+  buffer[5]  = _source;
+  buffer[6]  = _playFolder;
+  buffer[7]  = _playTrack;
+  buffer[8]  = _playTrack >> 8;
+  buffer[9]  = (_playKnown << 0) | (_playing << 1) | (_looping << 2);
+  buffer[10] = position;
+  buffer[11] = position >> 8;
+  buffer[12] = position >> 16;
+  buffer[13] = position >> 24;
+
+  #if (DFPLAYER_CONFIG_RESTORE == 1)
+  buffer[9] |= (_dacDisabled << 3) | (_dacGainEnabled << 4);
+  buffer[14] = _volume;
+  buffer[15] = _eq;
+  buffer[16] = _dacGain;
+  #else
+  buffer[14] = DFPLAYER_CONFIG_UNKNOWN;
+  buffer[15] = DFPLAYER_CONFIG_UNKNOWN;
+  buffer[16] = DFPLAYER_CONFIG_UNKNOWN;
+  #endif
+
+  buffer[17] = wakeup;
+  buffer[18] = wakeup >> 8;
+  buffer[19] = _profile->writeDelay;
+  buffer[20] = _profile->writeDelay >> 8;
+  buffer[21] = count;
+
+  uint16_t index = 22;
+
+  #if (DFPLAYER_DURATION_TABLE_SIZE != 0)
+  for (uint8_t i = 0; i < DFPLAYER_DURATION_TABLE_SIZE; i++)
+  {
+    const DFPLAYER_DURATION &entry = _durations[i];
+
+    if (entry.seconds == 0) {continue;}
+
+    buffer[index++] = entry.track;
+    buffer[index++] = entry.track >> 8;
+    buffer[index++] = entry.folder;
+    buffer[index++] = entry.source;
+    buffer[index++] = entry.seconds;
+    buffer[index++] = entry.seconds >> 8;
+  }
+  #endif
+
+  uint16_t checksum = 0;                                                                 //same as UART frame, 0x0000 - sum(bytes)
+
+  for (uint16_t i = 0; i < index; i++) {checksum -= buffer[i];}
+
+  buffer[index++] = checksum;
+  buffer[index++] = checksum >> 8;
+
+  return index;
+}
+
+
+/**************************************************************************/
+/*
+    restoreSnapshot()
+
+    Restore library state saved by "saveSnapshot()" & skip boot wait
+
+    NOTE:
+    - call after "begin()" with "bootDelay=false", on MCU reset or deep
+      sleep wake up without module power cycle
+    - set custom profile & busy pin before restore, see "setProfile()"
+    - saved write delay is applied only to writable "profile", e.g. the one
+      passed to "calibrateGap()", it's set by "setProfile()" then, built-in
+      profiles keep their timing
+    - module state is validated with single status query, it replaces
+      boot wait & re-queries of settings module still holds
+    - track position continues from saved value, time MCU was off isn't
+      counted
+    - return "false" if blob is damaged, has other version or module
+      didn't answer, do cold start then, wait for boot time
+    - if module was power cycled, its "ready" feedback restores settings
+      from snapshot, see "isConfigRestored()"
+    - sleeping module enters standby state only if power manager is
+      enabled, see "setIdleTimeout()"
+*/
+/**************************************************************************/
+bool DFPlayer::restoreSnapshot(const uint8_t *buffer, uint16_t size, DFPLAYER_PROFILE *profile)
+{
+  if (size < 24)                                 {return false;}
+  if (buffer[0] != DFPLAYER_SNAPSHOT_MAGIC)      {return false;}
+  if (buffer[1] != DFPLAYER_SNAPSHOT_VERSION)    {return false;}
+
+  uint16_t length = buffer[2] | (buffer[3] << 8);
+  uint8_t  count  = buffer[21];
+
+  if ((length > size) || (length != (24 + (count * 6)))) {return false;}
+
+  uint16_t checksum = buffer[length - 2] | (buffer[length - 1] << 8);
+
+  for (uint16_t i = 0; i < (length - 2); i++) {checksum += buffer[i];} //sum(bytes) + checksum = 0x0000
+
+  if (checksum != 0) {return false;}
+
+  if (buffer[4] < (sizeof(DFPLAYER_SNAPSHOT_PROFILES) / sizeof(DFPLAYER_SNAPSHOT_PROFILES[0]))) {setProfile(*DFPLAYER_SNAPSHOT_PROFILES[buffer[4]]);} //custom profile is kept
+
+  if (profile != NULL)
+  {
+    profile->writeDelay = buffer[19] | (buffer[20] << 8);
+
+    setProfile(*profile);
+  }
+
+  _source     = buffer[5];
+  _playFolder = buffer[6];
+  _playTrack  = buffer[7] | (buffer[8] << 8);
+
+  #if (DFPLAYER_CONFIG_RESTORE == 1)
+  _dacDisabled    = ((buffer[9] & 0x08) != 0);
+  _dacGainEnabled = ((buffer[9] & 0x10) != 0);
+  _volume         = buffer[14];
+  _eq             = buffer[15];
+  _dacGain        = buffer[16];
+  #endif
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  uint16_t wakeup = buffer[17] | (buffer[18] << 8);
+
+  if (wakeup != 0) {_wakeupLatency = constrain(wakeup, DFPLAYER_WAKEUP_DELAY_MIN, DFPLAYER_WAKEUP_DELAY_MAX);}
+  #endif
+
+  #if (DFPLAYER_DURATION_TABLE_SIZE != 0)
+  for (uint16_t index = 22; index < (22 + (count * 6)); index += 6)
+  {
+    _storeDuration(buffer[index + 3], buffer[index + 2], buffer[index] | (buffer[index + 1] << 8), buffer[index + 4] | (buffer[index + 5] << 8), true);
+  }
+  #endif
+
+  _txReadyTime = millis();                                                               //module is already running, no boot wait
+
+  DFPLAYER_RESULT status = getStatusResult();                                            //single query validates module state
+
+  if (status.status != DFPLAYER_RESULT_OK) {return false;}
+
+  uint32_t timeNow  = millis();
+  uint32_t position = buffer[10] | ((uint32_t)buffer[11] << 8) | ((uint32_t)buffer[12] << 16) | ((uint32_t)buffer[13] << 24);
+
+  _playKnown = ((buffer[9] & 0x01) != 0) && ((status.value == 1) || (status.value == 2)); //1=playing, 2=pause
+  _looping   = ((buffer[9] & 0x04) != 0) && (status.value == 1);
+  _playing   = (status.value == 1);                                                      //paused track isn't playing, see "getPosition()"
+  _playStart = timeNow - position;
+
+  _pausePending = false;                                                                 //restored pause has already arrived
+
+  if (status.value == 2) {_pauseStart = timeNow;}
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if ((status.value == 3) && (_idleTimeout != 0)) {_setPowerState(DFPLAYER_POWER_STANDBY);} //3=sleep or standby, power manager wakes module up
+  #endif
+
+  return true;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    verifyManifest()
+
+    Check card against media manifest, preload track durations if card
+    matches
+
+    NOTE:
+    - manifest is generated on host from SD card tree, see
+      "extras/host/dfplayer_manifest", sketch addresses tracks by its
+      named constants instead of magic numbers
+    - call once at boot before playback, catalog queries interrupt
+      playback on most modules
+    - module is asked for total tracks, number of folders & tracks in every
+      manifest folder, 2 + folders queries, FNV-1a of answers must match
+      manifest hash, see "hashManifest()"
+    - total tracks or number of folders mismatch fails without folder
+      queries
+    - only TF-Card is checked
+    - return "false" if card differs from manifest or module didn't answer,
+      durations aren't preloaded then
+*/
+/**************************************************************************/
+bool DFPlayer::verifyManifest(const DFPLAYER_MANIFEST &manifest)
+{
+  DFPLAYER_RESULT totalTracks = getTotalTracksSDResult();
+
+  if ((totalTracks.status != DFPLAYER_RESULT_OK) || (totalTracks.value != manifest.totalTracks)) {return false;}
+
+  DFPLAYER_RESULT folders = getTotalFoldersResult();
+
+  if ((folders.status != DFPLAYER_RESULT_OK) || (folders.value != manifest.folders)) {return false;}
+
+  uint32_t hash = DFPLAYER_MANIFEST_HASH_SEED;
+
+  hash = _hashByte(hash, totalTracks.value);
+  hash = _hashByte(hash, totalTracks.value >> 8);
+  hash = _hashByte(hash, folders.value);
+
+  for (uint8_t folder = 1; folder <= manifest.lastFolder; folder++)
+  {
+    if (manifest.folderTracks[folder - 1] == 0) {continue;}              //folder isn't used by manifest
+
+    DFPLAYER_RESULT tracks = getTotalTracksFolderResult(folder);
+
+    if (tracks.status != DFPLAYER_RESULT_OK) {return false;}
+
+    hash = _hashByte(hash, folder);
+    hash = _hashByte(hash, tracks.value);
+  }
+
+  if (hash != manifest.hash) {return false;}
+
+  #if (DFPLAYER_DURATION_TABLE_SIZE != 0)
+  for (uint16_t i = 0; i < manifest.durationCount; i++)
+  {
+    const DFPLAYER_DURATION &entry = manifest.durations[i];
+
+    _storeDuration(entry.source, entry.folder, entry.track, entry.seconds, true);
+  }
+  #endif
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    hashManifest()
+
+    Get FNV-1a hash of card counts
+
+    NOTE:
+    - hashed bytes: total tracks LSB, MSB, number of folders, then folder
+      number & tracks of every folder with tracks
+    - used by manifest generator, same hash is calculated from module
+      answers by "verifyManifest()"
+*/
+/**************************************************************************/
+uint32_t DFPlayer::hashManifest(uint16_t totalTracks, uint8_t folders, const uint8_t *folderTracks, uint8_t lastFolder)
+{
+  uint32_t hash = DFPLAYER_MANIFEST_HASH_SEED;
+
+  hash = _hashByte(hash, totalTracks);
+  hash = _hashByte(hash, totalTracks >> 8);
+  hash = _hashByte(hash, folders);
+
+  for (uint8_t folder = 1; folder <= lastFolder; folder++)
+  {
+    if (folderTracks[folder - 1] == 0) {continue;}
+
+    hash = _hashByte(hash, folder);
+    hash = _hashByte(hash, folderTracks[folder - 1]);
+  }
+
+  return hash;
+}
+
+
+/**********************************private*********************************/
+/**************************************************************************/
+/*
+    _sendData()
+
+    Send command to module
+
+    NOTE:
+    - if power manager is enabled, playback commands wake module up first,
+      write commands wait in TX queue until module is ready & read command
+      waits for the rest of wake up time, see "setIdleTimeout()"
+    - in non-blocking mode write commands wait in TX queue for pacing gap,
+      see "setNonBlocking()"
+    - queued commands are sorted by priority class, see "_getPriority()"
+    - write commands inside transaction are collected into TX queue, see
+      "beginTransaction()"
+*/
+ /**************************************************************************/
+void DFPlayer::_sendData(uint8_t command, uint8_t dataMSB, uint8_t dataLSB)
+{
+  if (isSupported(command) == false) {return;} //see "DFPLAYER_PROFILE"
+
+  if (_queueCount != 0) {_cancelCommands(command);} //remove queued commands made obsolete by this one
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  if ((_groupOpen == true) && (_isQueryCommand(command) == false))
+  {
+    if (_pushCommand(command, dataMSB, dataLSB) == false) {_groupFailed = true;} //see "endTransaction()"
+    return;
+  }
+  #endif
+
+  #if (DFPLAYER_POWER_MANAGER == 1)
+  if (_idleTimeout != 0)
+  {
+    _lastActivity = millis();
+
+    if ((_isPlaybackCommand(command) == true) && (_powerState == DFPLAYER_POWER_STANDBY)) {_startWakeup();}
+
+    if (_powerState == DFPLAYER_POWER_WAKING)
+    {
+      if (_isQueryCommand(command) == false)
+      {
+        if (_pushCommand(command, dataMSB, dataLSB) == true) {return;}                                           //send after wake up
+      }
+      else
+      {
+        uint32_t elapsed = millis() - _stateStart;
+
+        if (elapsed < _wakeupLatency) {delay(_wakeupLatency - elapsed);}                                         //response is read right after command
+
+        _finishWakeup();
+        _drainQueue();
+      }
+    }
+  }
+  #endif
+
+  if (_nonBlocking == true)
+  {
+    if (_isQueryCommand(command) == true) {_drainQueue();}                                                       //response is read right after command
+    else if ((_queueCount != 0) || (_getTxDelay() != 0))
+    {
+      if (_queueCount >= DFPLAYER_QUEUE_SIZE) {_sendNext();}                                                     //queue full, wait for pacing gap & send oldest, order is kept
+
+      if (_pushCommand(command, dataMSB, dataLSB) == true) {return;}                                             //send by "update()"
+    }
+
+    #if (DFPLAYER_CONFIG_RESTORE == 1)
+    if ((_restorePending == true) && (_isQueryCommand(command) == false) && (_pushCommand(command, dataMSB, dataLSB) == true)) {return;} //send after restored settings
+    #endif
+  }
+
+  _writeFrame(command, dataMSB, dataLSB);
+}
+
+
+/**************************************************************************/
+/*
+    _writeFrame()
+
+    Write data frame to Serial port
+
+    NOTE:
+    - see "_encodeFrame()" for frame format
+    - next command is delayed by profile write delay or by boot time
+      after reset, boot time ends early if module sends "ready" feedback
+    - in non-blocking mode "set source" adds source selection time to
+      the delay, queued commands wait for source, except wake up by power
+      manager, which waits for measured latency, see "update()"
+    - feedback received before command is parsed first, so it isn't
+      applied to this command or taken as response to query, see
+      "_getResponse()"
+    - write delay & boot time are counted from estimated time when last
+      byte leaves TX-pin, buffered UART returns from "write()" before
+      that, see "_writeBytes()"
+    - frames sent back-to-back by "_sendQueue()" & "_drainQueue()" are
+      collected & written by one serial call, while they fit
+      "availableForWrite()", see "_openBatch()"
+*/
+ /**************************************************************************/
+void DFPlayer::_writeFrame(uint8_t command, uint8_t dataMSB, uint8_t dataLSB)
+{
+  _watchPause();
+
+  #if (DFPLAYER_TX_BATCH > 1)
+  if ((_txBatchLength != 0) && (_getTxDelay() != 0)) {_flushBatch();} //collected frames aren't held by pacing gap
+  #endif
+
+  delay(_getTxDelay());                                         //wait for the rest of pacing gap or trigger guard time, if any
+
+  #if (DFPLAYER_HALF_DUPLEX == 1)
+  while (_getTxDelay() != 0) {_readEvents(); yield();}          //RX frame in progress, wait for quiet window, see "_isRxBusy()"
+
+  if (_txHeld == true)
+  {
+    _collisions++;
+    _txHeld = false;
+  }
+  #endif
+
+  _readEvents();
+
+  _trackCommand(command, dataMSB, dataLSB);
+
+  uint8_t frame[DFPLAYER_UART_FRAME_SIZE];
+  uint8_t length = _encodeFrame(frame, command, dataMSB, dataLSB);
+
+  #if (DFPLAYER_TX_BATCH > 1)
+  if ((_txBatchOwner == this) && ((_txBatchLength + length) > sizeof(_txBatch))) {_flushBatch();}
+
+  if ((_txBatchOwner == this) && ((int)(_txBatchLength + length) <= _serial->availableForWrite()))
+  {
+    memcpy(&_txBatch[_txBatchLength], frame, length);
+
+    _txBatchLength += length;
+  }
+  else
+  {
+    _flushBatch();                                              //keep frames order
+
+    _writeBytes(frame, length);
+  }
+  #else
+  _writeBytes(frame, length);
+  #endif
+
+  _commandStatus = 0;                                           //status of new command is unknown, see "getCommandStatus()"
+
+  if (_nonBlocking == false) {_watchPause();}                   //blocking pause returns when frame arrives
+
+  uint16_t writeDelay = _getDelay(_profile->writeDelay);         //GD3200B/MH2024K chip so slow & need delay after write command
+
+  if (command == DFPLAYER_RESET) {writeDelay = _profile->bootDelay;} //wait for player to boot, reset may be sent later by "update()"
+
+  if ((_nonBlocking == true) && (command == DFPLAYER_SET_PLAY_SRC) && (dataLSB != 6)) //6=Sleep, blocking "setSource()" waits itself
+  {
+    #if (DFPLAYER_POWER_MANAGER == 1)
+    if (_powerState != DFPLAYER_POWER_WAKING) {writeDelay += _profile->sourceDelay;}
+    #else
+    writeDelay += _profile->sourceDelay;
+    #endif
+  }
+
+  if (writeDelay == 0) {return;}
+
+  #if (DFPLAYER_TX_BATCH > 1)
+  _flushBatch();                                                //next frame waits for gap anyway
+  #endif
+
+  writeDelay += (_getTxTime() + 999) / 1000;                    //gap starts after last stop bit, not when "write()" returns
+
+  _txReadyTime = millis() + writeDelay;
+
+  if (_nonBlocking == true) {return;}
+
+  if (command == DFPLAYER_RESET)
+  {
+    while (_getTxDelay() != 0) {_readEvents(); yield();}          //"ready" feedback ends boot wait early, see "_parseEvent()"
+  }
+  else
+  {
+    delay(writeDelay);
+  }
+}
+
+
+/**************************************************************************/
+/*
+    _writeBytes()
+
+    Write bytes to Serial port & update estimated TX complete time
+
+    NOTE:
+    - bytes leave TX-pin one after another at DFPLAYER_UART_BYTE_TIME,
+      new bytes start after bytes still waiting in TX buffer
+    - library is the only writer on module UART, so model knows how
+      much of TX buffer is still draining without buffer size, which
+      "availableForWrite()" doesn't tell
+    - unbuffered transport returns from "write()" after last stop bit,
+      e.g. SoftwareSerial, estimated time is already passed then
+*/
+ /**************************************************************************/
+void DFPlayer::_writeBytes(const uint8_t *buffer, uint16_t length)
+{
+  _txDoneTime = micros() + _getTxTime() + ((uint32_t)length * DFPLAYER_UART_BYTE_TIME);
+
+  _serial->write(buffer, length);
+}
+
+
+#if (DFPLAYER_CALIBRATION == 1)
+/**************************************************************************/
+/*
+    _testGap()
+
+    Send burst of "getVolume()" queries with gap between them, return true
+    if module replied to every query
+
+    NOTE:
+    - replies are collected while waiting for gap, other frames are
+      passed to "_parseEvent()"
+    - after last query replies are collected for feedback timeout, module
+      is idle before next burst
+*/
+ /**************************************************************************/
+bool DFPlayer::_testGap(uint16_t gap, uint8_t burst)
+{
+  uint8_t frame[DFPLAYER_UART_FRAME_SIZE];
+  uint8_t length  = _encodeFrame(frame, DFPLAYER_GET_VOL, 0, 0);
+  uint8_t replies = 0;
+
+  for (uint8_t i = 0; i < burst; i++)
+  {
+    _writeBytes(frame, length);
+
+    uint32_t waitTime  = ((_getTxTime() + 999) / 1000) + (((i + 1) < burst) ? gap : _threshold); //gap starts after last stop bit
+    uint32_t startTime = millis();
+
+    while ((millis() - startTime) < waitTime)
+    {
+      while (_readFrame() == true)
+      {
+        if (_rxBuffer[3] == DFPLAYER_GET_VOL) {replies++;}
+        else                                  {_parseEvent(_rxBuffer);}
+      }
+
+      yield();
+    }
+  }
+
+  return (replies >= burst);
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    _getTxTime()
+
+    Get time left until last written byte leaves TX-pin, in usec
+
+    NOTE:
+    - time longer than DFPLAYER_TX_TIME_MAX means estimated time is
+      already passed, "micros()" difference wrapped around
+*/
+ /**************************************************************************/
+uint32_t DFPlayer::_getTxTime()
+{
+  uint32_t timeLeft = _txDoneTime - micros();
+
+  if (timeLeft > DFPLAYER_TX_TIME_MAX) {return 0;}
+                                        return timeLeft;
+}
+
+
+/**************************************************************************/
+/*
+    _getDelay()
+
+    Get profile delay, in msec
+
+    NOTE:
+    - DFPLAYER_DELAY_TIMEOUT=same as feedback timeout, see "setTimeout()"
+*/
+ /**************************************************************************/
+uint16_t DFPlayer::_getDelay(uint16_t delay)
+{
+  if (delay == DFPLAYER_DELAY_TIMEOUT) {return _threshold;}
+                                        return delay;
+}
+
+
+/**************************************************************************/
+/*
+    _getChecksum()
+
+    Get checksum of TX frame
+
+    NOTE:
+    - VER, LEN, CMD, ACK, DH & DL bytes are summed, see "_encodeFrame()"
+    - return "0" if profile has no checksum, see "DFPLAYER_PROFILE"
+*/
+ /**************************************************************************/
+uint16_t DFPlayer::_getChecksum(const uint8_t *buffer)
+{
+  int16_t checksum;
+
+  switch (_profile->checksum)
+  {
+    case DFPLAYER_CHECKSUM_0000:
+      checksum = 0;        //0x0000, DON'T TOUCH!!!
+      checksum = checksum - buffer[1] - buffer[2] - buffer[3] - buffer[4] - buffer[5] - buffer[6];
+      break;
+
+    case DFPLAYER_CHECKSUM_FFFF:
+      checksum = 35535;    //0xFFFF, DON'T TOUCH!!!
+      checksum = checksum - buffer[1] - buffer[2] - buffer[3] - buffer[4] - buffer[5] - buffer[6] + 1;
+      break;
+
+    case DFPLAYER_CHECKSUM_NONE:
+    default:
+      checksum = 0;        //no checksum calculation
+      break;
+  }
+
+  return checksum;
+}
+
+
+/**************************************************************************/
+/*
+    _isChecksumValid()
+
+    Check checksum of RX frame
+
+    NOTE:
+    - always true if profile has no checksum, see "DFPLAYER_PROFILE"
+    - FN6100 replies aren't verified on hardware to use the same constant
+      as TX frames, standard checksum 0x0000 - sum(VER..DL) is accepted too
+*/
+ /**************************************************************************/
+bool DFPlayer::_isChecksumValid(const uint8_t *buffer)
+{
+  if (_profile->checksum == DFPLAYER_CHECKSUM_NONE) {return true;}
+
+  uint16_t checksum = ((uint16_t)buffer[7] << 8) | buffer[8];
+
+  if (checksum == _getChecksum(buffer)) {return true;}
+
+  if (_profile->checksum == DFPLAYER_CHECKSUM_FFFF) {return checksum == (uint16_t)(0 - buffer[1] - buffer[2] - buffer[3] - buffer[4] - buffer[5] - buffer[6]);}
+
+  return false;
+}
+
+
+/**************************************************************************/
+/*
+    _encodeFrame()
+
+    Fill buffer with TX data frame, return frame length
+
+    NOTE:
+    - DFPlayer TX data frame format:
       0      1    2    3    4    5   6   7     8     9-byte
       START, VER, LEN, CMD, ACK, DH, DL, SUMH, SUML, END
              -------- checksum --------
+    - buffer size must be at least DFPLAYER_UART_FRAME_SIZE
+*/
+ /**************************************************************************/
+uint8_t DFPlayer::_encodeFrame(uint8_t *buffer, uint8_t command, uint8_t dataMSB, uint8_t dataLSB)
+{
+  buffer[0] = DFPLAYER_UART_START_BYTE;
+  buffer[1] = DFPLAYER_UART_VERSION;
+  buffer[2] = DFPLAYER_UART_DATA_LEN;
+  buffer[3] = command;
+  buffer[4] = _ack;
+  buffer[5] = dataMSB;
+  buffer[6] = dataLSB;
+
+  if (_profile->checksum == DFPLAYER_CHECKSUM_NONE)
+  {
+    buffer[7] = DFPLAYER_UART_END_BYTE; //no checksum calculation, not recomended for MCU without external crystal oscillator
+
+    return (DFPLAYER_UART_FRAME_SIZE - 2); //-2=SUMH & SUML not used
+  }
+
+  uint16_t checksum = _getChecksum(buffer);
+
+  buffer[7] = checksum >> 8;
+  buffer[8] = checksum;
+
+  buffer[9] = DFPLAYER_UART_END_BYTE;
+
+  return DFPLAYER_UART_FRAME_SIZE;
+}
+
+
+/**************************************************************************/
+/*
+    _readData()
+
+    Read MP3 player command feedback
+
+    NOTE:
+    - command feedback timeout 100msec(YX5200/AAxxxx)..350msec(GD3200B/MH2024K)
+    - frame partially collected by "update()" is completed, see "_readFrame()"
+
+    - DFPlayer RX data frame format:
+      0      1    2    3    4    5   6   7     8     9-byte
+      START, VER, LEN, CMD, ACK, DH, DL, SUMH, SUML, END
+    - received frame is in "_rxBuffer" until next "_readFrame()"
+*/
+ /**************************************************************************/
+bool DFPlayer::_readData()
+{
+  _commandStatus = 0;                                  //unknown status
+
+  _serial->flush();                                    //clear serial FIFO
+
+  uint32_t startTime = millis();
+
+  /* read serial, wait for full frame during "_threshold" period than error (received less than expected) */
+  while (_readFrame() == false)
+  {
+    if ((millis() - startTime) >= _threshold) {return false;}
+
+    yield();
+  }
+
+  _commandStatus = _decodeStatus(_rxBuffer);
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    _getResponse()
+
+    Get command feedback value from MP3 player
+
+    NOTE:
+    - ACK, "track finished", "ready" & error frames received before
+      response are passed to "_parseEvent()", up to DFPLAYER_RESPONSE_FRAMES
+      frames, ACK & error frames aren't counted
+    - error frame doesn't stop waiting, it may be reply to previous frame
+      broken by noise or to queued write command sent just before query,
+      e.g. "track not found", up to DFPLAYER_QUEUE_SIZE + 1 errors are
+      skipped, last error is kept for "getCommandStatus()" & result status
+    - return DH, DL & DFPLAYER_RESULT_OK, or "0" & reason of failure
+*/
+ /**************************************************************************/
+DFPLAYER_RESULT DFPlayer::_getResponse(uint8_t command)
+{
+  DFPLAYER_RESULT result = {0, DFPLAYER_RESULT_UNSUPPORTED};
+
+  if (isSupported(command) == false) {return result;} //command wasn't sent, see "DFPLAYER_PROFILE"
+
+  uint8_t error  = 0;
+  uint8_t errors = 0;
+  uint8_t frames = 0;
+
+  while ((frames < DFPLAYER_RESPONSE_FRAMES) && (errors <= DFPLAYER_QUEUE_SIZE))
+  {
+    if (_readData() == false) {break;}
+
+    if (_rxBuffer[3] == command)
+    {
+      result.value  = ((uint16_t)_rxBuffer[5] << 8) | _rxBuffer[6]; //DH, DL
+      result.status = DFPLAYER_RESULT_OK;
+
+      return result;
+    }
+
+    switch (_rxBuffer[3])
+    {
+      case DFPLAYER_RETURN_CODE_OK_ACK:                             //ACK of each write sent before query may arrive first
+        break;
+
+      case DFPLAYER_RETURN_ERROR:                                   //may belong to previous broken frame or write, keep waiting
+        error = _commandStatus;
+        errors++;
+        break;
+
+      default:
+        frames++;
+        break;
+    }
+
+    _parseEvent(_rxBuffer);
+  }
+
+  if (error != 0) {_commandStatus = error;} //see "getCommandStatus()"
+
+  result.status = (error != 0) ? error : DFPLAYER_RESULT_TIMEOUT;
+
+  return result;
+}
+
+
+/**************************************************************************/
+/*
+    _decodeStatus()
+
+    Decode received frame to "getCommandStatus()" value
+*/
+ /**************************************************************************/
+uint8_t DFPlayer::_decodeStatus(const uint8_t *frame)
+{
+  switch (frame[3])
+  {
+    case DFPLAYER_RETURN_ERROR:
+      return frame[6]; //error values, see "getCommandStatus()" NOTE
+
+    case DFPLAYER_RETURN_CODE_OK_ACK:
+      return 0x0B;
+
+    case DFPLAYER_RETURN_CODE_DONE:
+      return 0x0C;
+
+    case DFPLAYER_RETURN_CODE_READY:
+      return 0x0D;
+
+    default:
+      return 0x00;
+  }
+}
+
+
+/**************************************************************************/
+/*
+    _readFrame()
+
+    Collect received bytes into frame without blocking
+
+    NOTE:
+    - frame is synchronized by start byte, broken frame is resynchronized
+      by next start byte inside it
+    - frame with wrong checksum is broken, corrupted value is never
+      returned as valid, checksum isn't checked if profile has none
+    - bytes after complete frame stay in serial buffer
+    - return true if valid frame is in "_rxBuffer"
+*/
+ /**************************************************************************/
+bool DFPlayer::_readFrame()
+{
+  while (_serial->available() > 0)
+  {
+    uint8_t data = _serial->read();
+
+    if ((_rxIndex == 0) && (data != DFPLAYER_UART_START_BYTE)) {continue;} //wait for start byte
+
+    #if (DFPLAYER_HALF_DUPLEX == 1)
+    if (_rxIndex == 0) {_rxStartTime = millis();}
+    #endif
+
+    _rxBuffer[_rxIndex++] = data;
+
+    if (_rxIndex < DFPLAYER_UART_FRAME_SIZE) {continue;}
+
+    _rxIndex = 0;
+
+    /* check for version byte missing, length byte missing, end byte missing, checksum mismatch */
+    if ((_rxBuffer[1] == DFPLAYER_UART_VERSION) && (_rxBuffer[2] == DFPLAYER_UART_DATA_LEN) && (_rxBuffer[9] == DFPLAYER_UART_END_BYTE) &&
+        (_isChecksumValid(_rxBuffer) == true)) {return true;}
+
+    #if (DFPLAYER_HALF_DUPLEX == 1)
+    _framesLost++;
+    #endif
+
+    for (uint8_t i = 1; i < DFPLAYER_UART_FRAME_SIZE; i++)
+    {
+      if (_rxBuffer[i] != DFPLAYER_UART_START_BYTE) {continue;}
+
+      _rxIndex = DFPLAYER_UART_FRAME_SIZE - i;
+
+      memmove(_rxBuffer, &_rxBuffer[i], _rxIndex);
+      break;
+    }
+  }
+
+  return false;
+}
+
+
+/**************************************************************************/
+/*
+    _readEvents()
+
+    Collect unsolicited module feedback without blocking
+*/
+ /**************************************************************************/
+void DFPlayer::_readEvents()
+{
+  while (_readFrame() == true) {_parseEvent(_rxBuffer);}
+}
+
+
+/**************************************************************************/
+/*
+    _parseEvent()
+
+    Update player state from unsolicited feedback frame
+
+    NOTE:
+    - wake up latency is increased & first command after wake up is resent
+      by "update()" after extra wait if module replies "busy" or "sleep",
+      latency is decreased slowly if module accepts command
+    - nothing is written from here, it's called while "_writeFrame()"
+      collects feedback
+*/
+ /**************************************************************************/
+void DFPlayer::_parseEvent(const uint8_t *frame)
+{
+  switch (frame[3])
+  {
+    case DFPLAYER_RETURN_CODE_DONE:
+      _finishTrack(((uint16_t)frame[5] << 8) | frame[6]); //DH, DL=number of finished track
+
+      #if (DFPLAYER_POWER_MANAGER == 1)
+      _lastActivity = millis();
+      #endif
+      break;
+
+    case DFPLAYER_RETURN_CODE_REMOVED:
+      _playing   = false;                                     //playback stopped, track isn't finished
+      _looping   = false;
+      _playKnown = false;
+
+      #if (DFPLAYER_POWER_MANAGER == 1)
+      _lastActivity = millis();
+      #endif
+      break;
+
+    case DFPLAYER_RETURN_CODE_READY:
+      _playing     = false;
+      _looping     = false;
+      _playKnown   = false;
+      _txReadyTime = millis();                                  //module booted, no need to wait rest of boot time
+
+      #if (DFPLAYER_CONFIG_RESTORE == 1)
+      _restorePending = true;                                   //settings are factory default again, see "_restoreConfig()"
+      _restoreStep    = 0;
+      #endif
+
+      #if (DFPLAYER_POWER_MANAGER == 1)
+      _lastActivity = millis();
+
+      if (_powerState != DFPLAYER_POWER_WAKING) {_setPowerState(DFPLAYER_POWER_ACTIVE);} //module rebooted, source selected by default
+      #endif
+      break;
+
+    #if (DFPLAYER_POWER_MANAGER == 1)
+    case DFPLAYER_RETURN_CODE_OK_ACK:
+      if (_wakeupProbe == false) {break;}
+
+      _wakeupProbe   = false;
+      _wakeupLatency = constrain(_wakeupLatency - (_wakeupLatency >> 4), DFPLAYER_WAKEUP_DELAY_MIN, DFPLAYER_WAKEUP_DELAY_MAX); //-6%, try shorter wait next time
+
+      if (_getDelay(_profile->writeDelay) == 0) {_txReadyTime = millis();}                                                      //release commands held by probe
+      break;
+    #endif
+
+    case DFPLAYER_RETURN_ERROR:
+      if ((frame[6] == 0x05) || (frame[6] == 0x06)) {_playKnown = false;} //0x05=out of range, 0x06=not found, requested track isn't playing
+
+      #if (DFPLAYER_TRANSACTIONS == 1)
+      if (_groupStarted == true) {_abortTransaction();}                   //rest of transaction depends on failed command
+      #endif
+
+      #if (DFPLAYER_POWER_MANAGER == 1)
+      if (_wakeupProbe == false) {break;}
+
+      _wakeupProbe = false;
+
+      if ((frame[6] == 0x01) || (frame[6] == 0x02) || (frame[6] == 0x0A)) //0x01=busy, 0x02=sleep, 0x0A=entered sleep
+      {
+        uint16_t latency = constrain(_wakeupLatency + (_wakeupLatency >> 2), DFPLAYER_WAKEUP_DELAY_MIN, DFPLAYER_WAKEUP_DELAY_MAX); //+25%, module wasn't ready
+        uint32_t retry   = millis() + (latency - _wakeupLatency);                                                                  //resent by "update()" after extra wait
+
+        if ((int32_t)(retry - _txReadyTime) > 0) {_txReadyTime = retry;}
+
+        _wakeupLatency = latency;
+        _wakeupRetry   = true;
+      }
+      #endif
+      break;
+  }
+}
+
+
+/**************************************************************************/
+/*
+    _trackCommand()
+
+    Update player, power state & settings to restore from sent command
+*/
+ /**************************************************************************/
+void DFPlayer::_trackCommand(uint8_t command, uint8_t dataMSB, uint8_t dataLSB)
+{
+  _checkBusyPin();                                    //track may have finished since last "update()"
+
+  uint32_t timeNow = millis();
+
+  switch (command)
+  {
+    case DFPLAYER_PLAY_TRACK:
+    case DFPLAYER_PLAY_FOLDER:
+    case DFPLAYER_PLAY_MP3_FOLDER:
+    case DFPLAYER_PLAY_3000_FOLDER:
+    case DFPLAYER_LOOP_TRACK:
+      _playFolder = (command == DFPLAYER_PLAY_FOLDER)      ? dataMSB              :
+                    (command == DFPLAYER_PLAY_MP3_FOLDER)  ? DFPLAYER_FOLDER_MP3  :
+                    (command == DFPLAYER_PLAY_3000_FOLDER) ? DFPLAYER_FOLDER_3000 : DFPLAYER_FOLDER_ROOT;
+      _playTrack  = (command == DFPLAYER_PLAY_FOLDER)      ? dataLSB              : (((uint16_t)dataMSB << 8) | dataLSB);
+      _playStart  = timeNow;
+      _playKnown  = true;
+      break;
+
+    case DFPLAYER_PLAY_NEXT:
+    case DFPLAYER_PLAY_PREV:
+    case DFPLAYER_REPEAT_FOLDER:
+    case DFPLAYER_RANDOM_ALL_FILES:
+    case DFPLAYER_SET_PLAY_SRC:
+    case DFPLAYER_SET_STANDBY_MODE:
+    case DFPLAYER_STOP_PLAYBACK:
+    case DFPLAYER_RESET:
+      _playKnown = false; //track number unknown or playback interrupted
+      break;
+
+    case DFPLAYER_PAUSE:
+      if (_playing == true) {_pauseStart = timeNow + ((_getTxTime() + (DFPLAYER_UART_FRAME_SIZE * DFPLAYER_UART_BYTE_TIME)) / 1000) - 1;} //pause starts when frame arrives, not earlier
+      break;
+
+    case DFPLAYER_RESUME_PLAYBACK:
+      if ((_playing == false) && ((int32_t)(timeNow - _pauseStart) > 0)) {_playStart += timeNow - _pauseStart;} //pause doesn't count
+      break;
+  }
+
+  switch (command)
+  {
+    case DFPLAYER_PLAY_NEXT:
+    case DFPLAYER_PLAY_PREV:
+    case DFPLAYER_PLAY_TRACK:
+    case DFPLAYER_PLAY_FOLDER:
+    case DFPLAYER_PLAY_MP3_FOLDER:
+    case DFPLAYER_PLAY_3000_FOLDER:
+    case DFPLAYER_RESUME_PLAYBACK:
+      _playing      = true;
+      _looping      = false;
+      _busyLow      = false; //BUSY-pin is still high until playback (re)starts
+      _pausePending = false;
+      break;
+
+    case DFPLAYER_LOOP_TRACK:
+    case DFPLAYER_REPEAT_FOLDER:
+    case DFPLAYER_RANDOM_ALL_FILES:
+      _playing      = true;
+      _looping      = true;
+      _busyLow      = false;
+      _pausePending = false;
+      break;
+
+    case DFPLAYER_REPEAT_ALL:
+    case DFPLAYER_LOOP_CURRENT_TRACK:
+      _looping = (command == DFPLAYER_REPEAT_ALL) ? dataLSB : !dataLSB; //0x01=start repeat/0x00=repeat
+      _playing = _playing || _looping;
+      break;
+
+    case DFPLAYER_PAUSE:
+      _pausePending = _playing;                              //BUSY-pin state is cleared when pause arrives, see "_checkBusyPin()"
+      _playing      = false;
+      _looping      = false;
+      break;
+
+    case DFPLAYER_STOP_PLAYBACK:
+    case DFPLAYER_RESET:
+      _playing = false;
+      _looping = false;
+      _busyLow = false; //BUSY-pin goes high, it's not end of track
+      break;
+
+    case DFPLAYER_SET_STANDBY_MODE:
+      _playing = false;
+
+      #if (DFPLAYER_POWER_MANAGER == 1)
+      _setPowerState(DFPLAYER_POWER_STANDBY);
+      #endif
+      break;
+
+    #if (DFPLAYER_POWER_MANAGER == 1)
+    case DFPLAYER_SET_NORMAL_MODE:
+      if (_powerState != DFPLAYER_POWER_WAKING) {_setPowerState(DFPLAYER_POWER_ACTIVE);}
+      break;
+    #endif
+
+    case DFPLAYER_SET_PLAY_SRC:
+      _playing = false;
+
+      if (dataLSB != 6) {_source = dataLSB;}                                                   //6=Sleep, source unchanged
+
+      #if (DFPLAYER_POWER_MANAGER == 1)
+      if      (dataLSB == 6)                         {_setPowerState(DFPLAYER_POWER_STANDBY);} //6=Sleep
+      else if (_powerState != DFPLAYER_POWER_WAKING) {_setPowerState(DFPLAYER_POWER_ACTIVE);}  //"setSource()" waits for source itself
+      #endif
+      break;
+  }
+
+  #if (DFPLAYER_CONFIG_RESTORE == 1)
+  switch (command)
+  {
+    case DFPLAYER_SET_VOL:
+      _volume = dataLSB;
+      break;
+
+    case DFPLAYER_SET_VOL_UP:
+      if ((_volume != DFPLAYER_CONFIG_UNKNOWN) && (_volume < 30)) {_volume++;}
+      break;
+
+    case DFPLAYER_SET_VOL_DOWN:
+      if ((_volume != DFPLAYER_CONFIG_UNKNOWN) && (_volume > 0))  {_volume--;}
+      break;
+
+    case DFPLAYER_SET_EQ:
+      _eq = dataLSB;
+      break;
+
+    case DFPLAYER_SET_DAC:
+      _dacDisabled = dataLSB;                                   //0=enable, 1=disable
+      break;
+
+    case DFPLAYER_SET_DAC_GAIN:
+      _dacGain        = dataLSB;
+      _dacGainEnabled = dataMSB;
+      break;
+
+    case DFPLAYER_RESET:
+      _restorePending = true;                                   //restored after boot, see "_restoreConfig()"
+      _restoreStep    = 0;
+      break;
+  }
+  #endif
+}
+
+
+/**************************************************************************/
+/*
+    _isPlaybackCommand()
+
+    Check if command is ignored by module in sleep or standby mode
+*/
+ /**************************************************************************/
+bool DFPlayer::_isPlaybackCommand(uint8_t command)
+{
+  switch (command)
+  {
+    case DFPLAYER_PLAY_NEXT:
+    case DFPLAYER_PLAY_PREV:
+    case DFPLAYER_PLAY_TRACK:
+    case DFPLAYER_LOOP_TRACK:
+    case DFPLAYER_RESUME_PLAYBACK:
+    case DFPLAYER_PLAY_FOLDER:
+    case DFPLAYER_REPEAT_ALL:
+    case DFPLAYER_PLAY_MP3_FOLDER:
+    case DFPLAYER_PLAY_ADVERT_FOLDER:
+    case DFPLAYER_PLAY_3000_FOLDER:
+    case DFPLAYER_REPEAT_FOLDER:
+    case DFPLAYER_RANDOM_ALL_FILES:
+    case DFPLAYER_LOOP_CURRENT_TRACK:
+    case DFPLAYER_PLAY_ADVERT_FOLDER_N:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+
+/**************************************************************************/
+/*
+    _pushCommand()
+
+    Add command to TX queue, after all queued commands of the same or
+    higher priority class
+
+    NOTE:
+    - return false if queue is full
+    - pacing gap is still applied between commands, only order is changed
+    - commands are reordered only between barriers, barrier never moves &
+      nothing moves ahead of it, e.g. play sent after "set source" or
+      reset must reach module after them, see "_getPriority()"
+    - command never moves into or ahead of transaction, commands of open
+      transaction are added in order, see "beginTransaction()"
+*/
+ /**************************************************************************/
+bool DFPlayer::_pushCommand(uint8_t command, uint8_t dataMSB, uint8_t dataLSB)
+{
+  if (_queueCount >= DFPLAYER_QUEUE_SIZE) {return false;}
+
+  uint8_t priority = _getPriority(command);
+  uint8_t position = _queueCount;
+  uint8_t first    = 0;                                                          //lowest position command can move to
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  if ((_groupOpen == true) || (_groupLength != 0)) {first = _groupPos + _groupLength;}
+  #endif
+
+  while (position > first)
+  {
+    uint8_t queued = _getPriority(_queue[(_queueHead + position - 1) % DFPLAYER_QUEUE_SIZE].command);
+
+    if ((queued == DFPLAYER_PRIORITY_BARRIER) || (queued <= priority)) {break;}                                        //barrier priority is the highest, it never moves itself
+
+    _queue[(_queueHead + position) % DFPLAYER_QUEUE_SIZE] = _queue[(_queueHead + position - 1) % DFPLAYER_QUEUE_SIZE]; //move lower priority command back
+
+    position--;
+  }
+
+  DFPLAYER_COMMAND &entry = _queue[(_queueHead + position) % DFPLAYER_QUEUE_SIZE];
+
+  entry.command = command;
+  entry.dataMSB = dataMSB;
+  entry.dataLSB = dataLSB;
+
+  _queueCount++;
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  if (_groupOpen == true) {_groupLength++;}
+  #endif
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    _cancelCommands()
+
+    Remove queued commands made obsolete by new command
+
+    NOTE:
+    - stop/pause cancel queued playback & pause commands
+    - play by number cancels queued playback commands, except advert
+    - volume/EQ/DAC/DAC gain cancel queued command of the same setting
+    - stop is never cancelled, it must be sent after pause to play new
+      track from another folder
+    - commands of released transaction are never cancelled, see
+      "endTransaction()"
+*/
+ /**************************************************************************/
+void DFPlayer::_cancelCommands(uint8_t command)
+{
+  uint8_t index = 0;
+
+  while (index < _queueCount)
+  {
+    uint8_t queued   = _queue[(_queueHead + index) % DFPLAYER_QUEUE_SIZE].command;
+    bool    obsolete = false;
+
+    #if (DFPLAYER_TRANSACTIONS == 1)
+    if ((_groupOpen == false) && (index >= _groupPos) && (index < (_groupPos + _groupLength)))
+    {
+      index++;
+      continue;
+    }
+    #endif
+
+    switch (command)
+    {
+      case DFPLAYER_STOP_PLAYBACK:
+      case DFPLAYER_PAUSE:
+        obsolete = (queued == DFPLAYER_PAUSE) || (_isPlaybackCommand(queued) == true);
+        break;
+
+      case DFPLAYER_PLAY_TRACK:
+      case DFPLAYER_LOOP_TRACK:
+      case DFPLAYER_PLAY_FOLDER:
+      case DFPLAYER_PLAY_MP3_FOLDER:
+      case DFPLAYER_PLAY_3000_FOLDER:
+      case DFPLAYER_REPEAT_FOLDER:
+      case DFPLAYER_RANDOM_ALL_FILES:
+        obsolete = (_isPlaybackCommand(queued) == true) && (queued != DFPLAYER_PLAY_ADVERT_FOLDER) && (queued != DFPLAYER_PLAY_ADVERT_FOLDER_N);
+        break;
+
+      case DFPLAYER_SET_VOL:
+        obsolete = (queued == DFPLAYER_SET_VOL) || (queued == DFPLAYER_SET_VOL_UP) || (queued == DFPLAYER_SET_VOL_DOWN);
+        break;
+
+      case DFPLAYER_SET_EQ:
+      case DFPLAYER_SET_DAC:
+      case DFPLAYER_SET_DAC_GAIN:
+        obsolete = (queued == command);
+        break;
+    }
+
+    if (obsolete == false)
+    {
+      index++;
+      continue;
+    }
+
+    for (uint8_t i = index; i < (_queueCount - 1); i++)
+    {
+      _queue[(_queueHead + i) % DFPLAYER_QUEUE_SIZE] = _queue[(_queueHead + i + 1) % DFPLAYER_QUEUE_SIZE]; //close the gap
+    }
+
+    _queueCount--;
+
+    #if (DFPLAYER_TRANSACTIONS == 1)
+    if      (index < _groupPos)                   {_groupPos--;}
+    else if (index < (_groupPos + _groupLength)) {_groupLength--;}
+    #endif
+  }
+}
+
+
+/**************************************************************************/
+/*
+    _getPriority()
+
+    Get command priority class, lower value sent first
+
+    NOTE:
+    - priority classes:
+      - DFPLAYER_PRIORITY_TRANSPORT, stop/pause/play & other playback control
+      - DFPLAYER_PRIORITY_SETTINGS, volume/EQ/DAC & other settings
+      - DFPLAYER_PRIORITY_BACKGROUND, read commands
+      - DFPLAYER_PRIORITY_BARRIER, source/standby/normal mode/reset, they
+        change module state other commands depend on, nothing is moved
+        across them
+*/
+ /**************************************************************************/
+uint8_t DFPlayer::_getPriority(uint8_t command)
+{
+  switch (command)
+  {
+    case DFPLAYER_SET_PLAY_SRC:
+    case DFPLAYER_SET_STANDBY_MODE:
+    case DFPLAYER_SET_NORMAL_MODE:
+    case DFPLAYER_RESET:
+      return DFPLAYER_PRIORITY_BARRIER;
+  }
+
+  if ((command == DFPLAYER_STOP_PLAYBACK) || (command == DFPLAYER_PAUSE) || (command == DFPLAYER_STOP_ADVERT_FOLDER) || (_isPlaybackCommand(command) == true))
+  {
+    return DFPLAYER_PRIORITY_TRANSPORT;
+  }
+
+  if (_isQueryCommand(command) == true) {return DFPLAYER_PRIORITY_BACKGROUND;}
+                                        return DFPLAYER_PRIORITY_SETTINGS;
+}
+
+
+/**************************************************************************/
+/*
+    _sendNext()
+
+    Send oldest queued command, return false if nothing was sent
+
+    NOTE:
+    - open transaction isn't sent until "endTransaction()", commands
+      queued before it are sent
+    - "set source" inside transaction is followed by source selection
+      time, same as "setSource()" waits outside transaction
+*/
+ /**************************************************************************/
+bool DFPlayer::_sendNext()
+{
+  if (_queueCount == 0) {return false;}
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  bool member = false;                                                  //true=command belongs to transaction
+
+  if ((_groupOpen == true) || (_groupLength != 0))
+  {
+    if (_groupPos != 0)          {_groupPos--;}
+    else if (_groupOpen == true) {return false;}                       //transaction isn't released yet
+    else
+    {
+      member        = true;
+      _groupStarted = true;
+      _groupLength--;
+    }
+  }
+  #endif
+
+  DFPLAYER_COMMAND entry = _queue[_queueHead];
+
+  _queueHead = (_queueHead + 1) % DFPLAYER_QUEUE_SIZE;
+  _queueCount--;
+
+  _writeFrame(entry.command, entry.dataMSB, entry.dataLSB);
+
+  #if (DFPLAYER_TRANSACTIONS == 1)
+  if (member == false) {return true;}
+
+  if ((entry.command == DFPLAYER_SET_PLAY_SRC) && (entry.dataLSB != 6)) {_waitForSource();} //6=Sleep
+
+  if ((_groupStarted == true) && (_groupLength == 0))                   //not aborted by error feedback, see "_parseEvent()"
+  {
+    _groupStarted      = false;
+    _transactionStatus = DFPLAYER_TRANSACTION_DONE;
+  }
+  #endif
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    _sendQueue()
+
+    Send queued commands while pacing allows, without blocking
+*/
+ /**************************************************************************/
+void DFPlayer::_sendQueue()
+{
+  #if (DFPLAYER_TX_BATCH > 1)
+  bool batch = _openBatch();
+  #endif
+
+  while ((_getTxDelay() == 0) && (_sendNext() == true)) {}
+
+  #if (DFPLAYER_TX_BATCH > 1)
+  if (batch == true) {_closeBatch();}
+  #endif
+}
+
+
+/**************************************************************************/
+/*
+    _drainQueue()
+
+    Send all queued commands, wait for pacing gap between them
+
+    NOTE:
+    - commands waiting for wake up & open transaction stay in the queue
+*/
+ /**************************************************************************/
+void DFPlayer::_drainQueue()
+{
+  #if (DFPLAYER_TX_BATCH > 1)
+  bool batch = _openBatch();
+  #endif
+
+  while (_queueCount != 0)
+  {
+    #if (DFPLAYER_POWER_MANAGER == 1)
+    if (_powerState == DFPLAYER_POWER_WAKING) {break;}
+    #endif
+
+    if (_sendNext() == false) {break;}
+  }
+
+  #if (DFPLAYER_TX_BATCH > 1)
+  if (batch == true) {_closeBatch();}
+  #endif
+}
+
+
+#if (DFPLAYER_TX_BATCH > 1)
+/**************************************************************************/
+/*
+    _openBatch()
+
+    Start collecting frames for one serial write, return false if batch
+    can't be opened
+
+    NOTE:
+    - frame is added to batch only if pacing allows next frame right
+      after it, e.g. YX5200 without write delay, slow chips get one
+      frame per write as before, see "_writeFrame()"
+    - batch is shared by all instances & owned by one of them, it's
+      written before "_sendQueue()" or "_drainQueue()" returns
+    - not used on half-duplex transport, every frame waits for quiet
+      RX line, see "setHalfDuplex()"
+    - transport without TX buffer returns 0 by "availableForWrite()",
+      e.g. SoftwareSerial, every frame is written directly
+*/
+ /**************************************************************************/
+bool DFPlayer::_openBatch()
+{
+  if (_txBatchOwner != NULL) {return false;}                    //already collected by caller
+
+  #if (DFPLAYER_HALF_DUPLEX == 1)
+  if (_halfDuplex == true) {return false;}
+  #endif
+
+  _txBatchOwner  = this;
+  _txBatchLength = 0;
+
+  return true;
+}
+
+
+/**************************************************************************/
+/*
+    _closeBatch()
+
+    Write collected frames & stop collecting
+*/
+ /**************************************************************************/
+void DFPlayer::_closeBatch()
+{
+  _flushBatch();
+
+  _txBatchOwner = NULL;
+}
+
+
+/**************************************************************************/
+/*
+    _flushBatch()
+
+    Write collected frames by one serial call, batch stays open
+*/
+ /**************************************************************************/
+void DFPlayer::_flushBatch()
+{
+  if ((_txBatchOwner != this) || (_txBatchLength == 0)) {return;}
+
+  _writeBytes(_txBatch, _txBatchLength);
+
+  _txBatchLength = 0;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    _getTxDelay()
+
+    Get time left until next command can be written, in msec
+*/
+ /**************************************************************************/
+uint32_t DFPlayer::_getTxDelay()
+{
+  int32_t timeLeft = _txReadyTime - millis();
+
+  if (timeLeft > 0) {return timeLeft;}
+
+  #if (DFPLAYER_HALF_DUPLEX == 1)
+  if (_isRxBusy() == true)
+  {
+    _txHeld = true;                                             //counted when write is sent, see "_writeFrame()"
+
+    return 1;                                                   //check again in 1msec, frame takes 10.4msec at 9600bps
+  }
+  #endif
+
+  return 0;
+}
+
+
+/**************************************************************************/
+/*
+    _isQueryCommand()
+
+    Check if command is read command, module replies with requested value
 */
  /**************************************************************************/
-void DFPlayer::_sendData(uint8_t command, uint8_t dataMSB, uint8_t dataLSB)
+bool DFPlayer::_isQueryCommand(uint8_t command)
+{
+  return (command >= DFPLAYER_GET_STATUS) && (command <= DFPLAYER_GET_QNT_FOLDERS);
+}
+
+
+/**************************************************************************/
+/*
+    _waitForSource()
+
+    Wait for source selection after "set source" command, same wait as
+    "setSource()" does
+
+    NOTE:
+    - in non-blocking mode source selection time is already added to
+      pacing gap by "_writeFrame()"
+*/
+ /**************************************************************************/
+void DFPlayer::_waitForSource()
 {
-  _dataBuffer[0] = DFPLAYER_UART_START_BYTE;
-  _dataBuffer[1] = DFPLAYER_UART_VERSION;
-  _dataBuffer[2] = DFPLAYER_UART_DATA_LEN;
-  _dataBuffer[3] = command;
-  _dataBuffer[4] = _ack;
-  _dataBuffer[5] = dataMSB;
-  _dataBuffer[6] = dataLSB;
+  if (_nonBlocking == true) {return;}
 
-  int16_t checksum;
+  #if (DFPLAYER_TX_BATCH > 1)
+  _flushBatch();                                                //"set source" is written before wait
+  #endif
+
+  delay(_profile->sourceDelay);
+}
+
+
+#if (DFPLAYER_HALF_DUPLEX == 1)
+/**************************************************************************/
+/*
+    _isRxBusy()
+
+    Check if write command would collide with RX frame on half-duplex
+    transport
+
+    NOTE:
+    - received bytes are collected first, busy if start byte was received
+      & frame isn't complete
+    - incomplete frame older than DFPLAYER_RX_FRAME_TIMEOUT is dropped &
+      counted as lost, its bytes never arrive
+    - always false on full-duplex transport, see "setHalfDuplex()"
+*/
+ /**************************************************************************/
+bool DFPlayer::_isRxBusy()
+{
+  if (_halfDuplex == false) {return false;}
+
+  _readEvents();
+
+  if (_rxIndex == 0)        {return false;}
+
+  if ((millis() - _rxStartTime) < DFPLAYER_RX_FRAME_TIMEOUT) {return true;}
+
+  _rxIndex = 0;                                                 //rest of frame was lost
+  _framesLost++;
+
+  return false;
+}
+#endif
+
+
+#if (DFPLAYER_CONFIG_RESTORE == 1)
+/**************************************************************************/
+/*
+    _restoreConfig()
+
+    Send next setting lost by reset or reboot, finish restore if there is
+    nothing left
 
-  switch (_moduleType)
+    NOTE:
+    - setting is skipped if it was never sent, equal to factory default
+      or not supported by module, see "DFPLAYER_PROFILE"
+    - source is restored first, other settings wait for it
+*/
+ /**************************************************************************/
+void DFPlayer::_restoreConfig()
+{
+  while (_restoreStep < 5)
   {
-    case DFPLAYER_MINI:
-    case DFPLAYER_HW_247A:
-      checksum = 0;        //0x0000, DON'T TOUCH!!!
-      checksum = checksum - _dataBuffer[1] - _dataBuffer[2] - _dataBuffer[3] - _dataBuffer[4] - _dataBuffer[5] - _dataBuffer[6];
-      break;
+    switch (_restoreStep++)
+    {
+      case 0:
+        if ((_source == 2) || (isSupported(DFPLAYER_SET_PLAY_SRC) == false)) {break;} //2=TF-Card, selected after boot
 
-    case DFPLAYER_FN_X10P:
-      checksum = 35535;    //0xFFFF, DON'T TOUCH!!!
-      checksum = checksum - _dataBuffer[1] - _dataBuffer[2] - _dataBuffer[3] - _dataBuffer[4] - _dataBuffer[5] - _dataBuffer[6] + 1;
-      break;
+        _writeFrame(DFPLAYER_SET_PLAY_SRC, 0, _source);
+        _waitForSource();
+        return;
 
-    case DFPLAYER_NO_CHECKSUM:
-    default:
-      //empty              //no checksum calculation, not recomended for MCU without external crystal oscillator
-      break;
+      case 1:
+        if ((_volume == DFPLAYER_CONFIG_UNKNOWN) || (_volume == DFPLAYER_DEFAULT_VOLUME) || (isSupported(DFPLAYER_SET_VOL) == false)) {break;}
+
+        _writeFrame(DFPLAYER_SET_VOL, 0, _volume);
+        return;
+
+      case 2:
+        if ((_eq == DFPLAYER_CONFIG_UNKNOWN) || (_eq == 0) || (isSupported(DFPLAYER_SET_EQ) == false)) {break;} //0=Off
+
+        _writeFrame(DFPLAYER_SET_EQ, 0, _eq);
+        return;
+
+      case 3:
+        if ((_dacDisabled == false) || (isSupported(DFPLAYER_SET_DAC) == false)) {break;}
+
+        _writeFrame(DFPLAYER_SET_DAC, 0, 1);                                    //1=disable
+        return;
+
+      case 4:
+        if ((_dacGain == DFPLAYER_CONFIG_UNKNOWN) || (isSupported(DFPLAYER_SET_DAC_GAIN) == false)) {break;}
+
+        _writeFrame(DFPLAYER_SET_DAC_GAIN, _dacGainEnabled, _dacGain);
+        return;
+    }
   }
 
-  switch (_moduleType)
+  _restorePending = false;
+  _configRestored = true;
+}
+#endif
+
+
+#if (DFPLAYER_TRANSACTIONS == 1)
+/**************************************************************************/
+/*
+    _abortTransaction()
+
+    Remove transaction commands from TX queue & report failure
+*/
+ /**************************************************************************/
+void DFPlayer::_abortTransaction()
+{
+  for (uint8_t i = _groupPos; (i + _groupLength) < _queueCount; i++)
   {
-    case DFPLAYER_MINI:
-    case DFPLAYER_FN_X10P:
-    case DFPLAYER_HW_247A:
-      _dataBuffer[7] = checksum >> 8;
-      _dataBuffer[8] = checksum;
+    _queue[(_queueHead + i) % DFPLAYER_QUEUE_SIZE] = _queue[(_queueHead + i + _groupLength) % DFPLAYER_QUEUE_SIZE]; //close the gap
+  }
 
-      _dataBuffer[9] = DFPLAYER_UART_END_BYTE;
+  _queueCount       -= _groupLength;
+  _groupLength       = 0;
+  _groupOpen         = false;
+  _groupStarted      = false;
+  _transactionStatus = DFPLAYER_TRANSACTION_FAILED;
+}
+#endif
 
-      _serial->write(_dataBuffer, DFPLAYER_UART_FRAME_SIZE);
 
-      if (_moduleType == DFPLAYER_HW_247A) {delay(_threshold);}    //GD3200B/MH2024K chip so slow & need delay after write command
-      break;
+#if (DFPLAYER_POWER_MANAGER == 1)
+/**************************************************************************/
+/*
+    _startWakeup()
 
-    case DFPLAYER_NO_CHECKSUM:
-    default:
-      _dataBuffer[7] = DFPLAYER_UART_END_BYTE;
+    Select source or exit standby without blocking, module is ready after
+    measured wake up latency, see "update()"
 
-      _serial->write(_dataBuffer, (DFPLAYER_UART_FRAME_SIZE - 2)); //-2=SUMH & SUML not used
-      break;
+    NOTE:
+    - wake up strategy depends on chip, see "DFPLAYER_PROFILE"
+*/
+ /**************************************************************************/
+void DFPlayer::_startWakeup()
+{
+  _setPowerState(DFPLAYER_POWER_WAKING);
+
+  if (_profile->wakeup == DFPLAYER_WAKEUP_NORMAL_MODE) {_writeFrame(DFPLAYER_SET_NORMAL_MODE, 0, 0);}
+  else                                                 {_writeFrame(DFPLAYER_SET_PLAY_SRC, 0, _wakeupSource);}
+
+  _lastActivity = millis();
+}
+
+
+/**************************************************************************/
+/*
+    _finishWakeup()
+
+    Make module active after wake up time
+
+    NOTE:
+    - with feedback enabled first queued command is sent as probe, module
+      reply to it shows if wake up time was long enough, see "_parseEvent()"
+    - without feedback queued commands are sent by "update()" as usual
+*/
+ /**************************************************************************/
+void DFPlayer::_finishWakeup()
+{
+  _setPowerState(DFPLAYER_POWER_ACTIVE);
+
+  if ((_ack == false) || (_queueCount == 0)) {return;}
+
+  _wakeupCommand = _queue[_queueHead];  //resent if module wasn't ready
+
+  if (_sendNext() == true) {_startProbe();}
+}
+
+
+/**************************************************************************/
+/*
+    _startProbe()
+
+    Wait for module reply to first command after wake up
+
+    NOTE:
+    - other commands are held for feedback timeout, they would be rejected
+      too if module isn't ready, reply "OK" releases them early
+*/
+ /**************************************************************************/
+void DFPlayer::_startProbe()
+{
+  uint32_t holdTime = millis() + _threshold;
+
+  if ((int32_t)(holdTime - _txReadyTime) > 0) {_txReadyTime = holdTime;}
+
+  _wakeupProbe = true;
+}
+
+
+/**************************************************************************/
+/*
+    _setPowerState()
+
+    Change power state & accumulate time spent in previous state
+*/
+ /**************************************************************************/
+void DFPlayer::_setPowerState(DFPLAYER_POWER_STATE state)
+{
+  uint32_t timeNow = millis();
+
+  _powerStateTime[_powerState] += timeNow - _stateStart;
+
+  _stateStart = timeNow;
+  _powerState = state;
+}
+#endif
+
+
+#if (DFPLAYER_TRIGGER == 1)
+/**************************************************************************/
+/*
+    _checkTrigger()
+
+    Measure trigger to BUSY-pin low latency
+
+    NOTE:
+    - module may not start playback at all (track not found), measurement
+      is abandoned after DFPLAYER_TRIGGER_TIMEOUT
+*/
+ /**************************************************************************/
+void DFPlayer::_checkTrigger()
+{
+  if (_triggerPending == false) {return;}
+
+  uint32_t latency = micros() - _triggerStart;
+
+  if (digitalRead(_busyPin) == LOW)
+  {
+    _triggerPending = false;
+    _triggerLatency = latency;
+
+    if (latency > _triggerLatencyMax) {_triggerLatencyMax = latency;}
+  }
+  else if (latency > (DFPLAYER_TRIGGER_TIMEOUT * 1000UL))
+  {
+    _triggerPending = false;
   }
 }
+#endif
 
 
 /**************************************************************************/
 /*
-    _readData()
+    _checkBusyPin()
 
-    Read MP3 player command feedback
+    Detect end of playback by BUSY-pin
 
     NOTE:
-    - command feedback timeout 100msec(YX5200/AAxxxx)..350msec(GD3200B/MH2024K)
+    - BUSY-pin goes low about 100msec after playback command, track is
+      finished when pin goes back high
+    - pin high after pause is sent, but before pause frame arrives, is
+      end of track, module ignores pause & resume restarts the track
+    - pause on the way is flagged explicitly, pin high after "track
+      finished" feedback or stop is never end of track at any uptime
+*/
+ /**************************************************************************/
+void DFPlayer::_checkBusyPin()
+{
+  if (_busyPin == DFPLAYER_NO_BUSY_PIN) {return;}
 
-    - DFPlayer RX data frame format:
-      0      1    2    3    4    5   6   7     8     9-byte
-      START, VER, LEN, CMD, ACK, DH, DL, SUMH, SUML, END
+  if (_playing == false)
+  {
+    if (_busyLow == false) {return;}
+
+    if ((_pausePending == false) || ((int32_t)(millis() - _pauseStart) >= 0)) {_busyLow = false; _pausePending = false; return;} //finished, stopped or pause arrived, pin high isn't end of track
+    if (digitalRead(_busyPin) == LOW) {return;}                                                                            //still playing, pause is on the way
+
+    _playing      = true;                                                 //track finished before pause arrived
+    _pausePending = false;
+  }
+
+  if (digitalRead(_busyPin) == LOW)
+  {
+    _busyLow = true;
+    return;
+  }
+
+  if (_busyLow == false) {return;} //playback not started yet
+
+  _busyLow = false;
+
+  _finishTrack(DFPLAYER_TRACK_UNKNOWN);
+}
+
+
+/**************************************************************************/
+/*
+    _watchPause()
+
+    Watch BUSY-pin until sent pause frame arrives to module
+
+    NOTE:
+    - returns at once if no pause is on the way, otherwise waits up to one
+      frame time, see "_checkBusyPin()"
 */
  /**************************************************************************/
-bool DFPlayer::_readData()
+void DFPlayer::_watchPause()
 {
-  memset(_dataBuffer, 0x00, DFPLAYER_UART_FRAME_SIZE); //clear data buffer
+  while ((_busyPin != DFPLAYER_NO_BUSY_PIN) && (_playing == false) && (_busyLow == true)) {_checkBusyPin(); yield();}
+}
 
-  _serial->flush();                                    //clear serial FIFO
-  _serial->setTimeout(_threshold);                     //set maximum msec to wait for "readBytes()", delay after read command
 
-  /* read serial, wait for data during "setTimeout()" period than error (received less than expected) */
-  if (_serial->readBytes(_dataBuffer, DFPLAYER_UART_FRAME_SIZE) != DFPLAYER_UART_FRAME_SIZE) {return false;}
+/**************************************************************************/
+/*
+    _finishTrack()
+
+    Accept "track finished" once per track, report it to "getFinishedTrack()"
+    & learn duration
+
+    NOTE:
+    - track, number from "track finished" feedback or DFPLAYER_TRACK_UNKNOWN
+      for BUSY-pin
+    - some chips send "track finished" twice & BUSY-pin reports the same
+      finish as feedback, same or unknown track finished again within
+      DFPLAYER_FINISHED_WINDOW is duplicate, feedback after BUSY-pin only
+      fills in track number
+    - module reports global track number, it's compared with number sent
+      by "playTrack()" or "repeatTrack()", other play commands can't be
+      checked
+    - mismatch within DFPLAYER_FINISHED_WINDOW after play command is late
+      feedback of previous track & ignored, later mismatch is accepted as
+      finish of current track, both are flagged, see "isTrackMismatch()"
+    - looped track starts over after it's finished
+*/
+ /**************************************************************************/
+void DFPlayer::_finishTrack(uint16_t track)
+{
+  uint32_t timeNow = millis();
+
+  if (((timeNow - _finishedTime) < DFPLAYER_FINISHED_WINDOW) && ((track == _lastFinished) || (track == DFPLAYER_TRACK_UNKNOWN) || (_lastFinished == DFPLAYER_TRACK_UNKNOWN)))
+  {
+    if (_lastFinished  == DFPLAYER_TRACK_UNKNOWN) {_lastFinished  = track;} //feedback after BUSY-pin
+    if (_finishedTrack == DFPLAYER_TRACK_UNKNOWN) {_finishedTrack = track;} //not read yet
+
+    return;
+  }
+
+  if (_playing == false) {return;} //stopped or already finished
+
+  uint16_t expected = ((_playKnown == true) && (_playFolder == DFPLAYER_FOLDER_ROOT)) ? _playTrack : DFPLAYER_TRACK_UNKNOWN;
+
+  if ((expected != DFPLAYER_TRACK_UNKNOWN) && (track != DFPLAYER_TRACK_UNKNOWN) && (track != expected))
+  {
+    _trackMismatch = true;
+
+    if ((timeNow - _playStart) < DFPLAYER_FINISHED_WINDOW) {return;} //late feedback of previous track
+  }
+
+  if (expected != DFPLAYER_TRACK_UNKNOWN) {track = expected;}
+
+  _finishedTime  = timeNow;
+  _lastFinished  = track;
+  _finishedTrack = track;
+
+  #if (DFPLAYER_DURATION_TABLE_SIZE != 0)
+  uint32_t duration = (timeNow - _playStart + 500) / 1000; //msec->sec, rounded
+
+  if ((_playKnown == true) && (duration != 0) && (duration <= 0xFFFF)) {_storeDuration(_source, _playFolder, _playTrack, duration, false);}
+  #endif
 
-  /* check for start byte missing, version byte missing, length byte missing, end byte missing */
-  return ((_dataBuffer[0] == DFPLAYER_UART_START_BYTE) && (_dataBuffer[1] == DFPLAYER_UART_VERSION) && (_dataBuffer[2] == DFPLAYER_UART_DATA_LEN) && (_dataBuffer[9] == DFPLAYER_UART_END_BYTE));
+  _playStart    = timeNow;
+  _playKnown    = _looping;
+  _pausePending = false;
+
+  if (_looping == false) {_playing = false;}
 }
 
 
+#if (DFPLAYER_DURATION_TABLE_SIZE != 0)
 /**************************************************************************/
 /*
-    _getResponse()
+    _findDuration()
 
-    Get command feedback value from MP3 player
+    Find track in duration table, return table index or -1
 
     NOTE:
-    - return "0" on communication error
+    - open addressing with linear probing, search stops at empty slot
+*/
+ /**************************************************************************/
+int16_t DFPlayer::_findDuration(uint8_t source, uint8_t folder, uint16_t track)
+{
+  uint8_t index = _hashDuration(source, folder, track);
+
+  for (uint8_t i = 0; i < DFPLAYER_DURATION_TABLE_SIZE; i++)
+  {
+    DFPLAYER_DURATION &entry = _durations[index];
+
+    if (entry.seconds == 0) {return -1;} //empty slot
+
+    if ((entry.track == track) && (entry.folder == folder) && (entry.source == source)) {return index;}
+
+    index = (index + 1) % DFPLAYER_DURATION_TABLE_SIZE;
+  }
+
+  return -1;
+}
+
+
+/**************************************************************************/
+/*
+    _storeDuration()
+
+    Add or refine track duration in duration table
+
+    NOTE:
+    - learned duration is averaged with stored one, 3/4 old + 1/4 new
+    - if table is full, track at hashed slot is replaced
+*/
+ /**************************************************************************/
+void DFPlayer::_storeDuration(uint8_t source, uint8_t folder, uint16_t track, uint16_t seconds, bool replace)
+{
+  if (seconds == 0) {return;}
+
+  int16_t found = _findDuration(source, folder, track);
+
+  if (found >= 0)
+  {
+    DFPLAYER_DURATION &entry = _durations[found];
+
+    entry.seconds = (replace == true) ? seconds : (uint16_t)(((uint32_t)entry.seconds * 3 + seconds + 2) >> 2);
+    return;
+  }
+
+  uint8_t index = _hashDuration(source, folder, track);
+
+  for (uint8_t i = 0; i < DFPLAYER_DURATION_TABLE_SIZE; i++)
+  {
+    if (_durations[(index + i) % DFPLAYER_DURATION_TABLE_SIZE].seconds == 0)
+    {
+      index = (index + i) % DFPLAYER_DURATION_TABLE_SIZE;
+      break;
+    }
+  }
+
+  DFPLAYER_DURATION &entry = _durations[index];
+
+  entry.track   = track;
+  entry.folder  = folder;
+  entry.source  = source;
+  entry.seconds = seconds;
+}
+
+
+/**************************************************************************/
+/*
+    _hashDuration()
+
+    Get home slot of track in duration table
+*/
+ /**************************************************************************/
+uint8_t DFPlayer::_hashDuration(uint8_t source, uint8_t folder, uint16_t track)
+{
+  return ((uint16_t)(track * 31) ^ ((uint16_t)folder << 3) ^ source) % DFPLAYER_DURATION_TABLE_SIZE;
+}
+#endif
+
+
+/**************************************************************************/
+/*
+    _hashByte()
+
+    Add byte to FNV-1a hash, see "hashManifest()"
 */
  /**************************************************************************/
-uint16_t DFPlayer::_getResponse(uint8_t command)
+uint32_t DFPlayer::_hashByte(uint32_t hash, uint8_t data)
 {
-  if ((_readData() == true) && (_dataBuffer[3] == command)) {return ((uint16_t)_dataBuffer[5] << 8) | _dataBuffer[6];} //return DH, DL
-                                                             return 0;
+  return (hash ^ data) * 16777619UL;                                       //FNV-1a 32-bit prime
 }
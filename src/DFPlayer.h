@@ -46,6 +46,7 @@
 #define DFPLAYER_UART_VERSION         0xFF //protocol version
 #define DFPLAYER_UART_DATA_LEN        0x06 //number of data bytes, except start byte, checksum & end byte
 #define DFPLAYER_UART_END_BYTE        0xEF //end byte
+#define DFPLAYER_RESPONSE_FRAMES      4    //max frames checked for query response, ACK & feedback may arrive first
 
 /* command controls */
 #define DFPLAYER_PLAY_NEXT            0x01 //play next uploaded file
@@ -96,10 +97,92 @@
 #define DFPLAYER_RETURN_ERROR         0x40 //error, module return this status automatically if command is not accepted (details located in 7-th RX byte)
 #define DFPLAYER_RETURN_CODE_DONE     0x3D //track playback is is completed, module return this status automatically after the track has been played
 #define DFPLAYER_RETURN_CODE_READY    0x3F //ready after boot or reset, module return this status automatically after boot or reset
+#define DFPLAYER_RETURN_CODE_INSERTED 0x3A //USB-Disk/TF-card inserted, module return this status automatically
+#define DFPLAYER_RETURN_CODE_REMOVED  0x3B //USB-Disk/TF-card removed & playback stopped, module return this status automatically
 
 /* misc */
 #define DFPLAYER_BOOT_DELAY           3000 //average player boot time 1500sec..3000msec, depends on SD-card size
 #define DFPLAYER_CMD_DELAY            350  //average read command timeout 200msec..300msec for YX5200/AAxxxx chip & 350msec..500msec for GD3200B/MH2024K chip
+#define DFPLAYER_WAKEUP_DELAY         200  //average time to select source after sleep or standby, in msec
+#define DFPLAYER_WAKEUP_DELAY_MIN     50   //lower limit for measured wake up latency, in msec
+#define DFPLAYER_WAKEUP_DELAY_MAX     3000 //upper limit for measured wake up latency, in msec
+#define DFPLAYER_NO_DEADLINE          0xFFFFFFFF //"update()" return value, nothing pending
+#define DFPLAYER_NO_BUSY_PIN          0xFF //BUSY-pin not connected
+#define DFPLAYER_BUSY_POLL            100  //BUSY-pin poll period while playing & track duration is unknown, in msec
+#define DFPLAYER_TRIGGER_GUARD        30   //other traffic is paused after trigger, in msec
+#define DFPLAYER_TRIGGER_TIMEOUT      1000 //stop waiting for BUSY-pin after trigger, in msec
+#define DFPLAYER_DEFAULT_VOLUME       30   //factory default volume after boot or reset
+#define DFPLAYER_CONFIG_UNKNOWN       0xFF //setting wasn't sent by library & isn't restored
+#define DFPLAYER_RX_FRAME_TIMEOUT     20   //incomplete RX frame is dropped after, 10.4msec frame at 9600bps, in msec
+#define DFPLAYER_UART_BYTE_TIME       1042 //time of 1 byte at 9600bps 8N1, 10-bits, in usec
+#define DFPLAYER_TX_TIME_MAX          1000000 //longer estimated TX time means last byte already left, 960 bytes at 9600bps, in usec
+#define DFPLAYER_FINISHED_WINDOW      500  //same track finished again within window is duplicate, in msec
+#define DFPLAYER_TRACK_NONE           0x0000 //"getFinishedTrack()" value, no track finished since last call
+#define DFPLAYER_TRACK_UNKNOWN        0xFFFF //"getFinishedTrack()" value, track finished but number is unknown
+
+/* TX queue priority classes, lower value sent first */
+#define DFPLAYER_PRIORITY_TRANSPORT   0x00 //stop, pause, play & other playback control
+#define DFPLAYER_PRIORITY_SETTINGS    0x01 //volume, EQ, DAC & other settings
+#define DFPLAYER_PRIORITY_BACKGROUND  0x02 //read commands
+#define DFPLAYER_PRIORITY_BARRIER     0xFF //source, standby, normal mode & reset, never reordered & nothing moves across them
+
+/* duration table folder values */
+#define DFPLAYER_FOLDER_ROOT          0x00 //tracks in the root, "playTrack()"
+#define DFPLAYER_FOLDER_MP3           0x64 //tracks in "mp3" folder, "playMP3Folder()"
+#define DFPLAYER_FOLDER_3000          0x65 //tracks in 3000 tracks folders, "play3000Folder()"
+
+#ifndef DFPLAYER_DURATION_TABLE_SIZE
+#define DFPLAYER_DURATION_TABLE_SIZE  16   //number of learned track durations, 6-bytes each, 0..255, 0=duration learning disabled, may be redefined before include
+#endif
+
+#if (DFPLAYER_DURATION_TABLE_SIZE > 255)
+#error "DFPLAYER_DURATION_TABLE_SIZE must be 0..255, table & snapshot use 8-bit index"
+#endif
+
+#ifndef DFPLAYER_QUEUE_SIZE
+#define DFPLAYER_QUEUE_SIZE           8    //max number of commands waiting in TX queue, 3-bytes each, 1..255, may be redefined before include
+#endif
+
+#if (DFPLAYER_QUEUE_SIZE < 1) || (DFPLAYER_QUEUE_SIZE > 255)
+#error "DFPLAYER_QUEUE_SIZE must be 1..255, queue uses 8-bit index"
+#endif
+
+/* optional subsystems, 0=compiled out & cost zero bytes per instance, set in build flags so library & sketch see the same value */
+#ifndef DFPLAYER_POWER_MANAGER
+#define DFPLAYER_POWER_MANAGER        1    //idle standby, scheduled wake up & power state statistics, see "setIdleTimeout()"
+#endif
+
+#ifndef DFPLAYER_TRIGGER
+#define DFPLAYER_TRIGGER              1    //pre-encoded low latency play command, see "setTrigger()"
+#endif
+
+#ifndef DFPLAYER_TRANSACTIONS
+#define DFPLAYER_TRANSACTIONS         1    //group of write commands sent as one unit, see "beginTransaction()"
+#endif
+
+#ifndef DFPLAYER_CONFIG_RESTORE
+#define DFPLAYER_CONFIG_RESTORE       1    //replay changed settings after reset or unexpected reboot, see "isConfigRestored()"
+#endif
+
+#ifndef DFPLAYER_SNAPSHOT
+#define DFPLAYER_SNAPSHOT             1    //library state saved to RTC memory or flash for warm start, see "saveSnapshot()"
+#endif
+
+#ifndef DFPLAYER_HALF_DUPLEX
+#define DFPLAYER_HALF_DUPLEX          1    //TX waits for quiet RX line on SoftwareSerial, see "setHalfDuplex()"
+#endif
+
+#ifndef DFPLAYER_CALIBRATION
+#define DFPLAYER_CALIBRATION          1    //search for smallest reliable gap between commands, see "calibrateGap()"
+#endif
+
+#ifndef DFPLAYER_TX_BATCH
+#define DFPLAYER_TX_BATCH             4    //max frames per serial write when pacing allows back-to-back frames, 1=frame by frame
+#endif
+
+#ifndef DFPLAYER_SHARED_DURATIONS
+#define DFPLAYER_SHARED_DURATIONS     0    //1=one duration table for all instances, for players with the same media
+#endif
 
 
 /* list of supported modules */
@@ -112,6 +195,131 @@ typedef enum : uint8_t
 }
 DFPLAYER_MODULE_TYPE;
 
+/* personality profile checksum types */
+#define DFPLAYER_CHECKSUM_0000        0x00 //checksum = 0x0000 - sum(VER..DL), YX5200/YX5300/JL AAxxxx/GD3200B/MH2024K chip
+#define DFPLAYER_CHECKSUM_FFFF        0x01 //checksum = 0xFFFF - sum(VER..DL) + 1, FN6100 chip
+#define DFPLAYER_CHECKSUM_NONE        0x02 //no checksum, frame is 8-bytes long
+
+/* personality profile wake up strategies */
+#define DFPLAYER_WAKEUP_SOURCE        0x00 //exit sleep & standby by selecting source
+#define DFPLAYER_WAKEUP_NORMAL_MODE   0x01 //exit standby by "normal mode" command, exit sleep by selecting source
+
+/* personality profile misc */
+#define DFPLAYER_DELAY_TIMEOUT        0xFFFF     //profile delay equal to feedback timeout, see "setTimeout()"
+#define DFPLAYER_COMMAND_BIT(cmd)     (((cmd) < 32) ? (1UL << (cmd)) : 1UL) //write command bit in profile, bit 0 is for command 0x25
+#define DFPLAYER_QUERY_BIT(cmd)       (1U << ((cmd) - 0x40))                //read command bit in profile
+#define DFPLAYER_ALL_COMMANDS         0xFFFFFFFF //all write commands supported
+#define DFPLAYER_ALL_QUERIES          0xFFFF     //all read commands supported
+#define DFPLAYER_USB_QUERIES          (DFPLAYER_QUERY_BIT(DFPLAYER_GET_QNT_USB_FILES)   | DFPLAYER_QUERY_BIT(DFPLAYER_GET_USB_TRACK))   //USB-Disk read commands
+#define DFPLAYER_FLASH_QUERIES        (DFPLAYER_QUERY_BIT(DFPLAYER_GET_QNT_FLASH_FILES) | DFPLAYER_QUERY_BIT(DFPLAYER_GET_FLASH_TRACK)) //NOR-Flash read commands
+#define DFPLAYER_ADVERT_COMMANDS      (DFPLAYER_COMMAND_BIT(DFPLAYER_PLAY_ADVERT_FOLDER) | DFPLAYER_COMMAND_BIT(DFPLAYER_STOP_ADVERT_FOLDER) | DFPLAYER_COMMAND_BIT(DFPLAYER_PLAY_ADVERT_FOLDER_N)) //"advert" folder write commands
+#define DFPLAYER_STATUS_CODES         6          //size of status decoding table
+
+/* status decoding table entry */
+typedef struct
+{
+  uint16_t response; //DH, DL of "getStatus()" response
+  uint8_t  status;   //0=stop, 1=playing, 2=pause, 3=sleep or standby, 4=communication error, 5=unknown state
+}
+DFPLAYER_STATUS_CODE;
+
+/* chip personality profile */
+typedef struct
+{
+  uint8_t              checksum;                      //DFPLAYER_CHECKSUM_0000, DFPLAYER_CHECKSUM_FFFF or DFPLAYER_CHECKSUM_NONE
+  uint8_t              wakeup;                        //DFPLAYER_WAKEUP_SOURCE or DFPLAYER_WAKEUP_NORMAL_MODE
+  uint16_t             writeDelay;                    //delay after last byte of write command left TX-pin, 0=not needed or DFPLAYER_DELAY_TIMEOUT, in msec
+  uint16_t             sourceDelay;                   //time to select source, in msec
+  uint16_t             bootDelay;                     //time to boot after power up or reset, in msec
+  uint32_t             commands;                      //supported write commands, see "DFPLAYER_COMMAND_BIT()"
+  uint16_t             queries;                       //supported read commands, see "DFPLAYER_QUERY_BIT()"
+  DFPLAYER_STATUS_CODE status[DFPLAYER_STATUS_CODES]; //"getStatus()" decoding, response not in table is 5=unknown state
+}
+DFPLAYER_PROFILE;
+
+/* built-in profiles */
+extern const DFPLAYER_PROFILE DFPLAYER_PROFILE_YX5200;      //DFPlayer Mini, MP3-TF-16P, FN-M16P (YX5200 chip)
+extern const DFPLAYER_PROFILE DFPLAYER_PROFILE_YX5300;      //Serial MP3 Player (YX5300 chip), TF-card only, no "advert" folders & DAC gain, exits standby by "normal mode"
+extern const DFPLAYER_PROFILE DFPLAYER_PROFILE_JL_AAXXXX;   //DFPlayer Mini clone (JL AAxxxx chip from Jieli), no NOR-Flash & "advert1".."advert9" folders
+extern const DFPLAYER_PROFILE DFPLAYER_PROFILE_FN6100;      //FN-M10P, FN-S10P (FN6100 chip)
+extern const DFPLAYER_PROFILE DFPLAYER_PROFILE_GD3200B;     //DFPlayer Mini HW-247A (GD3200B chip), no folders count
+extern const DFPLAYER_PROFILE DFPLAYER_PROFILE_MH2024K;     //DFPlayer Mini HW-247A (MH2024K chip), no folders count & NOR-Flash
+extern const DFPLAYER_PROFILE DFPLAYER_PROFILE_NO_CHECKSUM; //no checksum calculation, not recomended for MCU without external crystal oscillator
+
+/* learned track duration */
+typedef struct
+{
+  uint16_t track;   //track number
+  uint8_t  folder;  //1..99 or see "duration table folder values"
+  uint8_t  source;  //1=USB-Disk, 2=TF-Card, 5=NOR-Flash
+  uint16_t seconds; //duration, 0=empty slot
+}
+DFPLAYER_DURATION;
+
+/* media manifest, generated from SD card tree by "extras/host/dfplayer_manifest", see "verifyManifest()" */
+#define DFPLAYER_MANIFEST_HASH_SEED   0x811C9DC5 //FNV-1a offset basis
+
+typedef struct
+{
+  uint32_t                 hash;          //FNV-1a of card counts, see "hashManifest()"
+  uint16_t                 totalTracks;   //all tracks on TF-Card, "getTotalTracksSD()"
+  uint8_t                  folders;       //all folders in root, "getTotalFolders()"
+  uint8_t                  lastFolder;    //size of "folderTracks"
+  const uint8_t           *folderTracks;  //tracks in folders 01..lastFolder, 0=no folder
+  const DFPLAYER_DURATION *durations;     //track durations preloaded after check, NULL=none
+  uint16_t                 durationCount; //size of "durations"
+}
+DFPLAYER_MANIFEST;
+
+/* power manager states */
+typedef enum : uint8_t
+{
+  DFPLAYER_POWER_ACTIVE  = 0x00, //module is awake & accepts playback commands
+  DFPLAYER_POWER_WAKING  = 0x01, //source is selected, playback commands are queued until module is ready
+  DFPLAYER_POWER_STANDBY = 0x02  //module in standby, any playback command wakes it up
+}
+DFPLAYER_POWER_STATE;
+
+/* transaction status values, see "getTransactionStatus()" */
+#define DFPLAYER_TRANSACTION_NONE     0x00 //no transaction or result already read
+#define DFPLAYER_TRANSACTION_PENDING  0x01 //commands collected or waiting in TX queue
+#define DFPLAYER_TRANSACTION_DONE     0x02 //all commands sent
+#define DFPLAYER_TRANSACTION_FAILED   0x03 //group didn't fit TX queue or module returned error, rest of group dropped
+
+/* query result status values, 0x01..0x0A are module errors, see "getCommandStatus()" */
+#define DFPLAYER_RESULT_OK            0x00 //response received, value is valid
+#define DFPLAYER_RESULT_TIMEOUT       0xFE //no response within timeout, see "setTimeout()"
+#define DFPLAYER_RESULT_UNSUPPORTED   0xFF //query not supported by module & wasn't sent, see "DFPLAYER_PROFILE"
+
+/* query result, tells value "0" apart from communication error */
+typedef struct
+{
+  uint16_t value;  //DH, DL of response or decoded value, "0" if status isn't DFPLAYER_RESULT_OK
+  uint8_t  status; //DFPLAYER_RESULT_OK, module error 0x01..0x0A, DFPLAYER_RESULT_TIMEOUT or DFPLAYER_RESULT_UNSUPPORTED
+}
+DFPLAYER_RESULT;
+
+/* snapshot blob, see "saveSnapshot()" */
+#define DFPLAYER_SNAPSHOT_MAGIC       0xDF //first byte of snapshot
+#define DFPLAYER_SNAPSHOT_VERSION     0x03 //blob layout version, blob with other version is rejected
+#define DFPLAYER_SNAPSHOT_SIZE        (24 + (DFPLAYER_DURATION_TABLE_SIZE * 6)) //max blob size, 24-bytes + 6-bytes per learned duration
+
+/* gap calibration, see "calibrateGap()" */
+#define DFPLAYER_CALIBRATION_FAILED   0xFFFF //module didn't reply at starting gap or doesn't support "getVolume()"
+#define DFPLAYER_CALIBRATION_BURST    8    //queries sent at every tested gap
+#define DFPLAYER_CALIBRATION_STEP     5    //search resolution, in msec
+#define DFPLAYER_CALIBRATION_MARGIN   25   //margin added to smallest reliable gap, in percent
+#define DFPLAYER_CALIBRATION_MARGIN_MIN 10 //min margin added to smallest reliable gap, in msec
+
+/* queued TX command */
+typedef struct
+{
+  uint8_t command;
+  uint8_t dataMSB;
+  uint8_t dataLSB;
+}
+DFPLAYER_COMMAND;
+
 
 class DFPlayer
 {
@@ -121,8 +329,13 @@ class DFPlayer
    void begin(Stream& stream, uint16_t threshold = DFPLAYER_CMD_DELAY, DFPLAYER_MODULE_TYPE = DFPLAYER_MINI, bool feedback = false, bool bootDelay = true);
 
    void setModel(DFPLAYER_MODULE_TYPE = DFPLAYER_MINI);
+   void setProfile(const DFPLAYER_PROFILE &profile);
+   bool isSupported(uint8_t command);
    void setTimeout(uint16_t threshold);
    void setFeedback(bool enable);
+#if (DFPLAYER_CALIBRATION == 1)
+   uint16_t calibrateGap(DFPLAYER_PROFILE &profile, uint8_t burst = DFPLAYER_CALIBRATION_BURST);
+#endif
 
    void setSource(uint8_t source);
    void playTrack(uint16_t track);
@@ -172,16 +385,241 @@ class DFPlayer
    uint8_t  getTotalFolders();
    uint8_t  getCommandStatus();
 
+   DFPLAYER_RESULT getStatusResult();
+   DFPLAYER_RESULT getVolumeResult();
+   DFPLAYER_RESULT getEQResult();
+   DFPLAYER_RESULT getPlayModeResult();
+   DFPLAYER_RESULT getVersionResult();
+   DFPLAYER_RESULT getTotalTracksSDResult();
+   DFPLAYER_RESULT getTotalTracksUSBResult();
+   DFPLAYER_RESULT getTotalTracksNORFlashResult();
+   DFPLAYER_RESULT getTrackSDResult();
+   DFPLAYER_RESULT getTrackUSBResult();
+   DFPLAYER_RESULT getTrackNORFlashResult();
+   DFPLAYER_RESULT getTotalTracksFolderResult(uint8_t folder);
+   DFPLAYER_RESULT getTotalFoldersResult();
+
+   void                 setNonBlocking(bool enable);
+   uint32_t             update();
+   bool                 isRxWakeupNeeded();
+   void                 setBusyPin(uint8_t pin);
+
+#if (DFPLAYER_HALF_DUPLEX == 1)
+   void                 setHalfDuplex(bool enable);
+   uint16_t             getCollisionsAvoided();
+   uint16_t             getFramesLost();
+#endif
+
+#if (DFPLAYER_POWER_MANAGER == 1)
+   void                 setIdleTimeout(uint32_t idleTime, uint8_t source = 2);
+   void                 scheduleWakeup(uint32_t playbackTime);
+   DFPLAYER_POWER_STATE getPowerState();
+   uint32_t             getPowerStateTime(DFPLAYER_POWER_STATE state);
+   uint16_t             getWakeupLatency();
+#endif
+
+#if (DFPLAYER_TRANSACTIONS == 1)
+   bool                 beginTransaction();
+   bool                 endTransaction();
+   uint8_t              getTransactionStatus();
+#endif
+
+#if (DFPLAYER_CONFIG_RESTORE == 1)
+   bool                 isConfigRestored();
+#endif
+
+#if (DFPLAYER_TRIGGER == 1)
+   void                 setTrigger(uint8_t folder, uint8_t track);
+   void                 trigger();
+   uint32_t             getTriggerLatency();
+   uint32_t             getTriggerLatencyMax();
+#endif
+
+   uint16_t             getDuration(uint8_t folder, uint16_t track, uint8_t source = 2);
+   void                 setDuration(uint8_t folder, uint16_t track, uint16_t seconds, uint8_t source = 2);
+   uint32_t             getPosition();
+   uint32_t             getRemaining();
+   uint16_t             getFinishedTrack();
+   bool                 isTrackMismatch();
+
+#if (DFPLAYER_SNAPSHOT == 1)
+   uint16_t             saveSnapshot(uint8_t *buffer, uint16_t size);
+   bool                 restoreSnapshot(const uint8_t *buffer, uint16_t size, DFPLAYER_PROFILE *profile = NULL);
+#endif
+
+   bool                 verifyManifest(const DFPLAYER_MANIFEST &manifest);
+   static uint32_t      hashManifest(uint16_t totalTracks, uint8_t folders, const uint8_t *folderTracks, uint8_t lastFolder);
+
   private:
+   /* sorted by size, no padding on 32-bit MCU */
    Stream*              _serial;
+   const DFPLAYER_PROFILE *_profile;                           //chip personality, differ in checksum, timing & status decoding
+   uint32_t             _txReadyTime;                          //time when next command can be written, in msec
+   uint32_t             _txDoneTime;                           //estimated time when last written byte leaves TX-pin, in usec
+   uint32_t             _playStart;                            //time when current track started, pause excluded, in msec
+   uint32_t             _pauseStart;                           //time when current track was paused or pause arrives to module, in msec
+   uint32_t             _finishedTime;                         //time of last accepted "track finished", in msec
+#if (DFPLAYER_POWER_MANAGER == 1)
+   uint32_t             _idleTimeout;                          //idle time before standby, 0=power manager disabled, in msec
+   uint32_t             _lastActivity;                         //time of last command, in msec
+   uint32_t             _wakeupTime;                           //time of scheduled playback, in msec
+   uint32_t             _stateStart;                           //time when current power state was entered, in msec
+   uint32_t             _powerStateTime[3];                    //total time spent in each power state, in msec
+#endif
+#if (DFPLAYER_HALF_DUPLEX == 1)
+   uint32_t             _rxStartTime;                          //time when start byte of "_rxBuffer" frame was received, in msec
+#endif
+#if (DFPLAYER_TRIGGER == 1)
+   uint32_t             _triggerStart;                         //time of last trigger, in usec
+   uint32_t             _triggerLatency;                       //last trigger to BUSY-pin low time, in usec
+   uint32_t             _triggerLatencyMax;                    //worst trigger to BUSY-pin low time, in usec
+#endif
+#if (DFPLAYER_DURATION_TABLE_SIZE != 0) && (DFPLAYER_SHARED_DURATIONS == 1)
+   static DFPLAYER_DURATION _durations[DFPLAYER_DURATION_TABLE_SIZE]; //learned track durations shared by all instances, hash table
+#elif (DFPLAYER_DURATION_TABLE_SIZE != 0)
+   DFPLAYER_DURATION    _durations[DFPLAYER_DURATION_TABLE_SIZE]; //learned track durations, hash table
+#endif
+#if (DFPLAYER_TX_BATCH > 1)
+   static DFPlayer     *_txBatchOwner;                         //instance collecting "_txBatch", NULL=frames are written one by one
+   static uint8_t       _txBatch[DFPLAYER_TX_BATCH * DFPLAYER_UART_FRAME_SIZE]; //frames waiting for one serial write, shared by all instances
+   static uint16_t      _txBatchLength;                        //number of bytes in "_txBatch"
+#endif
+
    uint16_t             _threshold;                            //timeout responses, in msec
-   uint8_t              _dataBuffer[DFPLAYER_UART_FRAME_SIZE]; //shared buffer between TX & RX
-   DFPLAYER_MODULE_TYPE _moduleType;                           //DFPlayer or Clone, differ in how checksum is calculated
-   bool                 _ack;                                  //true=request response from module after the command
+   uint16_t             _playTrack;                            //number of current track
+   uint16_t             _finishedTrack;                        //finished track waiting for "getFinishedTrack()"
+   uint16_t             _lastFinished;                         //number of last accepted finished track, duplicates filter
+#if (DFPLAYER_HALF_DUPLEX == 1)
+   uint16_t             _collisions;                           //writes delayed until RX frame was received, see "getCollisionsAvoided()"
+   uint16_t             _framesLost;                           //broken or incomplete RX frames, see "getFramesLost()"
+#endif
+#if (DFPLAYER_POWER_MANAGER == 1)
+   uint16_t             _wakeupLatency;                        //measured time from wake up command to module ready, in msec
+#endif
 
-   uint16_t _getResponse(uint8_t command);
+   DFPLAYER_COMMAND     _queue[DFPLAYER_QUEUE_SIZE];           //commands waiting for wake up or pacing gap
+   uint8_t              _rxBuffer[DFPLAYER_UART_FRAME_SIZE];   //received frame, collected by "update()" or while waiting for response
+   uint8_t              _rxIndex;                              //number of bytes collected in "_rxBuffer"
+   uint8_t              _commandStatus;                        //status of last received frame, see "getCommandStatus()"
+   uint8_t              _busyPin;                              //BUSY-pin, low while playing
+   uint8_t              _source;                               //current source, 1=USB-Disk, 2=TF-Card, 3=Aux, 5=NOR-Flash
+   uint8_t              _playFolder;                           //folder of current track, see "getDuration()"
+   uint8_t              _queueHead;                            //index of oldest command in "_queue"
+   uint8_t              _queueCount;                           //number of commands in "_queue"
+#if (DFPLAYER_POWER_MANAGER == 1)
+   DFPLAYER_POWER_STATE _powerState;                           //current power manager state
+   uint8_t              _wakeupSource;                         //source to select on wake up
+   DFPLAYER_COMMAND     _wakeupCommand;                        //first command sent after wake up, resent if module was not ready
+#endif
+#if (DFPLAYER_TRANSACTIONS == 1)
+   uint8_t              _groupPos;                             //position of transaction in "_queue", relative to "_queueHead"
+   uint8_t              _groupLength;                          //number of transaction commands in "_queue"
+   uint8_t              _transactionStatus;                    //see "getTransactionStatus()"
+#endif
+#if (DFPLAYER_CONFIG_RESTORE == 1)
+   uint8_t              _volume;                               //last sent volume, DFPLAYER_CONFIG_UNKNOWN=never set
+   uint8_t              _eq;                                   //last sent EQ, DFPLAYER_CONFIG_UNKNOWN=never set
+   uint8_t              _dacGain;                              //last sent DAC gain, DFPLAYER_CONFIG_UNKNOWN=never set
+   uint8_t              _restoreStep;                          //next setting to restore, see "_restoreConfig()"
+#endif
+#if (DFPLAYER_TRIGGER == 1)
+   uint8_t              _triggerFrame[DFPLAYER_UART_FRAME_SIZE]; //pre-encoded play command, see "setTrigger()"
+   uint8_t              _triggerLength;                        //length of "_triggerFrame", 0=trigger not set
+#endif
+
+   /* flags, bit-packed */
+   bool                 _ack             : 1;                  //true=request response from module after the command
+   bool                 _playing         : 1;                  //true=playback command was sent & track is not finished yet
+   bool                 _looping         : 1;                  //true=module repeats tracks & never finishes by itself
+   bool                 _nonBlocking     : 1;                  //true=write commands are queued instead of waiting for pacing gap
+   bool                 _playKnown       : 1;                  //true=current track number is known
+   bool                 _busyLow         : 1;                  //true=BUSY-pin went low after playback command
+   bool                 _pausePending    : 1;                  //true=pause is sent to playing track & hasn't arrived yet, see "_pauseStart"
+   bool                 _trackMismatch   : 1;                  //true="track finished" didn't match started track
+#if (DFPLAYER_POWER_MANAGER == 1)
+   bool                 _wakeupScheduled : 1;                  //true=wake up ahead of "_wakeupTime"
+   bool                 _wakeupProbe     : 1;                  //true=first command after wake up is waiting for feedback
+   bool                 _wakeupRetry     : 1;                  //true=module wasn't ready for first command, resent by "update()"
+#endif
+#if (DFPLAYER_TRANSACTIONS == 1)
+   bool                 _groupOpen       : 1;                  //true=write commands are collected into transaction
+   bool                 _groupFailed     : 1;                  //true=transaction didn't fit "_queue"
+   bool                 _groupStarted    : 1;                  //true=first transaction command was sent
+#endif
+#if (DFPLAYER_CONFIG_RESTORE == 1)
+   bool                 _dacDisabled     : 1;                  //true=DAC was disabled by "enableDAC()"
+   bool                 _dacGainEnabled  : 1;                  //"enable" value of last sent DAC gain
+   bool                 _restorePending  : 1;                  //true=module lost settings, restore isn't finished yet
+   bool                 _configRestored  : 1;                  //true=settings restored, see "isConfigRestored()"
+#endif
+#if (DFPLAYER_HALF_DUPLEX == 1)
+   bool                 _halfDuplex      : 1;                  //true=transport can't receive while transmitting
+   bool                 _txHeld          : 1;                  //true=write was delayed by RX frame in progress
+#endif
+#if (DFPLAYER_TRIGGER == 1)
+   bool                 _triggerPending  : 1;                  //true=waiting for BUSY-pin after trigger
+#endif
+
+   DFPLAYER_RESULT _getResponse(uint8_t command);
+   uint8_t  _decodeStatus(const uint8_t *frame);
    void     _sendData(uint8_t command, uint8_t dataMSB, uint8_t dataLSB);
+   void     _writeFrame(uint8_t command, uint8_t dataMSB, uint8_t dataLSB);
+   uint16_t _getDelay(uint16_t delay);
+   uint16_t _getChecksum(const uint8_t *buffer);
+   bool     _isChecksumValid(const uint8_t *buffer);
+   uint8_t  _encodeFrame(uint8_t *buffer, uint8_t command, uint8_t dataMSB, uint8_t dataLSB);
+   void     _writeBytes(const uint8_t *buffer, uint16_t length);
+#if (DFPLAYER_CALIBRATION == 1)
+   bool     _testGap(uint16_t gap, uint8_t burst);
+#endif
+   uint32_t _getTxTime();
+#if (DFPLAYER_TRIGGER == 1)
+   void     _checkTrigger();
+#endif
+   void     _checkBusyPin();
+   void     _watchPause();
+   void     _finishTrack(uint16_t track);
+#if (DFPLAYER_DURATION_TABLE_SIZE != 0)
+   int16_t  _findDuration(uint8_t source, uint8_t folder, uint16_t track);
+   void     _storeDuration(uint8_t source, uint8_t folder, uint16_t track, uint16_t seconds, bool replace);
+   uint8_t  _hashDuration(uint8_t source, uint8_t folder, uint16_t track);
+#endif
+   static uint32_t _hashByte(uint32_t hash, uint8_t data);
    bool     _readData();
+   bool     _readFrame();
+   void     _readEvents();
+   void     _parseEvent(const uint8_t *frame);
+   void     _trackCommand(uint8_t command, uint8_t dataMSB, uint8_t dataLSB);
+   bool     _isPlaybackCommand(uint8_t command);
+   bool     _pushCommand(uint8_t command, uint8_t dataMSB, uint8_t dataLSB);
+   void     _cancelCommands(uint8_t command);
+   uint8_t  _getPriority(uint8_t command);
+   bool     _sendNext();
+   void     _sendQueue();
+   void     _drainQueue();
+#if (DFPLAYER_TX_BATCH > 1)
+   bool     _openBatch();
+   void     _closeBatch();
+   void     _flushBatch();
+#endif
+   uint32_t _getTxDelay();
+   bool     _isQueryCommand(uint8_t command);
+   void     _waitForSource();
+#if (DFPLAYER_HALF_DUPLEX == 1)
+   bool     _isRxBusy();
+#endif
+#if (DFPLAYER_TRANSACTIONS == 1)
+   void     _abortTransaction();
+#endif
+#if (DFPLAYER_CONFIG_RESTORE == 1)
+   void     _restoreConfig();
+#endif
+#if (DFPLAYER_POWER_MANAGER == 1)
+   void     _startWakeup();
+   void     _finishWakeup();
+   void     _startProbe();
+   void     _setPowerState(DFPLAYER_POWER_STATE state);
+#endif
 };
 
 #endif
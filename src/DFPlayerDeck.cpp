@@ -0,0 +1,454 @@
+/***************************************************************************************************/
+/*
+   This is an Arduino library for two DFPlayer Mini MP3 modules feeding one mixer, A/B deck mode
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - modules outputs must be mixed, e.g. DAC outputs through resistors or
+     speaker outputs to mixer inputs, module amplifier outputs can't be
+     connected together
+   - see "DFPlayerDeck.h" for details
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#include "DFPlayerDeck.h"
+
+
+/**************************************************************************/
+/*
+    Constructor
+*/
+/**************************************************************************/
+DFPlayerDeck::DFPlayerDeck()
+{
+  //empty
+}
+
+
+/**************************************************************************/
+/*
+    begin()
+
+    Initialize deck
+
+    NOTE:
+    - call after "DFPlayer::begin()" of both modules
+    - both modules are switched to non-blocking mode, call "update()" of
+      deck instead of modules "update()" in main loop
+    - default playlist is track 001 of folder 01, see "setPlaylist()"
+    - default transition is gapless cut, see "setCrossfade()"
+*/
+/**************************************************************************/
+void DFPlayerDeck::begin(DFPlayer &deckA, DFPlayer &deckB, uint8_t volume)
+{
+  _decks[0]     = &deckA;
+  _decks[1]     = &deckB;
+  _fadeStart    = 0;
+  _fadeTime     = 0;
+  _startLatency = DFPLAYER_DECK_START_LATENCY;
+  _rampTime     = 0;
+  _folder       = 1;
+  _firstTrack   = 1;
+  _lastTrack    = 1;
+  _track        = DFPLAYER_DECK_NO_TRACK;
+  _nextTrack    = DFPLAYER_DECK_NO_TRACK;
+  _volume       = constrain(volume, 0, 30);
+  _volumeIn     = 0;
+  _volumeOut    = 0;
+  _active       = 0;
+  _repeat       = false;
+  _fading       = false;
+
+  deckA.setNonBlocking(true);
+  deckB.setNonBlocking(true);
+}
+
+
+/**************************************************************************/
+/*
+    setPlaylist()
+
+    Set playlist, tracks "firstTrack".."lastTrack" of folder
+
+    NOTE:
+    - folder 01..99 & track 001..255, see "DFPlayer::playFolder()"
+    - track numbers are swapped if "firstTrack" > "lastTrack"
+    - repeat=true, playlist starts over after last track
+    - current track isn't interrupted, new playlist is used by next
+      transition
+*/
+/**************************************************************************/
+void DFPlayerDeck::setPlaylist(uint8_t folder, uint8_t firstTrack, uint8_t lastTrack, bool repeat)
+{
+  if (firstTrack > lastTrack)
+  {
+    uint8_t track = firstTrack;
+
+    firstTrack = lastTrack;
+    lastTrack  = track;
+  }
+
+  if (firstTrack == 0) {firstTrack = 1;}
+  if (lastTrack == 0)  {lastTrack  = 1;}
+
+  _folder     = constrain(folder, 1, 99);
+  _firstTrack = firstTrack;
+  _lastTrack  = lastTrack;
+  _repeat     = repeat;
+}
+
+
+/**************************************************************************/
+/*
+    setCrossfade()
+
+    Set crossfade length & module start latency, in msec
+
+    NOTE:
+    - fadeTime=0, gapless cut, next track is started on idle module so
+      its audio starts when current track ends
+    - next track is started "fadeTime" + "startLatency" before learned
+      end of current track, volume of incoming module ramps 0..volume &
+      volume of outgoing module ramps volume..0 during "fadeTime"
+    - ramp resolution is limited by module pacing, volume is sent once
+      per gap & queued volume is replaced by newer one, e.g. 350msec
+      write delay of GD3200B gives about 3 steps per second, YX5200 has
+      no write delay & gets every step
+    - learned duration has 1sec resolution, see "DFPlayer::getDuration()",
+      gapless cut may overlap or miss up to 0.5sec, short crossfade hides it
+*/
+/**************************************************************************/
+void DFPlayerDeck::setCrossfade(uint16_t fadeTime, uint16_t startLatency)
+{
+  _fadeTime     = fadeTime;
+  _startLatency = startLatency;
+}
+
+
+/**************************************************************************/
+/*
+    setVolume()
+
+    Set deck volume, 0..30
+
+    NOTE:
+    - running crossfade ramps to new volume
+*/
+/**************************************************************************/
+void DFPlayerDeck::setVolume(uint8_t volume)
+{
+  _volume = constrain(volume, 0, 30);
+
+  if ((_track != DFPLAYER_DECK_NO_TRACK) && (_fading == false)) {_decks[_active]->setVolume(_volume);}
+}
+
+
+/**************************************************************************/
+/*
+    play()
+
+    Play playlist track on active module
+
+    NOTE:
+    - track=0, first playlist track
+    - running crossfade is cancelled, idle module is stopped
+*/
+/**************************************************************************/
+void DFPlayerDeck::play(uint8_t track)
+{
+  if (track == DFPLAYER_DECK_NO_TRACK) {track = _firstTrack;}
+
+  if (_fading == true) {_decks[_active ^ 1]->stop();}
+
+  _track     = constrain(track, _firstTrack, _lastTrack);
+  _nextTrack = DFPLAYER_DECK_NO_TRACK;
+  _fading    = false;
+
+  _copyDuration(_track, _active);
+
+  _decks[_active]->setVolume(_volume);
+  _decks[_active]->playFolder(_folder, _track);
+}
+
+
+/**************************************************************************/
+/*
+    next()
+
+    Crossfade to next playlist track now
+
+    NOTE:
+    - running crossfade is finished first
+    - nothing happens after last track if playlist doesn't repeat
+*/
+/**************************************************************************/
+void DFPlayerDeck::next()
+{
+  if (_track == DFPLAYER_DECK_NO_TRACK) {return;}
+
+  if (_fading == true) {_finishFade();}
+
+  _startNext(_fadeTime);
+}
+
+
+/**************************************************************************/
+/*
+    stop()
+
+    Stop both modules
+*/
+/**************************************************************************/
+void DFPlayerDeck::stop()
+{
+  _decks[0]->stop();
+  _decks[1]->stop();
+
+  _track     = DFPLAYER_DECK_NO_TRACK;
+  _nextTrack = DFPLAYER_DECK_NO_TRACK;
+  _fading    = false;
+}
+
+
+/**************************************************************************/
+/*
+    update()
+
+    Service both modules, start next track & ramp volumes, return time
+    until next deadline in msec
+
+    NOTE:
+    - call from main loop, it calls "DFPlayer::update()" of both modules
+    - "track finished" of both modules is consumed by deck, don't call
+      "DFPlayer::getFinishedTrack()"
+    - if duration of current track isn't learned yet, next track is
+      started by "track finished" with usual gap, the track is learned
+      for next time
+    - return DFPLAYER_NO_DEADLINE if nothing is pending, see
+      "DFPlayer::update()"
+*/
+/**************************************************************************/
+uint32_t DFPlayerDeck::update()
+{
+  uint32_t deadline  = _decks[0]->update();
+  uint32_t deadlineB = _decks[1]->update();
+
+  if (deadlineB < deadline) {deadline = deadlineB;}
+
+  bool finished = (_decks[_active]->getFinishedTrack() != DFPLAYER_TRACK_NONE);
+
+  _decks[_active ^ 1]->getFinishedTrack();                            //tail of track replaced by crossfade
+
+  if (_track == DFPLAYER_DECK_NO_TRACK) {return deadline;}
+
+  if (_fading == false)
+  {
+    uint32_t remaining = _decks[_active]->getRemaining();
+    uint32_t lead      = (uint32_t)_fadeTime + _startLatency;
+
+    if (finished == true)                                             //duration unknown, or track ended early
+    {
+      if (_getNextTrack() == DFPLAYER_DECK_NO_TRACK)
+      {
+        _track = DFPLAYER_DECK_NO_TRACK;                              //end of playlist
+
+        return deadline;
+      }
+
+      _startNext(0);
+    }
+    else if ((remaining != 0) && (remaining <= lead))
+    {
+      _startNext(_fadeTime);
+    }
+    else
+    {
+      if ((remaining != 0) && ((remaining - lead) < deadline)) {deadline = remaining - lead;}
+
+      return deadline;
+    }
+
+    if (_fading == false) {return (remaining < deadline) ? remaining : deadline;} //last track, nothing to start, wait for its end
+  }
+
+  int32_t elapsed = millis() - _fadeStart;
+
+  if (elapsed < 0)
+  {
+    if ((uint32_t)(-elapsed) < deadline) {deadline = -elapsed;}       //incoming audio isn't started yet
+
+    return deadline;
+  }
+
+  if ((uint32_t)elapsed >= _rampTime)
+  {
+    _finishFade();
+
+    return 0;                                                         //schedule next transition for new active module
+  }
+
+  uint8_t volumeIn  = ((uint32_t)_volume * elapsed) / _rampTime;
+  uint8_t volumeOut = _volume - volumeIn;
+
+  if (volumeIn != _volumeIn)
+  {
+    _decks[_active ^ 1]->setVolume(volumeIn);
+    _volumeIn = volumeIn;
+  }
+
+  if (volumeOut != _volumeOut)
+  {
+    _decks[_active]->setVolume(volumeOut);
+    _volumeOut = volumeOut;
+  }
+
+  uint32_t step = (_volume != 0) ? (_rampTime / _volume) : _rampTime; //time of one volume step
+
+  if (step < deadline) {deadline = step;}
+
+  return deadline;
+}
+
+
+/**************************************************************************/
+/*
+    getTrack()
+
+    Get playlist track of active module, DFPLAYER_DECK_NO_TRACK if stopped
+
+    NOTE:
+    - track changes when crossfade is finished
+*/
+/**************************************************************************/
+uint8_t DFPlayerDeck::getTrack()
+{
+  return _track;
+}
+
+
+/**************************************************************************/
+/*
+    getActiveDeck()
+
+    Get active module, 0=deck A, 1=deck B
+*/
+/**************************************************************************/
+uint8_t DFPlayerDeck::getActiveDeck()
+{
+  return _active;
+}
+
+
+/**************************************************************************/
+/*
+    isFading()
+
+    Check if next track is started on idle module & crossfade is running
+*/
+/**************************************************************************/
+bool DFPlayerDeck::isFading()
+{
+  return _fading;
+}
+
+
+/**************************************************************************/
+/*
+    _getNextTrack()
+
+    Get playlist track after current one, DFPLAYER_DECK_NO_TRACK after last
+    track of not repeated playlist
+*/
+/**************************************************************************/
+uint8_t DFPlayerDeck::_getNextTrack()
+{
+  if (_track == DFPLAYER_DECK_NO_TRACK) {return DFPLAYER_DECK_NO_TRACK;}
+  if (_track < _lastTrack)              {return _track + 1;}
+  if (_repeat == true)                  {return _firstTrack;}
+                                         return DFPLAYER_DECK_NO_TRACK;
+}
+
+
+/**************************************************************************/
+/*
+    _startNext()
+
+    Start next playlist track on idle module
+
+    NOTE:
+    - rampTime=0, incoming module starts at full volume, outgoing module
+      plays rest of its track
+*/
+/**************************************************************************/
+void DFPlayerDeck::_startNext(uint16_t rampTime)
+{
+  uint8_t track = _getNextTrack();
+
+  if (track == DFPLAYER_DECK_NO_TRACK) {return;}
+
+  DFPlayer &incoming = *_decks[_active ^ 1];
+
+  _copyDuration(track, _active ^ 1);
+
+  _volumeIn  = (rampTime == 0) ? _volume : 0;
+  _volumeOut = _volume;
+
+  incoming.setVolume(_volumeIn);                                      //queued before play command, no click at start
+  incoming.playFolder(_folder, track);
+
+  _nextTrack = track;
+  _rampTime  = rampTime;
+  _fadeStart = millis() + _startLatency;
+  _fading    = true;
+}
+
+
+/**************************************************************************/
+/*
+    _copyDuration()
+
+    Copy track duration learned by other module
+
+    NOTE:
+    - modules learn durations separately, track played on deck A has
+      unknown end on deck B, not needed with DFPLAYER_SHARED_DURATIONS
+*/
+/**************************************************************************/
+void DFPlayerDeck::_copyDuration(uint8_t track, uint8_t deck)
+{
+  if (_decks[deck]->getDuration(_folder, track) != 0) {return;}
+
+  uint16_t seconds = _decks[deck ^ 1]->getDuration(_folder, track);
+
+  if (seconds != 0) {_decks[deck]->setDuration(_folder, track, seconds);}
+}
+
+
+/**************************************************************************/
+/*
+    _finishFade()
+
+    Make incoming module active
+
+    NOTE:
+    - faded out module is stopped, rest of its track after rounded
+      learned duration isn't heard anyway
+*/
+/**************************************************************************/
+void DFPlayerDeck::_finishFade()
+{
+  if (_volumeIn != _volume) {_decks[_active ^ 1]->setVolume(_volume);}
+
+  if (_rampTime != 0) {_decks[_active]->stop();}
+
+  _active   ^= 1;
+  _track     = _nextTrack;
+  _nextTrack = DFPLAYER_DECK_NO_TRACK;
+  _fading    = false;
+}
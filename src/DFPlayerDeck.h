@@ -0,0 +1,80 @@
+/***************************************************************************************************/
+/*
+   This is an Arduino library for two DFPlayer Mini MP3 modules feeding one mixer, A/B deck mode
+
+   written by : enjoyneering
+   source code: https://github.com/enjoyneering/DFPlayer
+
+   NOTE:
+   - single module can't play gapless & can't crossfade, deck alternates
+     playlist tracks between two modules, next track is started on idle
+     module ahead of learned end of current track
+   - both modules are driven in non-blocking mode, volume ramps are paced
+     by each module TX queue, queued volume is replaced by newer one, see
+     "DFPlayer::setNonBlocking()"
+   - track end is known from learned duration, connect BUSY-pins or
+     enable feedback so every track is learned on first play, first play
+     of unknown track starts next one on "track finished" with usual gap,
+     see "DFPlayer::getDuration()"
+
+
+   GNU GPL license, all text above must be included in any redistribution,
+   see link for details  - https://www.gnu.org/licenses/licenses.html
+*/
+/***************************************************************************************************/
+
+#ifndef DFPLAYER_DECK_h
+#define DFPLAYER_DECK_h
+
+#include "DFPlayer.h"
+
+
+#define DFPLAYER_DECK_START_LATENCY   100  //average time from play command to audio on idle module, in msec
+#define DFPLAYER_DECK_NO_TRACK        0x00 //"getTrack()" value, nothing is playing, folder tracks start at 001
+
+
+class DFPlayerDeck
+{
+  public:
+   DFPlayerDeck();
+
+   void     begin(DFPlayer &deckA, DFPlayer &deckB, uint8_t volume = 25);
+
+   void     setPlaylist(uint8_t folder, uint8_t firstTrack, uint8_t lastTrack, bool repeat = false);
+   void     setCrossfade(uint16_t fadeTime, uint16_t startLatency = DFPLAYER_DECK_START_LATENCY);
+   void     setVolume(uint8_t volume);
+
+   void     play(uint8_t track = 0);
+   void     next();
+   void     stop();
+
+   uint32_t update();
+   uint8_t  getTrack();
+   uint8_t  getActiveDeck();
+   bool     isFading();
+
+  private:
+   DFPlayer            *_decks[2];                             //A & B modules
+   uint32_t             _fadeStart;                            //time when incoming track is expected to sound, in msec
+   uint16_t             _fadeTime;                             //crossfade length, 0=gapless cut, in msec
+   uint16_t             _startLatency;                         //time from play command to audio, in msec
+   uint16_t             _rampTime;                             //crossfade length of current transition, in msec
+   uint8_t              _folder;                               //playlist folder, 1..99
+   uint8_t              _firstTrack;                           //first playlist track in folder
+   uint8_t              _lastTrack;                            //last playlist track in folder
+   uint8_t              _track;                                //track of active deck, DFPLAYER_DECK_NO_TRACK=stopped
+   uint8_t              _nextTrack;                            //track started on idle deck, DFPLAYER_DECK_NO_TRACK=none
+   uint8_t              _volume;                               //deck volume, 0..30
+   uint8_t              _volumeIn;                             //last volume sent to incoming deck
+   uint8_t              _volumeOut;                            //last volume sent to outgoing deck
+   uint8_t              _active;                               //index of active deck in "_decks"
+   bool                 _repeat : 1;                           //true=playlist starts over after last track
+   bool                 _fading : 1;                           //true=idle deck started, ramps in progress
+
+   uint8_t  _getNextTrack();
+   void     _startNext(uint16_t rampTime);
+   void     _copyDuration(uint8_t track, uint8_t deck);
+   void     _finishFade();
+};
+
+#endif